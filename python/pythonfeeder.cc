@@ -305,15 +305,7 @@ void Feeder_t::feedValue(PyObject *value)
                                  -1);
 
     } else if (value == Py_None) {
-        //NOTE: Base64Marshaller is inherited from BinMarshaller_t
-        FRPC::BinMarshaller_t *binMarshaller(dynamic_cast<FRPC::BinMarshaller_t*>(marshaller));
-        if (binMarshaller) {
-            binMarshaller->packNull();
-        } else if ( dynamic_cast<FRPC::JSONMarshaller_t*>(marshaller) ) {
-            dynamic_cast<FRPC::JSONMarshaller_t*>(marshaller)->packNull();
-        } else {
-            dynamic_cast<FRPC::XmlMarshaller_t&>(*marshaller).packNull();
-        }
+        marshaller->packNull();
     } else {
 
         std::string objectRepr = "unknown";
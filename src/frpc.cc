@@ -39,6 +39,7 @@
 #include <sstream>
 #include <algorithm>
 #include <frpcxmlunmarshaller.h>
+#include <frpcvaluevisitor.h>
 
 
 
@@ -74,20 +75,79 @@ struct HexWriter_t
 
 namespace FRPC {
 
+namespace {
+
+inline char* putDigits(char *out, unsigned int value, int digits) {
+    for (int i = digits - 1; i >= 0; --i) {
+        out[i] = char('0' + value % 10);
+        value /= 10;
+    }
+    return out + digits;
+}
+
+/** Read at most maxDigits digits; return false when there is none.
+ */
+inline bool readDigits(const char *&sit, const char *end, int maxDigits,
+                       int &value)
+{
+    value = 0;
+    int i = 0;
+    while (sit != end && i < maxDigits && isdigit(*sit)) {
+        value = value * 10 + (*sit - '0');
+        ++sit;
+        ++i;
+    }
+    return i > 0;
+}
+
+} // namespace
+
 /**
-*@brief method render iso date time forma from parameters
+*@brief method render iso date time format from parameters to the buffer
+*/
+unsigned int formatISODateTime(char *buffer, short year, char month,
+                               char day, char hour,
+                               char minute, char sec, int timeZone) {
+    int tzHour = abs(timeZone / 60 / 60);
+    int tzMin = abs(timeZone / 60 % 60);
+
+    // out of fixed width fields (never produced by unmarshallers)
+    if ((year < 0) || (year > 9999) || (month < 0) || (day < 0)
+        || (hour < 0) || (minute < 0) || (sec < 0) || (tzHour > 99))
+    {
+        return snprintf(buffer, ISO_DATETIME_SIZE,
+                        "%04d%02d%02dT%02d:%02d:%02d%c%02d%02d",
+                        year, month, day, hour, minute, sec,
+                        ((timeZone <= 0)? '+': '-'), tzHour, tzMin);
+    }
+
+    char *out = buffer;
+    out = putDigits(out, year, 4);
+    out = putDigits(out, month, month > 99 ? 3 : 2);
+    out = putDigits(out, day, day > 99 ? 3 : 2);
+    *out++ = 'T';
+    out = putDigits(out, hour, hour > 99 ? 3 : 2);
+    *out++ = ':';
+    out = putDigits(out, minute, minute > 99 ? 3 : 2);
+    *out++ = ':';
+    out = putDigits(out, sec, sec > 99 ? 3 : 2);
+    *out++ = (timeZone <= 0)? '+': '-';
+    out = putDigits(out, tzHour, 2);
+    out = putDigits(out, tzMin, 2);
+    *out = '\0';
+    return out - buffer;
+}
 
+/**
+*@brief method render iso date time forma from parameters
 */
 std::string getISODateTime(short year, char month,
                            char day, char hour,
                            char minute, char sec, int timeZone) {
-    char dateTime[50];
-    sprintf(dateTime, "%04d%02d%02dT%02d:%02d:%02d%c%02d%02d",
-            year, month, day, hour, minute, sec,
-            ((timeZone <= 0)? '+': '-'),
-            abs(timeZone / 60 / 60), abs(timeZone / 60 % 60));
-
-    return std::string(dateTime);
+    char dateTime[ISO_DATETIME_SIZE];
+    unsigned int size = formatISODateTime(dateTime, year, month, day, hour,
+                                          minute, sec, timeZone);
+    return std::string(dateTime, size);
 }
 
 /**
@@ -101,106 +161,60 @@ void parseISODateTime(const char *data, long len, short &year, char &month,
 
     year = month = day = hour = minute = sec = timeZone = 0;
     // iterators
-    char *sit = const_cast<char*>(data);
-    char *end = const_cast<char*>(data)+len;
-
+    const char *sit = data;
+    const char *end = data + len;
+    int value;
 
     // skip leading spaces
     while (sit != end && isspace(*sit))
         ++sit;
     // get year
-    std::string tmp;
-    int i = 0;
-    while (sit != end && i < 4 && isdigit(*sit)) {
-        tmp += *sit;
-        ++sit;
-        ++i;
-    }
-    if (tmp.length() == 0)
+    if (!readDigits(sit, end, 4, value))
         throw StreamError_t("Bad DATE format");
-    year = atoi(tmp.c_str());
+    year = value;
 
     // skip optional delimiter
     if (sit != end && *sit == '-')
         ++sit;
     // get month
-    tmp.erase();
-    i = 0;
-    while (sit != end && i < 2 && isdigit(*sit)) {
-        tmp += *sit;
-        ++sit;
-        ++i;
-    }
-    if (tmp.length() == 0)
+    if (!readDigits(sit, end, 2, value))
         throw StreamError_t("Bad DATE format");
-    month = atoi(tmp.c_str());
+    month = value;
 
     // skip optional delimiter
     if (sit != end && *sit == '-')
         ++sit;
     // get day
-    tmp.erase();
-    i = 0;
-    while (sit != end && i < 2 && isdigit(*sit)) {
-        tmp += *sit;
-        ++sit;
-        ++i;
-    }
-    if (tmp.length() == 0)
+    if (!readDigits(sit, end, 2, value))
         throw StreamError_t("Bad DATE format");
-    day = atoi(tmp.c_str());
+    day = value;
 
     // skip time delimiter
     if (sit != end && (*sit == 'T' || *sit == 't' || *sit == ' ' ))
         ++sit;
     else
         return;
-    //throw StreamError_t("Bad DATE format no time");
 
     // get hour
-    tmp.erase();
-    i = 0;
-    while (sit != end && i < 2 && isdigit(*sit)) {
-        tmp += *sit;
-        ++sit;
-        ++i;
-    }
-    if (tmp.length() == 0)
+    if (!readDigits(sit, end, 2, value))
         return;
-    //throw StreamError_t("Bad DATE format");
-    hour = atoi(tmp.c_str());
+    hour = value;
 
     // skip optional delimiter
     if (sit != end && *sit == ':')
         ++sit;
     // get min
-    tmp.erase();
-    i = 0;
-    while (sit != end && i < 2 && isdigit(*sit)) {
-        tmp += *sit;
-        ++sit;
-        ++i;
-    }
-    if (tmp.length() == 0)
+    if (!readDigits(sit, end, 2, value))
         return;
-    //throw StreamError_t("Bad DATE format");
-    minute = atoi(tmp.c_str());
+    minute = value;
 
     // skip optional delimiter
     if (sit != end && *sit == ':')
         ++sit;
     // get sec
-    tmp.erase();
-    i = 0;
-    while (sit != end && i < 2 && isdigit(*sit)) {
-        tmp += *sit;
-        ++sit;
-        ++i;
-    }
-    if (tmp.length() == 0)
+    if (!readDigits(sit, end, 2, value))
         return;
-    //throw StreamError_t("Bad DATE format");
-    sec = atoi(tmp.c_str());
+    sec = value;
 
     // if sec fraction
     if (sit != end && *sit == '.') {
@@ -227,33 +241,15 @@ void parseISODateTime(const char *data, long len, short &year, char &month,
         tzmin = 0;
     } else if (tzsign == '+' || tzsign == '-') {
         // get TZ hour
-        tmp.erase();
-        i = 0;
-        while (sit != end && i < 2 && isdigit(*sit)) {
-            tmp += *sit;
-            ++sit;
-            ++i;
-        }
-        if (tmp.length() == 0)
+        if (!readDigits(sit, end, 2, tzhour))
             return;
-        //throw StreamError_t("Bad DATE format");
-        tzhour = atoi(tmp.c_str());
 
         // skip optional delimiter
         if (sit != end && *sit == ':')
             ++sit;
         // get TZ min
-        tmp.erase();
-        i = 0;
-        while (sit != end && i < 2 && isdigit(*sit)) {
-            tmp += *sit;
-            ++sit;
-            ++i;
-        }
-        if (tmp.length() == 0)
+        if (!readDigits(sit, end, 2, tzmin))
             return;
-        //throw StreamError_t("Bad DATE format");
-        tzmin = atoi(tmp.c_str());
     }
 
     // skip trailing spaces
@@ -267,155 +263,149 @@ void parseISODateTime(const char *data, long len, short &year, char &month,
 
 }
 
-/**
- * @short Dump FastRPC tree to string.
- * @param value FastRPC value.
- * @param outstr dump storage string.
- * @param level dump only to this level.
- * @param names mask all struct members with this names
- * @param pos mask all array members at these positions in top level array.
- * @return zero
- */
-int FRPC_DLLEXPORT dumpFastrpcTree(const Value_t &value, std::string &outstr,
-                                   int level, std::set<std::string> names,
-                                   std::bitset<sizeof(unsigned long) * 8> pos) {
-    std::ostringstream out;
-
-    switch (value.getType()) {
-    case Int_t::TYPE: {
-            out << Int(value).getValue();
-        }
-        break;
+namespace {
 
-    case Bool_t::TYPE: {
-            out << (Bool(value).getValue() ? "true" : "false");
-        }
-        break;
+typedef std::bitset<sizeof(unsigned long) * 8> Positions_t;
 
-    case Double_t::TYPE: {
-            out << Double(value).getValue();
-        }
-        break;
+/** Renders value for dumpFastrpcTree().
+ */
+class DumpVisitor_t : public ValueVisitor_t {
+public:
+    DumpVisitor_t(std::ostream &out, int level,
+                  const std::set<std::string> &names, const Positions_t &pos)
+        : out(out), level(level), names(names), pos(pos)
+    {}
+
+    virtual void visit(const Int_t &value) {
+        out << value.getValue();
+    }
 
-    case String_t::TYPE: {
+    virtual void visit(const Bool_t &value) {
+        out << (value.getValue() ? "true" : "false");
+    }
 
-            out << '"';
-            if (String(value).size() > MAX_LEN)
-                out << String(value).getString().substr(0,MAX_LEN) << "...";
-            else
-                out << String(value).getString();
-            out << '"';
+    virtual void visit(const Double_t &value) {
+        out << value.getValue();
+    }
 
+    virtual void visit(const String_t &value) {
+        out << '"';
+        if (value.size() > MAX_LEN)
+            out << value.getString().substr(0, MAX_LEN) << "...";
+        else
+            out << value.getString();
+        out << '"';
+    }
 
-        }
-        break;
+    virtual void visit(const Binary_t &value) {
+        out << "b\"";
 
-    case Binary_t::TYPE: {
+        // get data
+        std::string binary;
+        if (value.size() > MAX_LEN)
+            binary = value.getString().substr(0, MAX_LEN);
+        else
+            binary = value.getString();
 
-            out << "b\"";
+        // copy in hex
+        HexWriter_t hexWriter(out);
+        std::copy(binary.begin(), binary.end(), hexWriter);
+        if (value.size() > MAX_LEN)
+            out << "...";
 
-            // get data
-            std::string binary;
-            if (Binary(value).size() > MAX_LEN)
-                binary = Binary(value).getString().substr(0, MAX_LEN);
-            else
-                binary = Binary(value).getString();
+        out << '"';
+    }
 
-            // copy in hex
-            HexWriter_t hexWriter(out);
-            std::copy(binary.begin(), binary.end(), hexWriter);
-            if (Binary(value).size() > MAX_LEN)
-                out << "...";
+    virtual void visit(const DateTime_t &dt) {
+        char buff[50];
+        sprintf(buff, "%04d%02d%02dT%02d:%02d:%02d%c%02d%02d",
+                dt.getYear(), dt.getMonth(), dt.getDay(), dt.getHour(),
+                dt.getMin(), dt.getSec(),
+                ((dt.getTimeZone() <= 0)? '+': '-'),
+                abs(dt.getTimeZone() / 60 / 60),
+                abs(dt.getTimeZone() / 60 % 60));
 
-            out << '"';
-        }
-        break;
+        out << buff;
+    }
 
-    case DateTime_t::TYPE: {
-            const DateTime_t &dt = DateTime(value);
-            char buff[50];
-            sprintf(buff, "%04d%02d%02dT%02d:%02d:%02d%c%02d%02d",
-                    dt.getYear(), dt.getMonth(), dt.getDay(), dt.getHour(),
-                    dt.getMin(), dt.getSec(),
-                    ((dt.getTimeZone() <= 0)? '+': '-'),
-                    abs(dt.getTimeZone() / 60 / 60),
-                    abs(dt.getTimeZone() / 60 % 60));
+    virtual void visit(const Null_t &) {
+        out << "null";
+    }
 
-            out << buff;
+    virtual void visit(const Struct_t &value) {
+        bool first = true;
+        out << '{';
 
-        }
-        break;
+        if (level) {
+            DumpVisitor_t nested(out, level - 1, names, 0);
+            for (Struct_t::const_iterator
+                    i = value.begin(); i != value.end(); ++i) {
+
+                if (i->second && first != true)
+                    out << ", ";
+                else
+                    first = false;
+
+                out << i->first << ": ";
+                if (names.find(i->first) != names.end())
+                    out << "-hidden-";
+                else
+                    i->second->accept(nested);
+            }
+        } else
+            out << "...";
+        out << '}';
+    }
 
-    case Null_t::TYPE: {
-            out << "null";
+    virtual void visit(const Array_t &value) {
+        bool first = true;
+        out << '(';
+        if (level) {
+            DumpVisitor_t nested(out, level - 1, names, 0);
+            for (Array_t::const_iterator
+                    i = value.begin(), e = value.end(), b = value.begin();
+                    i != e; ++i) {
+                if (*i && first != true)
+                    out << ", ";
+                else
+                    first = false;
+
+                size_t xpos = i - b;
+                if ((xpos < pos.size()) && pos.test(xpos))
+                    out << "-hidden-";
+                else
+                    (*i)->accept(nested);
+            }
+        } else {
+            out << "...";
         }
-        break;
-
-    case Struct_t::TYPE: {
-            const Struct_t &structVal = Struct(value);
-            bool first = true;
-            out << '{';
-
-            if (level) {
-                for (Struct_t::const_iterator
-                        i = structVal.begin();
-                        i != structVal.end(); ++i) {
-
-                    if (i->second && first != true)
-                        out << ", ";
-                    else
-                        first = false;
-
-                    if (names.find(i->first) != names.end()) {
-                        out << i->first << ": " << "-hidden-";
-
-                    } else {
-                        std::string val_str;
-                        dumpFastrpcTree(*(i->second), val_str, level - 1,
-                                        names, 0);
-                        out << i->first << ": " << val_str;
-                    }
-
-                }
-            } else
-                out << "...";
-            out << '}';
+        out << ')';
+    }
 
+private:
+    std::ostream &out;
+    int level;
+    const std::set<std::string> &names;
+    Positions_t pos;
+};
 
-        }
-        break;
+} // namespace
 
-    case Array_t::TYPE: {
-            const Array_t &array = Array(value);
-            bool first = true;
-            out << '(';
-            if (level) {
-
-                for (Array_t::const_iterator
-                        i = array.begin(), e = array.end(), b = array.begin();
-                        i != e; ++i) {
-                    if (*i && first != true)
-                        out << ", ";
-                    else
-                        first = false;
-
-                    size_t xpos = i - b;
-                    if ((xpos < pos.size()) && pos.test(xpos)) {
-                        out << "-hidden-";
-
-                    } else {
-                        std::string str;
-                        dumpFastrpcTree(**i, str, level - 1, names, 0);
-                        out << str;
-                    }
-                }
-            } else {
-                out << "...";
-            }
-            out << ')';
-        }
-        break;
-    }
+/**
+ * @short Dump FastRPC tree to string.
+ * @param value FastRPC value.
+ * @param outstr dump storage string.
+ * @param level dump only to this level.
+ * @param names mask all struct members with this names
+ * @param pos mask all array members at these positions in top level array.
+ * @return zero
+ */
+int FRPC_DLLEXPORT dumpFastrpcTree(const Value_t &value, std::string &outstr,
+                                   int level, std::set<std::string> names,
+                                   std::bitset<sizeof(unsigned long) * 8> pos) {
+    std::ostringstream out;
+    DumpVisitor_t visitor(out, level, names, pos);
+    value.accept(visitor);
     // vytvori vystupny retezec
     outstr = out.str();
 
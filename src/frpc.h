@@ -73,6 +73,17 @@ std::string getISODateTime(short year, char month,
                            char day, char hour,
                            char minute, char sec, int timeZone);
 
+/** Size of buffer for formatISODateTime().
+ */
+const unsigned int ISO_DATETIME_SIZE = 64;
+
+/** Format ISO date time into buffer of ISO_DATETIME_SIZE bytes (without
+ *  sprintf); returns length of the (zero terminated) result.
+ */
+unsigned int formatISODateTime(char *buffer, short year, char month,
+                               char day, char hour,
+                               char minute, char sec, int timeZone);
+
 /**
  * @short Dump FastRPC tree to string.
  * @param value FastRPC value.
@@ -0,0 +1,192 @@
+/*
+ * FastRPC -- Fast RPC library compatible with XML-RPC
+ * Copyright (C) 2005-7  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Radlicka 2, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:fastrpc@firma.seznam.cz
+ *
+ * FILE          $Id$
+ *
+ * DESCRIPTION   Admission control (load shedding) of server calls
+ *
+ * AUTHOR
+ *
+ * HISTORY
+ *
+ */
+#include "frpcadmission.h"
+#include <errno.h>
+#include <frpcmetrics.h>
+#include <frpcfault.h>
+#include <frpchttperror.h>
+#include <frpchttp.h>
+#include <frpcmethodregistry.h>
+#include "frpcutils.h"
+
+namespace FRPC {
+
+AdmissionControl_t::Ticket_t::Ticket_t(AdmissionControl_t *control,
+                                       const std::string &methodName,
+                                       bool global)
+    : control(control), methodName(methodName), global(global),
+      gateTaken(false), start(0)
+{
+    if (!control) return;
+    gateTaken = control->admit(methodName, global);
+    start = Metrics_t::now();
+}
+
+AdmissionControl_t::Ticket_t::~Ticket_t() {
+    if (control)
+        control->release(methodName, Metrics_t::now() - start, global,
+                         gateTaken);
+}
+
+AdmissionControl_t::AdmissionControl_t(const Config_t &config)
+    : config(config), currentLimit(config.maxInFlight), lastDecrease(0),
+      refusedCalls(0)
+{
+    // decayed limit of 0 would mean unlimited
+    if (!this->config.minLimit) this->config.minLimit = 1;
+    global.limits = Limits_t(config.maxInFlight, config.maxQueue);
+    pthread_mutex_init(&mutex, 0);
+    pthread_cond_init(&released, 0);
+}
+
+AdmissionControl_t::~AdmissionControl_t() {
+    pthread_cond_destroy(&released);
+    pthread_mutex_destroy(&mutex);
+}
+
+void AdmissionControl_t::limit(const std::string &methodName,
+                               const Limits_t &limits)
+{
+    Locker_t locker(mutex);
+    methods[methodName].limits = limits;
+}
+
+bool AdmissionControl_t::globalFull() const {
+    unsigned int limit = config.adaptive
+        ? unsigned(currentLimit) : global.limits.maxInFlight;
+    return limit && (global.inFlight >= limit);
+}
+
+bool AdmissionControl_t::full(const Gate_t *gate) {
+    return gate && gate->limits.maxInFlight
+        && (gate->inFlight >= gate->limits.maxInFlight);
+}
+
+void AdmissionControl_t::refuse(const std::string &methodName,
+                                const char *reason, bool http)
+{
+    ++refusedCalls;
+    if (http && config.refuseWithHttp)
+        throw HTTPError_t(HTTP_SERVICE_UNAVAILABLE, "Service Unavailable");
+    throw Fault_t::format(MethodRegistry_t::FRPC_REQUEST_REFUSED_ERROR,
+                          "Call of %s refused: %s.", methodName.c_str(),
+                          reason);
+}
+
+bool AdmissionControl_t::admit(const std::string &methodName,
+                               bool takeGlobal)
+{
+    Locker_t locker(mutex);
+    GateMap_t::iterator pos = methods.find(methodName);
+    Gate_t *gate = (pos == methods.end()) ? 0 : &pos->second;
+
+    bool waitGlobal = takeGlobal && globalFull();
+    bool waitMethod = full(gate);
+    if (waitGlobal || waitMethod) {
+        // queue only where the limit is reached
+        if ((waitGlobal && (global.waiting >= global.limits.maxQueue))
+            || (waitMethod && (gate->waiting >= gate->limits.maxQueue)))
+        {
+            refuse(methodName, "server overloaded", takeGlobal);
+        }
+
+        if (waitGlobal) ++global.waiting;
+        if (waitMethod) ++gate->waiting;
+        struct timespec deadline = absoluteTime(config.queueTimeout);
+        int status = 0;
+        while (((takeGlobal && globalFull()) || full(gate))
+               && (status != ETIMEDOUT))
+        {
+            status = pthread_cond_timedwait(&released, &mutex, &deadline);
+        }
+        if (waitGlobal) --global.waiting;
+        if (waitMethod) --gate->waiting;
+
+        if ((takeGlobal && globalFull()) || full(gate))
+            refuse(methodName, "queue timeout", takeGlobal);
+    }
+
+    if (takeGlobal) ++global.inFlight;
+    if (gate) ++gate->inFlight;
+    return gate != 0;
+}
+
+void AdmissionControl_t::release(const std::string &methodName,
+                                 uint64_t latency, bool takenGlobal,
+                                 bool takenMethod)
+{
+    Locker_t locker(mutex);
+    if (takenGlobal) --global.inFlight;
+    if (takenMethod) {
+        // gates are never removed, so the taken one is still there
+        GateMap_t::iterator pos = methods.find(methodName);
+        if (pos != methods.end()) --pos->second.inFlight;
+    }
+
+    if (takenGlobal && config.adaptive && config.maxInFlight) {
+        uint64_t target = uint64_t(config.latencyTarget) * 1000;
+        if (latency <= target) {
+            currentLimit += 1.0 / currentLimit;
+            if (currentLimit > config.maxInFlight)
+                currentLimit = config.maxInFlight;
+        } else {
+            // calls in flight during the slowdown report it too
+            uint64_t now = Metrics_t::now();
+            if (now - lastDecrease >= target) {
+                lastDecrease = now;
+                currentLimit *= config.decreaseRatio;
+                if (currentLimit < config.minLimit)
+                    currentLimit = config.minLimit;
+            }
+        }
+    }
+
+    pthread_cond_broadcast(&released);
+}
+
+unsigned int AdmissionControl_t::limit() const {
+    Locker_t locker(mutex);
+    return config.adaptive ? unsigned(currentLimit)
+                           : global.limits.maxInFlight;
+}
+
+unsigned int AdmissionControl_t::inFlight() const {
+    Locker_t locker(mutex);
+    return global.inFlight;
+}
+
+uint64_t AdmissionControl_t::refused() const {
+    Locker_t locker(mutex);
+    return refusedCalls;
+}
+
+};
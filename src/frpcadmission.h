@@ -0,0 +1,204 @@
+/*
+ * FastRPC -- Fast RPC library compatible with XML-RPC
+ * Copyright (C) 2005-7  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Radlicka 2, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:fastrpc@firma.seznam.cz
+ *
+ * FILE          $Id$
+ *
+ * DESCRIPTION   Admission control (load shedding) of server calls
+ *
+ * AUTHOR
+ *
+ * HISTORY
+ *
+ */
+#ifndef FRPCFRPCADMISSION_H
+#define FRPCFRPCADMISSION_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <string>
+#include <map>
+
+#include <frpcplatform.h>
+
+namespace FRPC {
+
+/** Limits number of concurrently processed calls, globally and per method.
+ *
+ *  Call over the limit waits in queue for a free slot (at most
+ *  queueTimeout); when the queue is full or the wait times out the call is
+ *  refused at once by FRPC_REQUEST_REFUSED_ERROR fault (or HTTP 503) instead
+ *  of piling up behind slow ones.
+ *
+ *  With adaptive limit the global limit follows measured latency (AIMD):
+ *  every call finished within latencyTarget raises the limit by 1/limit
+ *  (one per limit calls), call slower than that multiplies it by
+ *  decreaseRatio (at most once per latencyTarget). The limit moves between
+ *  minLimit and maxInFlight.
+ *
+ *  One instance is meant to be shared by all servers of Acceptor_t, see
+ *  Server_t::Config_t::admission.
+ */
+class FRPC_DLLEXPORT AdmissionControl_t {
+public:
+    /** Limits of one method.
+     */
+    struct Limits_t {
+        Limits_t(unsigned int maxInFlight = 0, unsigned int maxQueue = 0)
+            : maxInFlight(maxInFlight), maxQueue(maxQueue)
+        {}
+
+        unsigned int maxInFlight;   //!< calls processed at once, 0 = unlimited
+        unsigned int maxQueue;      //!< calls waiting for free slot, 0 = no
+                                    //!< queue (refuse when limit is reached)
+    };
+
+    struct Config_t {
+        Config_t()
+            : maxInFlight(0), maxQueue(0), queueTimeout(100),
+              adaptive(false), minLimit(1), latencyTarget(100),
+              decreaseRatio(0.9), refuseWithHttp(false)
+        {}
+
+        ///@brief global limit of calls processed at once (0 = unlimited);
+        ///       initial and max value of adaptive limit
+        unsigned int maxInFlight;
+        ///@brief global limit of calls waiting for free slot (0 = no
+        ///       queue, refuse when maxInFlight is reached)
+        unsigned int maxQueue;
+        ///@brief max time in queue in miliseconds
+        unsigned int queueTimeout;
+        ///@brief adapt global limit to latency (needs maxInFlight)
+        bool adaptive;
+        ///@brief lower bound of adaptive limit (at least 1)
+        unsigned int minLimit;
+        ///@brief calls slower than this (miliseconds) decrease the limit
+        unsigned int latencyTarget;
+        ///@brief multiplicative decrease of adaptive limit
+        double decreaseRatio;
+        ///@brief refuse by HTTP 503 instead of fault (keep-alive
+        ///       connection stays open)
+        bool refuseWithHttp;
+    };
+
+    /** Admits call on construction, releases it on destruction.
+     */
+    class FRPC_DLLEXPORT Ticket_t {
+    public:
+        /** @param control admission control, 0 = admit everything
+         *  @param global take global slot too (false for sub-calls of
+         *         already admitted system.multicall, they are always
+         *         refused by fault)
+         *  @throw Fault_t FRPC_REQUEST_REFUSED_ERROR or HTTPError_t 503
+         */
+        Ticket_t(AdmissionControl_t *control, const std::string &methodName,
+                 bool global = true);
+
+        ~Ticket_t();
+
+    private:
+        Ticket_t(const Ticket_t&);
+        Ticket_t& operator=(const Ticket_t&);
+
+        AdmissionControl_t *control;
+        const std::string &methodName;
+        bool global;
+        bool gateTaken;             //!< method slot taken by admit()
+        uint64_t start;
+    };
+
+    explicit AdmissionControl_t(const Config_t &config);
+
+    ~AdmissionControl_t();
+
+    /** Set limits of given method.
+     */
+    void limit(const std::string &methodName, const Limits_t &limits);
+
+    /** Take slot for call of given method, wait in queue if needed.
+     *  @param takeGlobal take global slot too, otherwise method slot only
+     *  @return whether method slot has been taken (method is limited)
+     *  @throw Fault_t FRPC_REQUEST_REFUSED_ERROR or HTTPError_t 503
+     */
+    bool admit(const std::string &methodName, bool takeGlobal = true);
+
+    /** Return slot of finished call.
+     *  @param latency duration of the call in microseconds
+     *  @param takenGlobal whether the call took global slot (only such
+     *         calls adapt the global limit)
+     *  @param takenMethod whether admit() took method slot; method limited
+     *         later while the call was in flight has nothing to return
+     */
+    void release(const std::string &methodName, uint64_t latency,
+                 bool takenGlobal = true, bool takenMethod = true);
+
+    /** Current global limit (0 = unlimited).
+     */
+    unsigned int limit() const;
+
+    /** Calls processed now.
+     */
+    unsigned int inFlight() const;
+
+    /** Calls refused so far.
+     */
+    uint64_t refused() const;
+
+private:
+    AdmissionControl_t(const AdmissionControl_t&);
+    AdmissionControl_t& operator=(const AdmissionControl_t&);
+
+    struct Gate_t {
+        Gate_t() : inFlight(0), waiting(0) {}
+
+        Limits_t limits;
+        unsigned int inFlight;
+        unsigned int waiting;
+    };
+
+    typedef std::map<std::string, Gate_t> GateMap_t;
+
+    /** Global limit reached.
+     */
+    bool globalFull() const;
+
+    /** Limit of method gate (0 = not limited) reached.
+     */
+    static bool full(const Gate_t *gate);
+
+    /** @param http refuse by HTTP 503 (when configured) instead of fault
+     */
+    void refuse(const std::string &methodName, const char *reason,
+                bool http);
+
+    Config_t config;
+    Gate_t global;
+    GateMap_t methods;
+    double currentLimit;            //!< adaptive limit
+    uint64_t lastDecrease;
+    uint64_t refusedCalls;
+    mutable pthread_mutex_t mutex;
+    pthread_cond_t released;
+};
+
+};
+
+#endif
@@ -34,20 +34,23 @@
  *
  */
 
+#include <algorithm>
+
 #include "frpcarray.h"
 
 #include "frpcindexerror.h"
 #include "frpclenerror.h"
 #include "frpctypeerror.h"
 #include "frpc.h"
-#include "frpcconfig.h"
 
 namespace FRPC
 {
 
 
 Array_t::~Array_t()
-{}
+{
+    if (items != inlineItems) delete [] items;
+}
 
 
 Value_t& Array_t::clone(Pool_t& newPool) const
@@ -55,8 +58,8 @@ Value_t& Array_t::clone(Pool_t& newPool) const
     Array_t *newArray =&newPool.Array();
     newArray->reserve(size());
 
-    for(std::vector<Value_t*>::const_iterator iarrayData = arrayData.begin();
-            iarrayData != arrayData.end(); ++iarrayData)
+    for (const_iterator iarrayData = begin(); iarrayData != end();
+         ++iarrayData)
     {
         newArray->push_back((*iarrayData)->clone( newPool ));
     }
@@ -65,90 +68,99 @@ Value_t& Array_t::clone(Pool_t& newPool) const
 }
 
 Array_t::Array_t()
-{
-    arrayData.reserve(LibConfig_t::getInstance()->getDefaultArraySize());
-}
+    : items(inlineItems), count(0), allocated(INLINE_SIZE)
+{}
 
 
 Array_t::Array_t(const Value_t &item)
+    : items(inlineItems), count(1), allocated(INLINE_SIZE)
 {
-    arrayData.reserve(LibConfig_t::getInstance()->getDefaultArraySize());
-    arrayData.push_back(const_cast<Value_t*>(&item));
+    inlineItems[0] = const_cast<Value_t*>(&item);
 }
 
 Array_t::const_iterator Array_t::begin() const
 {
-    return arrayData.begin();
+    return items;
 }
 
 Array_t::const_iterator Array_t::end() const
 {
-    return arrayData.end();
+    return items + count;
 }
 
 Array_t::iterator Array_t::begin()
 {
-    return arrayData.begin();
+    return items;
 }
 
 Array_t::iterator Array_t::end()
 {
-    return  arrayData.end();
+    return items + count;
 }
 
 Array_t::size_type Array_t::size() const
 {
-    return arrayData.size();
+    return count;
 }
 
 void Array_t::clear()
 {
-    arrayData.clear();
+    count = 0;
 }
 
 void Array_t::reserve(Array_t::size_type size)
 {
-   arrayData.reserve(size);
+    // exact size, decoders know number of items in advance
+    if (size > allocated) grow(size);
 }
 
 Array_t::size_type Array_t::capacity()
 {
-   return arrayData.capacity();
+   return allocated;
+}
+
+void Array_t::grow(Array_t::size_type newCapacity)
+{
+    Value_t **newItems = new Value_t*[newCapacity];
+    std::copy(items, items + count, newItems);
+    if (items != inlineItems) delete [] items;
+    items = newItems;
+    allocated = newCapacity;
 }
 
 void Array_t::push_back(const Value_t &value)
 {
-    arrayData.push_back(const_cast<Value_t *>(&value));
+    if (count == allocated) grow(2 * allocated);
+    items[count++] = const_cast<Value_t *>(&value);
 }
 
 Array_t& Array_t::append(const Value_t &value)
 {
-
-    arrayData.push_back(const_cast<Value_t *>(&value));
+    push_back(value);
     return *this;
 }
 
 bool Array_t::empty() const
 {
-    return arrayData.empty();
+    return !count;
 }
 
 Value_t& Array_t::operator[] (Array_t::size_type index)
 {
-    if(index >= arrayData.size())
+    if(index >= count)
         throw(IndexError_t::format("index %zd is out of range 0 - %zd.", index,
-                                   arrayData.size()));
+                                   count));
 
-    return *(arrayData[index]);
+    return *(items[index]);
 }
 
 const Value_t& Array_t::operator[] (Array_t::size_type index) const
 {
-    if(index >= arrayData.size())
+    if(index >= count)
         throw(IndexError_t::format("index %zd is out of range 0 - %zd.", index,
-                                   arrayData.size()));
+                                   count));
 
-    return *(arrayData[index]);
+    return *(items[index]);
 }
 
 void Array_t::checkItems(const std::string &items) const
@@ -160,15 +172,14 @@ void Array_t::checkItems(const std::string &items) const
         }
     }
 
-    if(arrayData.size() != itemsSize) {
+    if(count != itemsSize) {
         throw LenError_t::format("Array must have %zd parameters.",
                                  items.size());
     }
 
     unsigned int itemNum = 0;
 
-    for (std::vector<Value_t *>::const_iterator i = arrayData.begin();
-         i != arrayData.end(); ++i)
+    for (const_iterator i = begin(); i != end(); ++i)
     {
         bool canBeNull(itemNum < items.size()-1 && items[itemNum+1] == '?');
 
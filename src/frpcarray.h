@@ -37,6 +37,7 @@
 #define FRPCFRPCARRAY_H
 
 #include <frpcvalue.h>
+#include <frpcvaluevisitor.h>
 #include <vector>
 
 namespace FRPC
@@ -54,11 +55,11 @@ public:
     /**
        @brief Array_t iterator
     */
-    typedef std::vector<Value_t*>::iterator iterator;
+    typedef Value_t** iterator;
     /**
        @brief Array_t const_iterator
     */
-    typedef std::vector<Value_t*>::const_iterator const_iterator;
+    typedef Value_t* const* const_iterator;
     /**
       @brief Array_t size_type
     */
@@ -70,6 +71,12 @@ public:
     typedef Value_t value_type;
 
     enum{TYPE = 0x0B};
+
+    /**
+        @brief Number of items stored inside the Array_t itself; larger
+        arrays allocate storage on the heap
+    */
+    enum{INLINE_SIZE = 8};
     /**
         @brief  Default destructor
     */
@@ -81,6 +88,15 @@ public:
     */
 
     virtual Value_t& clone(Pool_t &newPool) const;
+
+    /**
+        @brief Dispatch this value to the visitor
+        @param visitor is reference to visitor
+    */
+    virtual void accept(ValueVisitor_t &visitor) const
+    {
+        visitor.visit(*this);
+    }
     /**
         @brief Getting type of value
         @return  @b unsigned @b short always
@@ -210,8 +226,18 @@ private:
     */
     explicit Array_t(const Value_t &item);
 
+    Array_t(const Array_t&);
+    Array_t& operator=(const Array_t&);
+
+    /**
+        @brief move items to storage of given capacity
+    */
+    void grow(size_type newCapacity);
 
-    std::vector<Value_t*> arrayData;///Internal array data
+    Value_t **items;                        ///< inlineItems or heap storage
+    size_type count;                        ///< number of items
+    size_type allocated;                    ///< capacity of items
+    Value_t *inlineItems[INLINE_SIZE];      ///< small array storage
 
 };
 /**
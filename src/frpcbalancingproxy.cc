@@ -0,0 +1,290 @@
+/*
+ * FastRPC -- Fast RPC library compatible with XML-RPC
+ * Copyright (C) 2005-7  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Radlicka 2, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:fastrpc@firma.seznam.cz
+ *
+ * FILE          $Id$
+ *
+ * DESCRIPTION   Client balancing calls among more backends
+ *
+ * AUTHOR
+ *
+ * HISTORY
+ *
+ */
+#include <stdarg.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "frpcbalancingproxy.h"
+#include <frpc.h>
+#include <frpcfault.h>
+#include <frpcmetrics.h>
+#include "frpcutils.h"
+
+namespace FRPC {
+
+struct BalancingProxy_t::Entry_t {
+    Entry_t(const std::string &url)
+        : url(url), outstanding(0), calls(0), failures(0), failedInRow(0),
+          ejectedUntil(0)
+    {}
+
+    ~Entry_t() {
+        for (std::vector<ServerProxy_t*>::iterator
+                 iidle = idle.begin(); iidle != idle.end(); ++iidle)
+            delete *iidle;
+    }
+
+    std::string url;
+    std::vector<ServerProxy_t*> idle;   //!< proxies not used by any call
+    unsigned int outstanding;
+    uint64_t calls;
+    uint64_t failures;
+    unsigned int failedInRow;
+    uint64_t ejectedUntil;              //!< Metrics_t::now() time, 0 = in
+};
+
+/** Proxy of chosen backend held for the time of one call. The call counts
+ *  as failed unless success() is called.
+ */
+class BalancingProxy_t::Lease_t {
+public:
+    Lease_t(BalancingProxy_t &balancer)
+        : balancer(balancer), entry(balancer.acquire()), proxy(0),
+          failed(true)
+    {
+        // proxy is created outside of lock
+        {
+            Locker_t locker(balancer.mutex);
+            if (!entry.idle.empty()) {
+                proxy = entry.idle.back();
+                entry.idle.pop_back();
+            }
+        }
+
+        if (!proxy) {
+            try {
+                proxy = new ServerProxy_t(entry.url, balancer.config.proxy);
+            } catch (...) {
+                balancer.release(entry, 0, true);
+                throw;
+            }
+        }
+    }
+
+    ~Lease_t() {
+        balancer.release(entry, proxy, failed);
+    }
+
+    ServerProxy_t& operator*() {
+        return *proxy;
+    }
+
+    void success() {
+        failed = false;
+    }
+
+private:
+    Lease_t(const Lease_t&);
+    Lease_t& operator=(const Lease_t&);
+
+    BalancingProxy_t &balancer;
+    Entry_t &entry;
+    ServerProxy_t *proxy;
+    bool failed;
+};
+
+BalancingProxy_t::BalancingProxy_t(const std::vector<std::string> &backends,
+                                   const Config_t &config)
+    : config(config), next(0),
+      seed(static_cast<unsigned int>(time(0))
+           ^ static_cast<unsigned int>(reinterpret_cast<size_t>(this)))
+{
+    if (backends.empty())
+        throw Error_t("No backend given");
+
+    pthread_mutex_init(&mutex, 0);
+    try {
+        for (std::vector<std::string>::const_iterator
+                 ibackends = backends.begin(); ibackends != backends.end();
+             ++ibackends)
+        {
+            entries.push_back(0);
+            entries.back() = new Entry_t(*ibackends);
+        }
+    } catch (...) {
+        for (std::vector<Entry_t*>::iterator
+                 ientries = entries.begin(); ientries != entries.end();
+             ++ientries)
+            delete *ientries;
+        pthread_mutex_destroy(&mutex);
+        throw;
+    }
+}
+
+BalancingProxy_t::~BalancingProxy_t() {
+    for (std::vector<Entry_t*>::iterator
+             ientries = entries.begin(); ientries != entries.end(); ++ientries)
+        delete *ientries;
+    pthread_mutex_destroy(&mutex);
+}
+
+bool BalancingProxy_t::available(const Entry_t &entry, uint64_t now) const {
+    return entry.ejectedUntil <= now;
+}
+
+BalancingProxy_t::Entry_t& BalancingProxy_t::acquire() {
+    uint64_t now = Metrics_t::now();
+    unsigned int size = entries.size();
+    Entry_t *chosen = 0;
+
+    Locker_t locker(mutex);
+    if (config.policy == TWO_CHOICES) {
+        // first of random pair picked among available backends
+        unsigned int first = rand_r(&seed) % size;
+        unsigned int second = (size > 1)
+            ? (first + 1 + rand_r(&seed) % (size - 1)) % size : first;
+        for (unsigned int i = 0; (i < size) && !chosen; ++i) {
+            Entry_t *entry = entries[(first + i) % size];
+            if (available(*entry, now)) chosen = entry;
+        }
+        for (unsigned int i = 0; (i < size) && chosen; ++i) {
+            Entry_t *entry = entries[(second + i) % size];
+            if (available(*entry, now)) {
+                if (entry->outstanding < chosen->outstanding) chosen = entry;
+                break;
+            }
+        }
+    } else {
+        unsigned int start = next++ % size;
+        for (unsigned int i = 0; i < size; ++i) {
+            Entry_t *entry = entries[(start + i) % size];
+            if (available(*entry, now)
+                && (!chosen || (entry->outstanding < chosen->outstanding)))
+                chosen = entry;
+        }
+    }
+
+    // all ejected, try the one ejected first
+    if (!chosen) {
+        chosen = entries.front();
+        for (unsigned int i = 1; i < size; ++i) {
+            if (entries[i]->ejectedUntil < chosen->ejectedUntil)
+                chosen = entries[i];
+        }
+    }
+
+    // ejected backend gets single probe per eject time
+    if (chosen->ejectedUntil)
+        chosen->ejectedUntil = now + uint64_t(config.ejectTime) * 1000000;
+
+    ++chosen->outstanding;
+    return *chosen;
+}
+
+void BalancingProxy_t::release(Entry_t &entry, ServerProxy_t *proxy,
+                               bool failed)
+{
+    {
+        Locker_t locker(mutex);
+        --entry.outstanding;
+        ++entry.calls;
+        if (failed) {
+            ++entry.failures;
+            ++entry.failedInRow;
+            if (config.ejectAfter
+                && (entry.failedInRow >= config.ejectAfter))
+            {
+                entry.ejectedUntil = Metrics_t::now()
+                    + uint64_t(config.ejectTime) * 1000000;
+            }
+        } else {
+            entry.failedInRow = 0;
+            entry.ejectedUntil = 0;
+        }
+
+        if (proxy) {
+            try {
+                entry.idle.push_back(proxy);
+                proxy = 0;
+            } catch (...) {}
+        }
+    }
+
+    delete proxy;
+}
+
+Value_t& BalancingProxy_t::call(Pool_t &pool, const std::string &methodName,
+                                const Array_t &params)
+{
+    Lease_t proxy(*this);
+    try {
+        Value_t &result = (*proxy).call(pool, methodName, params);
+        proxy.success();
+        return result;
+    } catch (const Fault_t &) {
+        // backend is alive
+        proxy.success();
+        throw;
+    }
+}
+
+Value_t& BalancingProxy_t::call(Pool_t &pool, const char *methodName, ...) {
+    Array_t &params = pool.Array();
+
+    va_list args;
+    va_start(args, methodName);
+    while (const Value_t *value = va_arg(args, Value_t*))
+        params.append(*value);
+    va_end(args);
+
+    return call(pool, std::string(methodName), params);
+}
+
+void BalancingProxy_t::call(DataBuilder_t &builder,
+                            const std::string &methodName,
+                            const Array_t &params)
+{
+    Lease_t proxy(*this);
+    (*proxy).call(builder, methodName, params);
+    proxy.success();
+}
+
+std::vector<BalancingProxy_t::Backend_t> BalancingProxy_t::backends() const {
+    uint64_t now = Metrics_t::now();
+    std::vector<Backend_t> result(entries.size());
+
+    {
+        Locker_t locker(mutex);
+        for (unsigned int i = 0; i < entries.size(); ++i) {
+            result[i].outstanding = entries[i]->outstanding;
+            result[i].calls = entries[i]->calls;
+            result[i].failures = entries[i]->failures;
+            result[i].ejected = !available(*entries[i], now);
+        }
+    }
+
+    for (unsigned int i = 0; i < entries.size(); ++i)
+        result[i].url = entries[i]->url;
+    return result;
+}
+
+} // namespace FRPC
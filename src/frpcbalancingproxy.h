@@ -0,0 +1,166 @@
+/*
+ * FastRPC -- Fast RPC library compatible with XML-RPC
+ * Copyright (C) 2005-7  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Radlicka 2, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:fastrpc@firma.seznam.cz
+ *
+ * FILE          $Id$
+ *
+ * DESCRIPTION   Client balancing calls among more backends
+ *
+ * AUTHOR
+ *
+ * HISTORY
+ *
+ */
+#ifndef FRPCFRPCBALANCINGPROXY_H
+#define FRPCFRPCBALANCINGPROXY_H
+
+#include <frpcplatform.h>
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <pthread.h>
+
+#include <frpcserverproxy.h>
+
+namespace FRPC {
+
+class Pool_t;
+class Value_t;
+class Array_t;
+class DataBuilder_t;
+
+/**
+@brief Client spreading calls among set of equivalent backends
+
+Each call goes to one backend chosen by the configured policy; calls may
+be made from more threads at once. Every backend keeps pool of
+ServerProxy_t instances (one per concurrent call), so connections are
+kept alive and reused as with plain ServerProxy_t.
+
+Backend failing with network or HTTP error several times in a row is
+ejected for a while; after that time single call probes it and success
+puts it back. Faults don't count as failures. When all backends are
+ejected, the one ejected first is tried anyway.
+*/
+class FRPC_DLLEXPORT BalancingProxy_t {
+public:
+    /** How to choose backend for the call.
+     */
+    enum Policy_t {
+        ///@brief backend with least calls in progress (ties round robin)
+        LEAST_OUTSTANDING,
+        ///@brief fewer calls in progress of two random backends
+        TWO_CHOICES
+    };
+
+    /**
+        @brief BalancingProxy_t configuration
+    */
+    struct Config_t {
+        Config_t()
+            : policy(TWO_CHOICES), ejectAfter(3), ejectTime(10)
+        {}
+
+        ///@brief configuration of connections to backends
+        ServerProxy_t::Config_t proxy;
+        ///@brief backend choosing policy
+        Policy_t policy;
+        ///@brief consecutive failures ejecting backend (0 = never eject)
+        unsigned int ejectAfter;
+        ///@brief seconds before ejected backend is probed
+        unsigned int ejectTime;
+    };
+
+    /**
+        @brief State of backend for monitoring
+    */
+    struct Backend_t {
+        std::string url;
+        unsigned int outstanding;   //!< calls in progress
+        uint64_t calls;             //!< finished calls
+        uint64_t failures;          //!< calls failed on network/HTTP error
+        bool ejected;
+    };
+
+    /**
+        @brief Constructor
+        @param backends URLs of backends (see ServerProxy_t)
+        @param config configuration
+    */
+    BalancingProxy_t(const std::vector<std::string> &backends,
+                     const Config_t &config);
+
+    ~BalancingProxy_t();
+
+    /**
+        @brief Call method on one of backends
+        @see ServerProxy_t::call()
+    */
+    Value_t& call(Pool_t &pool, const std::string &methodName,
+                  const Array_t &params);
+
+    /**
+        @brief Call method with variable number of parameters terminated
+               by null pointer; parameters are collected to array in pool
+        @see ServerProxy_t::call()
+    */
+    Value_t& call(Pool_t &pool, const char *methodName, ...);
+
+    /**
+        @brief Call method on one of backends, building result by builder
+        @see ServerProxy_t::call()
+    */
+    void call(DataBuilder_t &builder, const std::string &methodName,
+              const Array_t &params);
+
+    /**
+        @brief Current state of all backends
+    */
+    std::vector<Backend_t> backends() const;
+
+private:
+    BalancingProxy_t(const BalancingProxy_t&);
+    BalancingProxy_t& operator=(const BalancingProxy_t&);
+
+    struct Entry_t;
+    class Lease_t;
+
+    /** Choose backend and take idle proxy of it (or create new one).
+     */
+    Entry_t& acquire();
+
+    /** Return proxy of finished call and update backend health.
+     */
+    void release(Entry_t &entry, ServerProxy_t *proxy, bool failed);
+
+    bool available(const Entry_t &entry, uint64_t now) const;
+
+    Config_t config;
+    std::vector<Entry_t*> entries;
+    unsigned int next;              //!< round robin position
+    unsigned int seed;              //!< random choices
+    mutable pthread_mutex_t mutex;  //!< guards entries and choice state
+};
+
+} // namespace FRPC
+
+#endif
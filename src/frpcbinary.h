@@ -35,6 +35,7 @@
 
 #include <string>
 #include <frpcvalue.h>
+#include <frpcvaluevisitor.h>
 
 
 namespace FRPC
@@ -105,6 +106,15 @@ public:
     */
     virtual Value_t& clone(Pool_t &newPool) const;
 
+    /**
+        @brief Dispatch this value to the visitor
+        @param visitor is reference to visitor
+    */
+    virtual void accept(ValueVisitor_t &visitor) const
+    {
+        visitor.visit(*this);
+    }
+
     /**
         @brief operator const std::string
     */
@@ -89,10 +89,8 @@ void BinMarshaller_t::packArray(unsigned int numOfItems) {
     //pack dataType
     char type = FRPC_DATA_TYPE(ARRAY,numType);
 
-    //add DATATYPE to buffer
-    writer.write(&type,1);
-    //add number (current length)
-    writer.write((char*)number.data, getNumberSize(numType));
+    //add DATATYPE and number (current length) to buffer
+    writeTyped(type, number, numType);
 
 }
 
@@ -107,10 +105,8 @@ void BinMarshaller_t::packBinary(const char* value, unsigned int size) {
     //pack dataType
     char type = FRPC_DATA_TYPE(BINARY,numType);
 
-    //add DATATYPE to buffer
-    writer.write(&type,1);
-
-    writer.write((char*)dataSize.data,getNumberSize(numType));
+    //add DATATYPE and size to buffer
+    writeTyped(type, dataSize, numType);
 
     writer.write(value,size);
 
@@ -190,23 +186,21 @@ void BinMarshaller_t::packDateTime(short year, char month, char day, char hour,
 void BinMarshaller_t::packDouble(double value) {
     //pack type
     char type = FRPC_DATA_TYPE(DOUBLE, 0);
-    //write type
-    writer.write(&type,1);
     //write data
-    char data[8];
-    memset(data, 0, 8);
-    memcpy(data, (char*)&value, 8);
+    char data[9];
+    data[0] = type;
+    memcpy(data + 1, (char*)&value, 8);
 
 #ifdef FRPC_BIG_ENDIAN
     //swap it
-    SWAP_BYTE(data[7],data[0]);
-    SWAP_BYTE(data[6],data[1]);
-    SWAP_BYTE(data[5],data[2]);
-    SWAP_BYTE(data[4],data[3]);
+    SWAP_BYTE(data[8],data[1]);
+    SWAP_BYTE(data[7],data[2]);
+    SWAP_BYTE(data[6],data[3]);
+    SWAP_BYTE(data[5],data[4]);
 #endif
 
 
-    writer.write(data, 8);
+    writer.write(data, 9);
 
 
 
@@ -240,9 +234,8 @@ void BinMarshaller_t::packInt(Int_t::value_type value) {
         //pack number value
         Number_t number(zig);
 
-        //write type
-        writer.write(&type, 1);
-        writer.write(number.data, getNumberSize(numType));
+        //write type and number
+        writeTyped(type, number, numType);
 
     } else if (protocolVersion.versionMajor > 1) {
 
@@ -251,17 +244,15 @@ void BinMarshaller_t::packInt(Int_t::value_type value) {
             unsigned int numType = getNumberType(-value);
             char type = FRPC_DATA_TYPE(INTN8,numType);
             Number_t  number(-value);
-            //write type
-            writer.write(&type,1);
-            writer.write(number.data, getNumberSize(numType));
+            //write type and number
+            writeTyped(type, number, numType);
 
         } else { //positive int8
             unsigned int numType = getNumberType(value);
             char type = FRPC_DATA_TYPE(INTP8,numType);
             Number_t  number(value);
-            //write type
-            writer.write(&type,1);
-            writer.write(number.data, getNumberSize(numType));
+            //write type and number
+            writeTyped(type, number, numType);
 
         }
 
@@ -272,9 +263,8 @@ void BinMarshaller_t::packInt(Int_t::value_type value) {
         //pack number value
         Number32_t  number(value);
 
-        //write type
-        writer.write(&type,1);
-        writer.write(number.data, getNumberSize(numType));
+        //write type and number
+        writeTyped(type, number, numType);
     }
 
 
@@ -315,10 +305,8 @@ void BinMarshaller_t::packString(const char* value, unsigned int size) {
     //pack strSize
     Number_t number(size);
 
-    //write type
-    writer.write(&type, 1);
-    //write packed strSize
-    writer.write(number.data, getNumberSize(numType));
+    //write type and packed strSize
+    writeTyped(type, number, numType);
     //write whole string
     writer.write(value, size);
 }
@@ -331,10 +319,8 @@ void BinMarshaller_t::packStruct(unsigned int  numOfMembers) {
     //pack numOfMembers
     Number_t number(numOfMembers);
 
-    //write type
-    writer.write(&type, 1);
-    //write packed numOfMembers
-    writer.write(number.data, getNumberSize(numType));
+    //write type and packed numOfMembers
+    writeTyped(type, number, numType);
 }
 
 void BinMarshaller_t::packStructMember(const char* memberName,
@@ -346,10 +332,11 @@ void BinMarshaller_t::packStructMember(const char* memberName,
             "Lenght of member name is %d not in interval (1-255)", size);
 
     //write member name
-    int8_t realSize = int8_t(size);
-    writer.write(reinterpret_cast<char *>(&realSize), 1);
+    char *out = writer.reserve(size + 1);
+    out[0] = char(size);
     //write whole memberName
-    writer.write(memberName, size);
+    memcpy(out + 1, memberName, size);
+    writer.commit(size + 1);
 
 }
 
@@ -46,6 +46,8 @@ namespace FRPC {
 
 /**
 @brief Binary Marshaller (FastRPC)
+
+Output goes through BufferedWriter_t; data not flushed are lost.
 @author Miroslav Talasek
 */
 class BinMarshaller_t : public Marshaller_t {
@@ -72,7 +74,7 @@ public:
     virtual void packMethodResponse();
     virtual void flush();
 
-    void packNull();
+    virtual void packNull();
 
 private:
 
@@ -84,54 +86,47 @@ private:
         return size + 1;
     }
 
-    inline unsigned int getNumberType(Int_t::value_type number) {
+    /** Number of bytes (1-8) needed for the number.
+     */
+    static inline unsigned int byteLength(uint64_t number) {
+#ifdef __GNUC__
+        // (number | 1) => zero takes one byte
+        return (64 - __builtin_clzll(number | 1) + 7) >> 3;
+#else
+        unsigned int bytes = 1;
+        while ((bytes < 8) && (number >> (bytes * 8))) ++bytes;
+        return bytes;
+#endif
+    }
 
+    inline unsigned int getNumberType(Int_t::value_type number) {
         if (protocolVersion.versionMajor < 2) {
             int32_t oldNumber = int32_t(number);
-            // + 1 => old marking
-            if (!(oldNumber & OLD_INT8_MASK))
-                return CHAR8 + 1;
-
-            if (!(oldNumber & OLD_INT16_MASK))
-                return SHORT16 + 1;
-
-            if (!(oldNumber & OLD_INT24_MASK))
-                return LONG24 + 1;
-
-            if (!(oldNumber & OLD_INT32_MASK))
-                return LONG32 + 1;
-
-            throw StreamError_t("Number is too big for protocol version 1.0");
-        } else {
-            if (!(number & INT8_MASK))
-                return CHAR8;
-
-            if (!(number & INT16_MASK))
-                return SHORT16;
-
-            if (!(number & INT24_MASK))
-                return LONG24;
-
-            if (!(number & INT32_MASK))
-                return LONG32;
-
-            if (!(number & INT40_MASK))
-                return LONG40;
-
-            if (!(number & INT48_MASK))
-                return LONG48;
-
-            if (!(number & INT56_MASK))
-                return LONG56;
-
-            return LONG64;
+            // + 1 => old marking; negative numbers take all four bytes
+            return (oldNumber < 0)
+                ? LONG32 + 1
+                : byteLength(uint32_t(oldNumber));
         }
+        return byteLength(number) - 1;
+    }
+
+    /** Write type byte and number of given type in one go.
+     */
+    template <typename Number_T>
+    inline void writeTyped(char type, const Number_T &number,
+                           unsigned int numType)
+    {
+        char *out = writer.reserve(1 + sizeof(number.data));
+        out[0] = type;
+        // copy all 8 bytes, unused ones get overwritten by next data
+        memcpy(out + 1, number.data, sizeof(number.data));
+        writer.commit(1 + getNumberSize(numType));
     }
 
     void packMagic();
 
     //vector<TypeStorage_t> vectEntity; //not used
-    Writer_t  &writer;
+    BufferedWriter_t writer;
     ProtocolVersion_t protocolVersion;
 };
 
@@ -206,7 +206,10 @@ public:
 
     void finish() {
         if (inputSize > 0) {
-            self.buffer.reserve(self.dataWanted);
+            // wanted size comes from the stream => don't trust it, buffer
+            // grows as the data really arrives
+            self.buffer.reserve(std::min<uint64_t>(self.dataWanted,
+                                                   BUFFER_SIZE));
             self.buffer.append(input, inputSize);
         }
     }
@@ -35,8 +35,8 @@
  *                  First draft.
  */
 
-#include <stdexcept>
 #include "frpccompare.h"
+#include <frpcvaluevisitor.h>
 
 namespace FRPC {
 
@@ -100,24 +100,6 @@ static int compareValue(const Value_T &lhs, const Value_T &rhs) {
         : ((rhs < lhs)? 1: 0);
 }
 
-template <typename Value_T>
-static int compareValue(const Value_t &lhs, const Value_t &rhs) {
-    const Value_T &lhsc = static_cast<const Value_T&>(lhs);
-    const Value_T &rhsc = static_cast<const Value_T&>(rhs);
-    return (lhsc.getValue() < rhsc.getValue())? -1
-        : ((rhsc.getValue() < lhsc.getValue())? 1: 0);
-}
-
-template <>
-int compareValue<FRPC::DateTime_t>(const FRPC::Value_t &lhs,
-                                   const FRPC::Value_t &rhs)
-{
-    const DateTime_t &lhsc = static_cast<const DateTime_t&>(lhs);
-    const DateTime_t &rhsc = static_cast<const DateTime_t&>(rhs);
-    return (lhsc.getUnixTime() < rhsc.getUnixTime())? -1
-        : ((rhsc.getUnixTime() < lhsc.getUnixTime())? 1: 0);
-}
-
 static int compare(const FRPC::Struct_t &lhs, const FRPC::Struct_t &rhs) {
     FRPC::Struct_t::const_iterator ilhs = lhs.begin();
     FRPC::Struct_t::const_iterator irhs = rhs.begin();
@@ -153,34 +135,74 @@ static int compare(const FRPC::Array_t &lhs, const FRPC::Array_t &rhs) {
     return 0;
 }
 
+namespace {
+
+/** Compares visited value with right operand of the same type.
+ */
+class CompareVisitor_t : public ValueVisitor_t {
+public:
+    explicit CompareVisitor_t(const Value_t &rhs) : rhs(rhs), result(0) {}
+
+    virtual void visit(const Int_t &lhs) {
+        result = compareValue(lhs.getValue(), other(lhs).getValue());
+    }
+
+    virtual void visit(const Bool_t &lhs) {
+        result = compareValue(lhs.getValue(), other(lhs).getValue());
+    }
+
+    virtual void visit(const Double_t &lhs) {
+        result = compareValue(lhs.getValue(), other(lhs).getValue());
+    }
+
+    virtual void visit(const String_t &lhs) {
+        result = compareValue(lhs.getValue(), other(lhs).getValue());
+    }
+
+    virtual void visit(const Binary_t &lhs) {
+        result = compareValue(lhs.getValue(), other(lhs).getValue());
+    }
+
+    virtual void visit(const DateTime_t &lhs) {
+        result = compareValue(lhs.getUnixTime(), other(lhs).getUnixTime());
+    }
+
+    virtual void visit(const Struct_t &lhs) {
+        result = compare(lhs, other(lhs));
+    }
+
+    virtual void visit(const Array_t &lhs) {
+        result = compare(lhs, other(lhs));
+    }
+
+    virtual void visit(const Null_t &) {
+        result = 0;
+    }
+
+    int get() const {
+        return result;
+    }
+
+private:
+    template <typename Value_T>
+    const Value_T& other(const Value_T &) const {
+        return static_cast<const Value_T&>(rhs);
+    }
+
+    const Value_t &rhs;
+    int result;
+};
+
+} // namespace
+
 int compare(const FRPC::Value_t &lhs, const FRPC::Value_t &rhs) {
     // compare the type
     if (int res = compareValue(lhs.getType(), rhs.getType())) return res;
 
     // compare the value
-    switch (lhs.getType()) {
-    case FRPC::Bool_t::TYPE:
-        return compareValue<FRPC::Bool_t>(lhs, rhs);
-    case FRPC::Int_t::TYPE:
-        return compareValue<FRPC::Int_t>(lhs, rhs);
-    case FRPC::Double_t::TYPE:
-        return compareValue<FRPC::Double_t>(lhs, rhs);
-    case FRPC::String_t::TYPE:
-        return compareValue<FRPC::String_t>(lhs, rhs);
-    case FRPC::Binary_t::TYPE:
-        return compareValue<FRPC::Binary_t>(lhs, rhs);
-    case FRPC::DateTime_t::TYPE:
-        return compareValue<FRPC::DateTime_t>(lhs, rhs);
-    case FRPC::Struct_t::TYPE:
-        return compare(FRPC::Struct(lhs), FRPC::Struct(rhs));
-    case FRPC::Array_t::TYPE:
-        return compare(FRPC::Array(lhs), FRPC::Array(rhs));
-    case FRPC::Null_t::TYPE:
-        return 0;
-    default:
-        break;
-    }
-    throw std::runtime_error("FRPC::compare(lhs, rhs)");
+    CompareVisitor_t visitor(rhs);
+    lhs.accept(visitor);
+    return visitor.get();
 }
 
 } // namespace FRPC
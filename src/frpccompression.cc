@@ -0,0 +1,329 @@
+/*
+ * FastRPC -- Fast RPC library compatible with XML-RPC
+ * Copyright (C) 2005-7  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Radlicka 2, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:fastrpc@firma.seznam.cz
+ *
+ *
+ * FILE          $Id$
+ *
+ * DESCRIPTION   HTTP body compression (gzip/deflate content coding)
+ *
+ * AUTHOR
+ *
+ * HISTORY
+ *
+ */
+#include "frpccompression.h"
+
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <zlib.h>
+
+#include <frpcunmarshaller.h>
+#include <frpcstreamerror.h>
+#include <frpcprotocolerror.h>
+#include <frpchttp.h>
+
+namespace FRPC {
+
+namespace {
+    /** Size of the compressor/decompressor output buffer.
+     */
+    const unsigned int ZBUFFER_SIZE = 1 << 14;
+
+    /** Window bits passed to zlib: gzip wrapper for GZIP, zlib wrapper
+     *  for DEFLATE (RFC 7230 "deflate" is zlib format).
+     */
+    int windowBits(Compression_t::Type_t type) {
+        return (type == Compression_t::GZIP) ? (MAX_WBITS + 16) : MAX_WBITS;
+    }
+
+    /** Trim whitespace around [begin, end).
+     */
+    std::string trim(const std::string &str, std::string::size_type begin,
+                     std::string::size_type end)
+    {
+        while ((begin < end) && isspace(str[begin])) ++begin;
+        while ((end > begin) && isspace(str[end - 1])) --end;
+        return str.substr(begin, end - begin);
+    }
+} // namespace
+
+const unsigned int Compression_t::DEFAULT_THRESHOLD;
+
+bool Compression_t::parse(const std::string &encoding_, Type_t &type) {
+    std::string encoding(trim(encoding_, 0, encoding_.size()));
+    if (encoding.empty() || !strcasecmp(encoding.c_str(), "identity")) {
+        type = NONE;
+    } else if (!strcasecmp(encoding.c_str(), "gzip")
+               || !strcasecmp(encoding.c_str(), "x-gzip"))
+    {
+        type = GZIP;
+    } else if (!strcasecmp(encoding.c_str(), "deflate")) {
+        type = DEFLATE;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+Compression_t::Type_t Compression_t::negotiate(const std::string &accept) {
+    bool gzip = false;
+    bool deflate = false;
+
+    // walk through comma separated list of "coding[;q=value]" items
+    for (std::string::size_type pos = 0; pos < accept.size(); ) {
+        std::string::size_type end = accept.find(',', pos);
+        if (end == std::string::npos) end = accept.size();
+
+        std::string item(trim(accept, pos, end));
+        pos = end + 1;
+
+        double q = 1.0;
+        std::string::size_type semicolon = item.find(';');
+        if (semicolon != std::string::npos) {
+            std::string params(item.substr(semicolon + 1));
+            std::string::size_type qpos = params.find("q=");
+            if (qpos != std::string::npos)
+                q = strtod(params.c_str() + qpos + 2, 0);
+            item = trim(item, 0, semicolon);
+        }
+        if (q <= 0.0) continue;
+
+        if (!strcasecmp(item.c_str(), "gzip")
+            || !strcasecmp(item.c_str(), "x-gzip")
+            || (item == "*"))
+        {
+            gzip = true;
+        } else if (!strcasecmp(item.c_str(), "deflate")) {
+            deflate = true;
+        }
+    }
+
+    return gzip ? GZIP : (deflate ? DEFLATE : NONE);
+}
+
+const char* Compression_t::name(Type_t type) {
+    switch (type) {
+    case GZIP:
+        return "gzip";
+    case DEFLATE:
+        return "deflate";
+    case NONE:
+    default:
+        return "identity";
+    }
+}
+
+const char* Compression_t::accepted() {
+    return "gzip, deflate";
+}
+
+struct CompressingWriter_t::Stream_t {
+    Stream_t() : type(Compression_t::NONE) {
+        memset(&z, 0, sizeof(z));
+    }
+
+    z_stream z;
+    Compression_t::Type_t type;
+};
+
+CompressingWriter_t::CompressingWriter_t(Writer_t &target)
+    : target(target), type(Compression_t::NONE),
+      threshold(Compression_t::DEFAULT_THRESHOLD), compressing(false),
+      stream(0)
+{}
+
+CompressingWriter_t::~CompressingWriter_t() {
+    if (stream) {
+        deflateEnd(&stream->z);
+        delete stream;
+    }
+}
+
+void CompressingWriter_t::reset(Compression_t::Type_t type_,
+                                unsigned int threshold_)
+{
+    type = type_;
+    threshold = threshold_;
+    compressing = false;
+    pending.erase();
+}
+
+void CompressingWriter_t::write(const char *data, unsigned int size) {
+    if (compressing) {
+        deflate(data, size, false);
+        return;
+    }
+
+    if (type == Compression_t::NONE) {
+        target.write(data, size);
+        return;
+    }
+
+    // hold data back until we know the payload is big enough
+    pending.append(data, size);
+    if (pending.size() < threshold) return;
+
+    // gzip and deflate need different wrappers => reinit on coding change
+    if (stream && (stream->type != type)) {
+        deflateEnd(&stream->z);
+        delete stream;
+        stream = 0;
+    }
+
+    // (re)initialize compressor for the payload
+    if (!stream) {
+        stream = new Stream_t();
+        stream->type = type;
+        if (deflateInit2(&stream->z, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+                         windowBits(type), 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        {
+            delete stream;
+            stream = 0;
+            throw StreamError_t("Cannot initialize compressor.");
+        }
+    } else if (deflateReset(&stream->z) != Z_OK) {
+        throw StreamError_t("Cannot reset compressor.");
+    }
+
+    compressing = true;
+    deflate(pending.data(), pending.size(), false);
+    pending.erase();
+}
+
+void CompressingWriter_t::flush() {
+    // keep encoding() valid until reset(), target may need it in flush()
+    if (compressing) {
+        deflate(0, 0, true);
+    } else if (!pending.empty()) {
+        // small payload => send as is
+        target.write(pending.data(), pending.size());
+        pending.erase();
+    }
+
+    target.flush();
+}
+
+void CompressingWriter_t::deflate(const char *data, unsigned int size,
+                                  bool finish)
+{
+    char buffer[ZBUFFER_SIZE];
+    z_stream &z = stream->z;
+    z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    z.avail_in = size;
+
+    for (;;) {
+        z.next_out = reinterpret_cast<Bytef*>(buffer);
+        z.avail_out = sizeof(buffer);
+
+        int res = ::deflate(&z, finish ? Z_FINISH : Z_NO_FLUSH);
+        if ((res != Z_OK) && (res != Z_STREAM_END) && (res != Z_BUF_ERROR))
+            throw StreamError_t::format("Cannot compress data: <%d>.", res);
+
+        unsigned int produced = sizeof(buffer) - z.avail_out;
+        if (produced) target.write(buffer, produced);
+
+        if (finish) {
+            if (res == Z_STREAM_END) break;
+        } else if (!z.avail_in && z.avail_out) {
+            break;
+        }
+    }
+}
+
+struct Inflater_t::Stream_t {
+    Stream_t() {
+        memset(&z, 0, sizeof(z));
+    }
+
+    z_stream z;
+};
+
+Inflater_t::Inflater_t(Compression_t::Type_t type, long sizeLimit)
+    : type(type), sizeLimit(sizeLimit), inflatedSize(0), finished(false),
+      stream(new Stream_t())
+{
+    // +32 => zlib autodetects gzip/zlib wrapper
+    if (inflateInit2(&stream->z, MAX_WBITS + 32) != Z_OK) {
+        delete stream;
+        throw StreamError_t("Cannot initialize decompressor.");
+    }
+}
+
+Inflater_t::~Inflater_t() {
+    inflateEnd(&stream->z);
+    delete stream;
+}
+
+void Inflater_t::inflate(const char *data, unsigned int size,
+                         UnMarshaller_t &um, char dataType)
+{
+    char buffer[ZBUFFER_SIZE];
+    z_stream &z = stream->z;
+    z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    z.avail_in = size;
+
+    // ignore anything after the end of compressed stream
+    while (z.avail_in && !finished) {
+        z.next_out = reinterpret_cast<Bytef*>(buffer);
+        z.avail_out = sizeof(buffer);
+
+        int res = ::inflate(&z, Z_NO_FLUSH);
+        if ((res == Z_DATA_ERROR) && (type == Compression_t::DEFLATE)
+            && !inflatedSize && (z.total_in <= size))
+        {
+            // some peers send raw deflate data without zlib wrapper
+            inflateEnd(&z);
+            memset(&z, 0, sizeof(z));
+            if (inflateInit2(&z, -MAX_WBITS) != Z_OK)
+                throw StreamError_t("Cannot initialize decompressor.");
+            // do not fall back again
+            type = Compression_t::NONE;
+            z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+            z.avail_in = size;
+            continue;
+        }
+
+        if ((res != Z_OK) && (res != Z_STREAM_END) && (res != Z_BUF_ERROR))
+            throw StreamError_t::format("Cannot decompress content: <%d, %s>.",
+                                        res, z.msg ? z.msg : "");
+        finished = (res == Z_STREAM_END);
+
+        unsigned int produced = sizeof(buffer) - z.avail_out;
+        inflatedSize += produced;
+        if ((sizeLimit >= 0)
+            && (inflatedSize > static_cast<unsigned long>(sizeLimit)))
+        {
+            throw ProtocolError_t::format(
+                    HTTP_BODY_TOO_LONG, "Security limit exceeded: decompressed "
+                    "content is too large (%lu > %ld)", inflatedSize,
+                    sizeLimit);
+        }
+        if (produced) um.unMarshall(buffer, produced, dataType);
+
+        // no progress possible without more input
+        if ((res == Z_BUF_ERROR) && !produced) break;
+    }
+}
+
+};
@@ -0,0 +1,168 @@
+/*
+ * FastRPC -- Fast RPC library compatible with XML-RPC
+ * Copyright (C) 2005-7  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Radlicka 2, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:fastrpc@firma.seznam.cz
+ *
+ *
+ * FILE          $Id$
+ *
+ * DESCRIPTION   HTTP body compression (gzip/deflate content coding)
+ *
+ * AUTHOR
+ *
+ * HISTORY
+ *
+ */
+#ifndef FRPCFRPCCOMPRESSION_H
+#define FRPCFRPCCOMPRESSION_H
+
+#include <string>
+
+#include <frpcplatform.h>
+#include <frpcwriter.h>
+
+namespace FRPC {
+
+class UnMarshaller_t;
+
+/** HTTP content codings supported by the library.
+ */
+class FRPC_DLLEXPORT Compression_t {
+public:
+    enum Type_t { NONE = 0, DEFLATE = 1, GZIP = 2 };
+
+    /** Default size (bytes) below which payloads are sent uncompressed.
+     */
+    static const unsigned int DEFAULT_THRESHOLD = 1024;
+
+    /** Parse value of Content-Encoding header.
+     *
+     * @param encoding header value (empty and "identity" mean NONE)
+     * @param type parsed coding
+     * @return false when the coding is not supported
+     */
+    static bool parse(const std::string &encoding, Type_t &type);
+
+    /** Pick the best coding acceptable by the peer.
+     *
+     * @param acceptEncoding value of Accept-Encoding header
+     * @return GZIP or DEFLATE when accepted (gzip is preferred), else NONE
+     */
+    static Type_t negotiate(const std::string &acceptEncoding);
+
+    /** Name of the coding as used in HTTP headers.
+     */
+    static const char* name(Type_t type);
+
+    /** Value of Accept-Encoding header advertising supported codings.
+     */
+    static const char* accepted();
+};
+
+/** Writer decorator compressing the stream written to the target writer.
+ *
+ *  Data are held back until threshold bytes are written. Payloads which
+ *  are flushed before reaching the threshold are passed to the target
+ *  uncompressed, larger ones are compressed on the fly. The target must not
+ *  emit its Content-Encoding header before it receives the first data (use
+ *  encoding() then).
+ */
+class FRPC_DLLEXPORT CompressingWriter_t : public Writer_t {
+public:
+    CompressingWriter_t(Writer_t &target);
+
+    virtual ~CompressingWriter_t();
+
+    /** Start new payload.
+     *
+     * @param type coding to use, NONE passes everything through
+     * @param threshold payloads smaller than this are not compressed
+     */
+    void reset(Compression_t::Type_t type, unsigned int threshold);
+
+    /** Coding of data written to the target: NONE until the writer decides
+     *  to compress current payload. Stays valid after flush() until the next
+     *  reset().
+     */
+    Compression_t::Type_t encoding() const {
+        return compressing ? type : Compression_t::NONE;
+    }
+
+    virtual void write(const char *data, unsigned int size);
+
+    virtual void flush();
+
+private:
+    CompressingWriter_t(const CompressingWriter_t&);
+    CompressingWriter_t& operator=(const CompressingWriter_t&);
+
+    /** Feed data to compressor and pass its output to the target.
+     */
+    void deflate(const char *data, unsigned int size, bool finish);
+
+    struct Stream_t;
+
+    Writer_t &target;
+    Compression_t::Type_t type;
+    unsigned int threshold;
+    bool compressing;
+    std::string pending;
+    Stream_t *stream;
+};
+
+/** Streaming decompressor feeding the unmarshaller.
+ */
+class FRPC_DLLEXPORT Inflater_t {
+public:
+    /**
+     * @param type coding of incoming data
+     * @param sizeLimit max size of decompressed data (negative = unlimited)
+     */
+    Inflater_t(Compression_t::Type_t type, long sizeLimit = -1);
+
+    ~Inflater_t();
+
+    /** Decompress data and pass them to the unmarshaller.
+     */
+    void inflate(const char *data, unsigned int size, UnMarshaller_t &um,
+                 char dataType);
+
+    /** Size of decompressed data.
+     */
+    unsigned long inflated() const {
+        return inflatedSize;
+    }
+
+private:
+    Inflater_t(const Inflater_t&);
+    Inflater_t& operator=(const Inflater_t&);
+
+    struct Stream_t;
+
+    Compression_t::Type_t type;
+    long sizeLimit;
+    unsigned long inflatedSize;
+    bool finished;
+    Stream_t *stream;
+};
+
+};
+
+#endif
@@ -46,7 +46,8 @@ namespace FRPC {
     }
 
     LibConfig_t::LibConfig_t()
-    : m_validateDatetime(true), m_validateString(false), m_preallocatedArraySize(4) {
+    : m_validateDatetime(true), m_validateString(false), m_preallocatedArraySize(4),
+      m_sharedValues(false), m_sharedIntMin(-1), m_sharedIntMax(255) {
     }
 
     LibConfig_t::LibConfig_t(const std::string &cfgFn) {
@@ -57,6 +58,23 @@ namespace FRPC {
         return false;
     }
 
+    const unsigned long LibConfig_t::MAX_SHARED_INTS;
+
+    void LibConfig_t::setSharedValuesPolicy(bool enabled, long intMin,
+                                            long intMax)
+    {
+        // difference of unsigned values can't overflow
+        if ((intMax >= intMin) && (static_cast<unsigned long>(intMax)
+                                   - static_cast<unsigned long>(intMin)
+                                   >= MAX_SHARED_INTS))
+        {
+            throw std::invalid_argument("Too many shared integers");
+        }
+        m_sharedValues = enabled;
+        m_sharedIntMin = intMin;
+        m_sharedIntMax = intMax;
+    }
+
     LibConfig_t::LibConfig_t(const LibConfig_t&) {
         // Intentionaly left empty.
     }
@@ -105,6 +105,43 @@ namespace FRPC {
                 m_preallocatedArraySize = size;
             }
 
+            /**
+             * \brief Returns shared values policy
+             * \see m_sharedValues
+            **/
+            bool getSharedValuesPolicy() const {
+                return m_sharedValues;
+            }
+
+            /**
+             * \brief Max number of shared integers (one Int_t is allocated
+             *        for each of them)
+            **/
+            static const unsigned long MAX_SHARED_INTS = 4096;
+
+            /**
+             * \brief Sets shared values policy and range of shared integers
+             *
+             * Empty range (intMax < intMin) shares booleans only.
+             * \throw std::invalid_argument when the range has more than
+             *        MAX_SHARED_INTS values
+             * \see m_sharedValues
+            **/
+            void setSharedValuesPolicy(bool enabled, long intMin = -1,
+                                       long intMax = 255);
+
+            /**
+             * \brief Returns range of shared integers
+             * \see m_sharedValues
+            **/
+            long getSharedIntMin() const {
+                return m_sharedIntMin;
+            }
+
+            long getSharedIntMax() const {
+                return m_sharedIntMax;
+            }
+
         protected:
 
             // TODO: Add IPv6/IPv4 resolution policies
@@ -137,9 +174,27 @@ namespace FRPC {
             *
             * Positive number, that specifies number of preallocated
             * members in Array_t, default 4
+            *
+            * Not used any more: Array_t keeps up to Array_t::INLINE_SIZE
+            * items inline and decoders reserve exact size.
             **/
             unsigned long m_preallocatedArraySize;
 
+            /**
+            * \brief Toggles sharing of immutable values
+            *
+            * If true, Pool_t (and so TreeBuilder_t) returns process-wide
+            * shared instances for booleans and integers from
+            * m_sharedIntMin to m_sharedIntMax instead of allocating new
+            * ones. Such values are not owned by any pool; code relying on
+            * distinct addresses of equal values must not enable it. The
+            * range is taken when the first pool is created with the policy
+            * enabled. Default false.
+            **/
+            bool m_sharedValues;
+            long m_sharedIntMin;
+            long m_sharedIntMax;
+
             /**
             * \brief Default constructor
             *
@@ -40,6 +40,7 @@
 #include <ctype.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <time.h>
 
 #ifndef UNIX_PATH_MAX
 # define UNIX_PATH_MAX   108
@@ -54,7 +55,8 @@ using namespace FRPC;
 
 Connector_t::Connector_t(const URL_t &url, int connectTimeout,
                          bool keepAlive)
-    : url(url), connectTimeout(connectTimeout), keepAlive(keepAlive)
+    : url(url), connectTimeout(connectTimeout), keepAlive(keepAlive),
+      reused(false)
 {}
 
 Connector_t::~Connector_t() {}
@@ -267,6 +269,7 @@ void SimpleConnector_t::connectSocket(int &fd) {
 
         closeSocketIfPeerClosed(fd);
     }
+    reused = (fd > -1);
 
     // if open socket is not availabe open new one
     if (fd < 0) {
@@ -379,6 +382,7 @@ void SimpleConnectorIPv6_t::connectSocket(int &fd) {
 
         closeSocketIfPeerClosed(fd);
     }
+    reused = (fd > -1);
 
     // if open socket is not availabe open new one
     if (fd < 0) {
@@ -427,6 +431,273 @@ void SimpleConnectorIPv6_t::connectSocket(int &fd) {
     }
 }
 
+namespace {
+    /** Monotonic time in miliseconds.
+     */
+    int64_t monotonicMs() {
+#ifdef WIN32
+        return GetTickCount64();
+#else //WIN32
+        struct timespec ts;
+        ::clock_gettime(CLOCK_MONOTONIC, &ts);
+        return int64_t(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+#endif //WIN32
+    }
+
+    /** Close all sockets of pending attempts.
+     */
+    void closeAttempts(std::vector<pollfd> &attempts) {
+        for (std::vector<pollfd>::iterator iattempts = attempts.begin();
+             iattempts != attempts.end(); ++iattempts)
+            TEMP_FAILURE_RETRY(::close(iattempts->fd));
+        attempts.clear();
+    }
+} // namespace
+
+RacingConnector_t::RacingConnector_t(const URL_t &url, int connectTimeout,
+                                     bool keepAlive, int attemptDelay,
+                                     int dnsTtl, int failurePenalty)
+    : Connector_t(url, connectTimeout, keepAlive),
+      attemptDelay(attemptDelay), dnsTtl(dnsTtl),
+      failurePenalty(failurePenalty), addressesExpire(0)
+{}
+
+RacingConnector_t::~RacingConnector_t() {}
+
+void RacingConnector_t::resolve(int64_t now) {
+    if (!addresses.empty() && (now < addressesExpire)) return;
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+    hints.ai_flags = AI_ADDRCONFIG;
+
+    std::string host = url.host;
+    if (!host.empty() && (*host.begin() == '[') && (*host.rbegin() == ']')) {
+        host = host.substr(1, host.size() - 2);
+        hints.ai_family = AF_INET6;
+    }
+
+    char port[8] = {0};
+    snprintf(port, sizeof(port), "%u", url.port);
+
+    struct addrinfo *addrInfo = 0;
+    int errcode = getaddrinfo(host.c_str(), port, &hints, &addrInfo);
+    if (errcode != 0) {
+        // keep using stale addresses rather than failing the call
+        if (!addresses.empty()) {
+            addressesExpire = now + 1000;
+            return;
+        }
+        throw HTTPError_t::format(
+                HTTP_DNS, "Cannot resolve host '%s'('%s'): <%d, %s>.",
+                url.host.c_str(), host.c_str(), errcode,
+                gai_strerror(errcode));
+    }
+
+    // split addresses by family, keep resolver order inside each family
+    AddressList_t v6, v4;
+    bool v6First = (addrInfo->ai_family == AF_INET6);
+    for (struct addrinfo *ai = addrInfo; ai; ai = ai->ai_next) {
+        if (ai->ai_addrlen > sizeof(sockaddr_storage)) continue;
+        Address_t address;
+        memset(&address.addr, 0, sizeof(address.addr));
+        memcpy(&address.addr, ai->ai_addr, ai->ai_addrlen);
+        address.length = ai->ai_addrlen;
+        ((ai->ai_family == AF_INET6) ? v6 : v4).push_back(address);
+    }
+    freeaddrinfo(addrInfo);
+
+    // interleave families starting with the one preferred by resolver
+    const AddressList_t &first = v6First ? v6 : v4;
+    const AddressList_t &second = v6First ? v4 : v6;
+    addresses.clear();
+    for (AddressList_t::size_type i = 0;
+         (i < first.size()) || (i < second.size()); ++i)
+    {
+        if (i < first.size()) addresses.push_back(first[i]);
+        if (i < second.size()) addresses.push_back(second[i]);
+    }
+
+    addressesExpire = now + int64_t(dnsTtl) * 1000;
+}
+
+int RacingConnector_t::race(int64_t now) {
+    // healthy addresses first, penalized ones as the last resort
+    AddressList_t candidates;
+    AddressList_t penalized;
+    for (AddressList_t::const_iterator iaddresses = addresses.begin();
+         iaddresses != addresses.end(); ++iaddresses)
+    {
+        FailureMap_t::iterator ifailures = failures.find(iaddresses->key());
+        if (ifailures == failures.end()) {
+            candidates.push_back(*iaddresses);
+        } else if (ifailures->second <= now) {
+            failures.erase(ifailures);
+            candidates.push_back(*iaddresses);
+        } else {
+            penalized.push_back(*iaddresses);
+        }
+    }
+    candidates.insert(candidates.end(), penalized.begin(), penalized.end());
+
+    // pending attempts and indices of their addresses in candidates
+    std::vector<pollfd> attempts;
+    std::vector<AddressList_t::size_type> attemptAddresses;
+
+    int64_t deadline = (connectTimeout < 0) ? -1 : (now + connectTimeout);
+    int64_t nextStart = now;
+    AddressList_t::size_type next = 0;
+    int lastError = 0;
+
+    for (;;) {
+        now = monotonicMs();
+
+        // start next attempt when its time has come
+        if ((next < candidates.size()) && (now >= nextStart)) {
+            const Address_t &address = candidates[next];
+            int fd = ::socket(address.addr.ss_family, SOCK_STREAM, 0);
+            if (fd < 0) {
+                STRERROR_PRE();
+                closeAttempts(attempts);
+                throw HTTPError_t::format(
+                        HTTP_SYSCALL, "Cannot create socket: <%d, %s>.",
+                        ERRNO, STRERROR(ERRNO));
+            }
+
+            SocketCloser_t closer(fd);
+            setNonBlockingSocket(fd);
+            setNonDelayedSocket(fd);
+
+            if (TEMP_FAILURE_RETRY(::connect(
+                    fd, reinterpret_cast<const sockaddr*>(&address.addr),
+                    address.length)) == 0)
+            {
+                // connected immediately => we have a winner
+                closer.release();
+                closeAttempts(attempts);
+                failures.erase(address.key());
+                return fd;
+            }
+
+            switch (ERRNO) {
+            case EINPROGRESS:
+            case EALREADY:
+            case EWOULDBLOCK:
+                {
+                    // connection launched on the background
+                    pollfd pfd;
+                    pfd.fd = fd;
+                    pfd.events = POLLOUT;
+                    pfd.revents = 0;
+                    attempts.push_back(pfd);
+                    attemptAddresses.push_back(next);
+                    closer.release();
+                    nextStart = now + attemptDelay;
+                }
+                break;
+
+            default:
+                // refused at once => try next address immediately
+                lastError = ERRNO;
+                failures[address.key()] = now + int64_t(failurePenalty) * 1000;
+                nextStart = now;
+                break;
+            }
+
+            ++next;
+            continue;
+        }
+
+        // nothing left to wait for
+        if (attempts.empty() && (next >= candidates.size())) break;
+
+        if ((deadline >= 0) && (now >= deadline)) {
+            closeAttempts(attempts);
+            throw HTTPError_t::format(
+                    HTTP_SYSCALL, "Timeout while connecting to %s.",
+                    url.getUrl().c_str());
+        }
+
+        // wait until deadline or until the next attempt should start
+        int64_t wait = (deadline < 0) ? -1 : (deadline - now);
+        if (next < candidates.size()) {
+            int64_t untilNext = (nextStart > now) ? (nextStart - now) : 0;
+            if ((wait < 0) || (untilNext < wait)) wait = untilNext;
+        }
+
+        int ready = TEMP_FAILURE_RETRY(
+                ::poll(attempts.empty() ? 0 : &attempts[0], attempts.size(),
+                       int(wait)));
+        if (ready < 0) {
+            STRERROR_PRE();
+            closeAttempts(attempts);
+            throw HTTPError_t::format(
+                    HTTP_SYSCALL, "Cannot select on socket: <%d, %s>.",
+                    ERRNO, STRERROR(ERRNO));
+        }
+        if (!ready) continue;
+
+        now = monotonicMs();
+        for (std::vector<pollfd>::size_type i = 0; i < attempts.size(); ) {
+            if (!attempts[i].revents) {
+                ++i;
+                continue;
+            }
+
+            int status = 0;
+            socklen_t len = sizeof(status);
+            if (::getsockopt(attempts[i].fd, SOL_SOCKET, SO_ERROR,
+                             reinterpret_cast<char*>(&status), &len))
+                status = ERRNO;
+
+            const Address_t &address = candidates[attemptAddresses[i]];
+            if (!status) {
+                // winner => close the rest
+                int fd = attempts[i].fd;
+                attempts.erase(attempts.begin() + i);
+                closeAttempts(attempts);
+                failures.erase(address.key());
+                return fd;
+            }
+
+            // failed attempt => penalize it and start next one now
+            lastError = status;
+            failures[address.key()] = now + int64_t(failurePenalty) * 1000;
+            TEMP_FAILURE_RETRY(::close(attempts[i].fd));
+            attempts.erase(attempts.begin() + i);
+            attemptAddresses.erase(attemptAddresses.begin() + i);
+            nextStart = now;
+        }
+    }
+
+    STRERROR_PRE();
+    throw HTTPError_t::format(
+            HTTP_SYSCALL, "Cannot connect socket to %s: <%d, %s>.",
+            url.getUrl().c_str(), lastError, STRERROR(lastError));
+}
+
+void RacingConnector_t::connectSocket(int &fd) {
+    // check socket
+    if (!keepAlive && (fd > -1)) {
+        TEMP_FAILURE_RETRY(::close(fd));
+        fd = -1;
+    }
+
+    // check open socket whether the peer had not closed it
+    if (fd > -1) closeSocketIfPeerClosed(fd);
+    reused = (fd > -1);
+
+    // if open socket is not availabe open new one
+    if (fd < 0) {
+        int64_t now = monotonicMs();
+        resolve(now);
+        fd = race(now);
+    }
+}
+
 #ifndef WIN32
 
 SimpleConnectorUnix_t::SimpleConnectorUnix_t(const URL_t &url, int connectTimeout,
@@ -453,6 +724,7 @@ void SimpleConnectorUnix_t::connectSocket(int &fd) {
 
         closeSocketIfPeerClosed(fd);
     }
+    reused = (fd > -1);
 
     // if open socket is not availabe open new one
     if (fd < 0) {
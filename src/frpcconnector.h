@@ -36,6 +36,11 @@
 #include <frpcplatform.h>
 #include <frpchttp.h>
 
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+
 
 namespace FRPC {
 
@@ -62,10 +67,17 @@ public:
         return keepAlive;
     }
 
+    /** Whether last connectSocket() kept already open connection.
+     */
+    bool reusedConnection() const {
+        return reused;
+    }
+
 protected:
     URL_t url;
     int connectTimeout;
     bool keepAlive;
+    bool reused;
 
 private:
     Connector_t(const Connector_t&);
@@ -109,6 +121,77 @@ private:
     struct addrinfo *addrInfo;
 };
 
+/** Racing socket connector: resolves all addresses of the host (both IPv4
+ *  and IPv6 families, interleaved) and starts non-blocking connects to them
+ *  one after another, each attempt delayed by attemptDelay milliseconds
+ *  after the previous one (or immediately when the previous one fails). The
+ *  first established connection wins, the others are closed.
+ *
+ *  Resolved addresses are cached for dnsTtl seconds (stale addresses are
+ *  used when re-resolution fails). Addresses which failed to connect are
+ *  penalized for failurePenalty seconds: they are tried only after all
+ *  other addresses.
+ */
+class FRPC_DLLEXPORT RacingConnector_t : public Connector_t {
+public:
+    RacingConnector_t(const URL_t &url, int connectTimeout, bool keepAlive,
+                      int attemptDelay = 250, int dnsTtl = 60,
+                      int failurePenalty = 30);
+
+    virtual ~RacingConnector_t();
+
+    virtual void connectSocket(int &fd);
+
+private:
+    /** One resolved peer address.
+     */
+    struct Address_t {
+        sockaddr_storage addr;
+        socklen_t length;
+
+        /** Raw address bytes used as a key to the failure map.
+         */
+        std::string key() const {
+            return std::string(reinterpret_cast<const char*>(&addr), length);
+        }
+    };
+
+    typedef std::vector<Address_t> AddressList_t;
+    typedef std::map<std::string, int64_t> FailureMap_t;
+
+    /** Resolve host address when cache is empty or expired.
+     */
+    void resolve(int64_t now);
+
+    /** Open new connection racing all candidate addresses.
+     */
+    int race(int64_t now);
+
+    /** Delay between attempts in miliseconds.
+     */
+    int attemptDelay;
+
+    /** DNS cache TTL in seconds.
+     */
+    int dnsTtl;
+
+    /** Failed address penalty in seconds.
+     */
+    int failurePenalty;
+
+    /** Cached resolved addresses.
+     */
+    AddressList_t addresses;
+
+    /** Monotonic time (ms) when the cached addresses expire.
+     */
+    int64_t addressesExpire;
+
+    /** Penalty expiration (monotonic ms) of recently failed addresses.
+     */
+    FailureMap_t failures;
+};
+
 #ifndef WIN32
 
 /** Simple unix socket connector.
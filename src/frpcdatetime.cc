@@ -37,6 +37,7 @@
 #include "frpcdatetime.h"
 #include "frpcpool.h"
 #include "frpcconfig.h"
+#include "frpclocaltime.h"
 
 namespace FRPC {
 
@@ -49,21 +50,10 @@ DateTime_t::DateTime_t(short year, char month, char day,
       sec(sec), weekDay(weekDay), unixTime(unixTime), timeZone(timeZone)
 {
     if ( LibConfig_t::getInstance()->getDatetimeValidationPolicy() == true ) {
-        struct tm time_tm;
-        memset(&time_tm, 0, sizeof(tm));
-        time_tm.tm_year = year - 1900;
-        time_tm.tm_mon = month - 1;
-        time_tm.tm_mday = day;
-        time_tm.tm_hour = hour;
-        time_tm.tm_min = minute;
-        time_tm.tm_sec = sec;
-        time_tm.tm_isdst = -1; // we know nothing about daylight savings time
-        time_t time_l = mktime(&time_tm);
-        struct tm timeValid;
-        localtime_r(&time_l, &timeValid);
-
-        this->unixTime = time_l;
-        this->weekDay = timeValid.tm_wday;
+        // we know nothing about daylight savings time
+        this->unixTime = LocalZone_t::fromLocal(year, month, day,
+                                                hour, minute, sec);
+        this->weekDay = weekDayFromDays(daysFromCivil(year, month, day));
     }
 }
 
@@ -71,32 +61,17 @@ DateTime_t::DateTime_t(short year, char month, char day,
                        char hour, char min, char sec)
     : year(year), month(month), day(day), hour(hour), minute(min), sec(sec)
 {
-    struct tm time_tm;
-    memset(&time_tm, 0, sizeof(tm));
-    time_tm.tm_year = year - 1900;
-    time_tm.tm_mon = month - 1;
-    time_tm.tm_mday = day;
-    time_tm.tm_hour = hour;
-    time_tm.tm_min = minute;
-    time_tm.tm_sec = sec;
-    time_tm.tm_isdst = -1; // we know nothing about daylight savings time
-    time_t time_l = mktime(&time_tm);
-    struct tm timeValid;
-    localtime_r(&time_l, &timeValid);
-
-    unixTime = time_l;
-    weekDay = timeValid.tm_wday;
-#ifdef HAVE_ALTZONE
-    timeZone = (time_tm.tm_isdst > 0)? ::altzone: ::timezone;
-#else
-    timeZone = (time_tm.tm_isdst > 0)? ::timezone - 3600: ::timezone;
-#endif
+    int offset;
+    unixTime = LocalZone_t::fromLocal(year, month, day, hour, minute, sec,
+                                      &offset);
+    weekDay = weekDayFromDays(daysFromCivil(year, month, day));
+    timeZone = -offset;
 }
 
 DateTime_t::DateTime_t(const time_t &unixTime)
 {
     struct tm time_tm;
-    localtime_r(&unixTime, &time_tm);
+    timeZone = -LocalZone_t::toLocal(unixTime, time_tm);
     year = time_tm.tm_year + 1900;
     month = time_tm.tm_mon + 1;
     day = time_tm.tm_mday;
@@ -105,19 +80,13 @@ DateTime_t::DateTime_t(const time_t &unixTime)
     sec =  time_tm.tm_sec;
     weekDay =  time_tm.tm_wday;
     this->unixTime = unixTime;
-
-#ifdef HAVE_ALTZONE
-    timeZone = (time_tm.tm_isdst > 0)? ::altzone: ::timezone;
-#else
-    timeZone = (time_tm.tm_isdst > 0)? ::timezone - 3600: ::timezone;
-#endif
 }
 
 DateTime_t::DateTime_t(time_t unixTime, int timeZone)
     : timeZone(timeZone)
 {
     struct tm time_tm;
-    localtime_r(&unixTime, &time_tm);
+    LocalZone_t::toLocal(unixTime, time_tm);
     year = time_tm.tm_year + 1900;
     month = time_tm.tm_mon + 1;
     day = time_tm.tm_mday;
@@ -138,6 +107,7 @@ DateTime_t::DateTime_t(const struct tm &tm)
     minute = tm.tm_min;
     sec =  tm.tm_sec;
     weekDay = tm.tm_wday;
+    // caller may force tm_isdst, leave it on mktime
     this->unixTime = mktime(const_cast<struct tm *>(&tm));
 }
 
@@ -145,7 +115,7 @@ DateTime_t::DateTime_t()
 {
     time_t unix_time =  time(0);
     struct tm time_tm;
-    localtime_r(&unix_time, &time_tm);
+    timeZone = -LocalZone_t::toLocal(unix_time, time_tm);
     year = time_tm.tm_year + 1900;
     month = time_tm.tm_mon + 1;
     day = time_tm.tm_mday;
@@ -153,13 +123,7 @@ DateTime_t::DateTime_t()
     minute =  time_tm.tm_min;
     sec =  time_tm.tm_sec;
     weekDay =  time_tm.tm_wday;
-    this->unixTime = unixTime;
-
-#ifdef HAVE_ALTZONE
-    timeZone = (time_tm.tm_isdst > 0)? ::altzone: ::timezone;
-#else
-    timeZone = (time_tm.tm_isdst > 0)? ::timezone - 3600: ::timezone;
-#endif
+    this->unixTime = unix_time;
 }
 
 DateTime_t::DateTime_t(const std::string &isoFormat)
@@ -167,20 +131,10 @@ DateTime_t::DateTime_t(const std::string &isoFormat)
 {
     parseISODateTime(isoFormat.data(), isoFormat.size(), year, month, day, hour,
                      minute, sec, timeZone);
-    struct tm time_tm;
-    time_tm.tm_year = year - 1900;
-    time_tm.tm_mon = month - 1;
-    time_tm.tm_mday = day;
-    time_tm.tm_hour = hour;
-    time_tm.tm_min = minute;
-    time_tm.tm_sec = sec;
-    time_tm.tm_isdst = -1; // we know nothing about daylight savings time
-    time_t time_l = mktime(&time_tm);
-    struct tm timeValid;
-    localtime_r(&time_l, &timeValid);
-
-    this->unixTime =  time_l;
-    this->weekDay = timeValid.tm_wday;
+    // we know nothing about daylight savings time
+    this->unixTime = LocalZone_t::fromLocal(year, month, day,
+                                            hour, minute, sec);
+    this->weekDay = weekDayFromDays(daysFromCivil(year, month, day));
 }
 
 DateTime_t::DateTime_t(short year, char month, char day,
@@ -247,9 +201,9 @@ Value_t& FRPC::DateTime_t::clone(Pool_t &newPool) const
 }
 
 bool FRPC::DateTime_t::isSaveLightDay() const {
-    struct tm timeValid;
-    localtime_r(&unixTime, &timeValid);
-    return timeValid.tm_isdst;
+    bool dst;
+    LocalZone_t::offset(unixTime, &dst);
+    return dst;
 }
 
 }
@@ -37,6 +37,7 @@
 #include <string>
 
 #include <frpcvalue.h>
+#include <frpcvaluevisitor.h>
 
 namespace FRPC
 {
@@ -133,6 +134,15 @@ public:
         @param newPool is reference of Pool_t which is used for allocate objects
     */
     virtual Value_t& clone(Pool_t &newPool) const;
+
+    /**
+        @brief Dispatch this value to the visitor
+        @param visitor is reference to visitor
+    */
+    virtual void accept(ValueVisitor_t &visitor) const
+    {
+        visitor.visit(*this);
+    }
     /**
         @brief get iso format.
         @return iso format string
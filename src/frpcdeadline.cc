@@ -0,0 +1,66 @@
+/*
+ * FastRPC -- Fast RPC library compatible with XML-RPC
+ * Copyright (C) 2005-7  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Radlicka 2, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:fastrpc@firma.seznam.cz
+ *
+ * FILE          $Id$
+ *
+ * DESCRIPTION   Deadline of request being processed by current thread
+ *
+ * AUTHOR
+ *
+ * HISTORY
+ *
+ */
+#include "frpcdeadline.h"
+#include <frpcmetrics.h>
+
+namespace FRPC {
+
+namespace {
+
+#ifdef WIN32
+__declspec(thread) uint64_t currentDeadline = 0;
+#else //WIN32
+__thread uint64_t currentDeadline = 0;
+#endif //WIN32
+
+} // namespace
+
+uint64_t Deadline_t::get() {
+    return currentDeadline;
+}
+
+void Deadline_t::set(uint64_t deadline) {
+    currentDeadline = deadline;
+}
+
+long Deadline_t::remaining() {
+    if (!currentDeadline) return -1;
+    uint64_t now = Metrics_t::now();
+    if (now >= currentDeadline) return 0;
+    return long((currentDeadline - now) / 1000);
+}
+
+bool Deadline_t::expired() {
+    return currentDeadline && (Metrics_t::now() >= currentDeadline);
+}
+
+};
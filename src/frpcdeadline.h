@@ -0,0 +1,93 @@
+/*
+ * FastRPC -- Fast RPC library compatible with XML-RPC
+ * Copyright (C) 2005-7  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Radlicka 2, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:fastrpc@firma.seznam.cz
+ *
+ * FILE          $Id$
+ *
+ * DESCRIPTION   Deadline of request being processed by current thread
+ *
+ * AUTHOR
+ *
+ * HISTORY
+ *
+ */
+#ifndef FRPCFRPCDEADLINE_H
+#define FRPCFRPCDEADLINE_H
+
+#include <stdint.h>
+
+#include <frpcplatform.h>
+
+namespace FRPC {
+
+/** Deadline of the request the current thread works on.
+ *
+ *  Server_t sets it (from X-Frpc-Timeout request header) for the time the
+ *  handler runs, so handler can check remaining budget and ServerProxy_t
+ *  calls made from inside the handler pass the budget on downstream. The
+ *  deadline is absolute time of Metrics_t::now() clock (us), 0 means no
+ *  deadline.
+ */
+class FRPC_DLLEXPORT Deadline_t {
+public:
+    /** Deadline of current thread (0 = none).
+     */
+    static uint64_t get();
+
+    /** Set deadline of current thread (0 = none).
+     */
+    static void set(uint64_t deadline);
+
+    /** Remaining time in milliseconds, 0 when expired and -1 when there
+     *  is no deadline.
+     */
+    static long remaining();
+
+    /** True when deadline is set and has already passed.
+     */
+    static bool expired();
+};
+
+/** Set deadline of current thread while in scope, then restore the
+ *  previous one.
+ */
+class FRPC_DLLEXPORT DeadlineScope_t {
+public:
+    explicit DeadlineScope_t(uint64_t deadline)
+        : previous(Deadline_t::get())
+    {
+        Deadline_t::set(deadline);
+    }
+
+    ~DeadlineScope_t() {
+        Deadline_t::set(previous);
+    }
+
+private:
+    DeadlineScope_t(const DeadlineScope_t&);
+    DeadlineScope_t& operator=(const DeadlineScope_t&);
+
+    uint64_t previous;
+};
+
+};
+
+#endif
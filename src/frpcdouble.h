@@ -34,6 +34,7 @@
 #define FRPCDOUBLE_H
 
 #include <frpcvalue.h>
+#include <frpcvaluevisitor.h>
 
 namespace FRPC
 {
@@ -96,6 +97,15 @@ public:
         @param newPool is reference of Pool_t which is used for allocate objects
     */
     virtual Value_t& clone(Pool_t &newPool) const;
+
+    /**
+        @brief Dispatch this value to the visitor
+        @param visitor is reference to visitor
+    */
+    virtual void accept(ValueVisitor_t &visitor) const
+    {
+        visitor.visit(*this);
+    }
     ///static members
     static const Double_t &FRPC_ZERO;
 
@@ -100,6 +100,8 @@ namespace FRPC {
     const std::string HTTP_HEADER_CONTENT_TYPE("Content-Type");
     const std::string HTTP_HEADER_CONTENT_LENGTH("Content-Length");
     const std::string HTTP_HEADER_TRANSFER_ENCODING("Transfer-Encoding");
+    const std::string HTTP_HEADER_CONTENT_ENCODING("Content-Encoding");
+    const std::string HTTP_HEADER_ACCEPT_ENCODING("Accept-Encoding");
     const std::string HTTP_HEADER_REFERER("Referer");
     const std::string HTTP_HEADER_ACCEPT("Accept");
     const std::string HTTP_HEADER_USER_AGENT("User-Agent");
@@ -119,6 +121,7 @@ namespace FRPC {
     const std::string HTTP_HEADER_CACHE_PRAGMA("Pragma");
     const std::string HTTP_HEADER_ALLOW("Allow");
     const std::string HTTP_HEADER_X_FORWARDED_FOR("X-Forwarded-For");
+    const std::string HTTP_HEADER_X_FRPC_TIMEOUT("X-Frpc-Timeout");
     const std::string HTTP_ACCEPT_RANGES("Accept-Ranges");
     
     class FRPC_DLLEXPORT HTTPHeader_t {
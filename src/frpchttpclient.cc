@@ -124,7 +124,9 @@ HTTPClient_t::HTTPClient_t(HTTPIO_t &httpIO, URL_t &url,
     : httpIO(httpIO), url(url), connector(connector),
       headersSent(false), useChunks(false), supportedProtocols(XML_RPC),
       useProtocol(XML_RPC), contentLenght(0), connectionMustClose(false),
-      unmarshaller(0), useHTTP10(useHTTP10)
+      unmarshaller(0), useHTTP10(useHTTP10), compressor(*this),
+      requestEncoding(Compression_t::NONE), acceptCompressed(false),
+      contentReceived(0), reusedConnection(false), timeoutBudget(-1)
 {
     queryStorage.push_back(std::string());
     queryStorage.back().reserve(BUFFER_SIZE + HTTP_BALLAST);
@@ -171,6 +173,9 @@ void HTTPClient_t::readResponse(DataBuilder_t &builder) {
     SocketCloser_t closer(httpIO.socket());
     bool closeConnection = false;
 
+    // waiting for the status line is the (remote) handler phase
+    phases.enter(PhaseTimes_t::HANDLER);
+
     // read header
     try {
         // ln is line number
@@ -181,6 +186,7 @@ void HTTPClient_t::readResponse(DataBuilder_t &builder) {
 
             if (line.empty())
                 continue;
+            phases.enter(PhaseTimes_t::READ);
             // break request line down
             std::vector<std::string> header(httpIO.splitBySpace(line, 3));
             if (header.size() != 3) {
@@ -245,12 +251,29 @@ void HTTPClient_t::readResponse(DataBuilder_t &builder) {
         }
 
         DataSink_t data(*unmarshaller);
+        data.setPhaseTimes(&phases);
+
+        // compressed response?
+        std::string contentEncoding;
+        if (httpHead.get(HTTP_HEADER_CONTENT_ENCODING, contentEncoding) == 0) {
+            Compression_t::Type_t encoding;
+            if (!Compression_t::parse(contentEncoding, encoding)) {
+                throw StreamError_t::format("Unknown ContentEncoding '%s'",
+                                            contentEncoding.c_str());
+            }
+            data.setContentEncoding(encoding);
+        }
 
         // read body of response
         httpIO.readContent(httpHead, data, false);
+        contentReceived = data.written();
 
-        unmarshaller->finish();
+        {
+            PhaseScope_t decode(&phases, PhaseTimes_t::DECODE);
+            unmarshaller->finish();
+        }
         protocolVersion = unmarshaller->getProtocolVersion();
+        phases.stop();
 
         std::string connection;
         httpHead.get("Connection", connection);
@@ -276,6 +299,7 @@ void HTTPClient_t::readResponse(DataBuilder_t &builder) {
 
 
 void HTTPClient_t::sendRequest(bool last) {
+    PhaseScope_t write(&phases, PhaseTimes_t::WRITE);
     SocketCloser_t closer(httpIO.socket());
 
     std::string headerData;
@@ -303,6 +327,18 @@ void HTTPClient_t::sendRequest(bool last) {
 
         addHeader(os, HTTP_HEADER_ACCEPT, ACCEPTED);
 
+        if (acceptCompressed)
+            addHeader(os, HTTP_HEADER_ACCEPT_ENCODING, Compression_t::accepted());
+
+        if (compressor.encoding() != Compression_t::NONE) {
+            addHeader(os, HTTP_HEADER_CONTENT_ENCODING,
+                      Compression_t::name(compressor.encoding()));
+        }
+
+        // time the caller is going to wait for the response
+        if (timeoutBudget >= 0)
+            addHeader(os, HTTP_HEADER_X_FRPC_TIMEOUT, timeoutBudget);
+
         //append connection header
         addHeader(os, HTTP_HEADER_CONNECTION, (connector->getKeepAlive() ? KEEPALIVE : CLOSE));
 
@@ -331,6 +367,7 @@ void HTTPClient_t::sendRequest(bool last) {
         }
 
         connector->connectSocket(httpIO.socket());
+        reusedConnection = connector->reusedConnection();
 
         headerData = os.os.str();
     }
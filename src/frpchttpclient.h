@@ -40,6 +40,8 @@
 #include <frpctypeerror.h>
 #include <frpcunmarshaller.h>
 #include <frpcconnector.h>
+#include <frpccompression.h>
+#include <frpcphasetimes.h>
 #include <list>
 #include <frpc.h>
 #include <sstream>
@@ -59,24 +61,58 @@ class FRPC_DLLEXPORT DataSink_t {
 public:
     inline DataSink_t(UnMarshaller_t& um,
                       unsigned int type = UnMarshaller_t::TYPE_METHOD_RESPONSE)
-        : um(um),dataWritten(0), type(type)
+        : um(um),dataWritten(0), type(type), inflater(0), phases(0)
     {}
 
-    inline ~DataSink_t() {}
+    inline ~DataSink_t() {
+        delete inflater;
+    }
+
+    /** Decompress incoming data before they reach the unmarshaller.
+     *
+     * @param encoding content coding of the body
+     * @param sizeLimit max size of decompressed body (negative = unlimited)
+     */
+    inline void setContentEncoding(Compression_t::Type_t encoding,
+                                   long sizeLimit = -1)
+    {
+        delete inflater;
+        inflater = 0;
+        if (encoding != Compression_t::NONE)
+            inflater = new Inflater_t(encoding, sizeLimit);
+    }
+
+    /** Charge unmarshalling to the DECODE phase of given times.
+     */
+    inline void setPhaseTimes(PhaseTimes_t *phases) {
+        this->phases = phases;
+    }
 
     inline void write(const char *data, unsigned int size) {
-        um.unMarshall(data, size, static_cast<char>(type));
+        PhaseScope_t decode(phases, PhaseTimes_t::DECODE);
+        if (inflater) {
+            inflater->inflate(data, size, um, static_cast<char>(type));
+        } else {
+            um.unMarshall(data, size, static_cast<char>(type));
+        }
         dataWritten += size;
     }
 
+    /** Size of data read from the wire (compressed when encoded).
+     */
     inline unsigned int written() {
         return dataWritten;
     }
 
 private:
+    DataSink_t(const DataSink_t&);
+    DataSink_t& operator=(const DataSink_t&);
+
     UnMarshaller_t &um;
     unsigned int dataWritten;
     unsigned int type;
+    Inflater_t *inflater;
+    PhaseTimes_t *phases;
 };
 
 
@@ -93,9 +129,11 @@ public:
     /**
     * @brief says to HTTP Client  which protol be used to send request
     * @param contentType maybe  XML_RPC or BINARY_RPC
+    * @n Starts phase clock (see phaseTimes()).
     */
 
     inline void prepare(unsigned int contentType) {
+        phases.start(PhaseTimes_t::ENCODE);
         switch(contentType) {
         case XML_RPC:
             useProtocol = contentType;
@@ -113,6 +151,73 @@ public:
         }
     }
 
+    /**
+    * @brief sets HTTP body compression
+    * @param requestEncoding coding of request body (NONE = uncompressed)
+    * @param threshold requests smaller than threshold are not compressed
+    * @param acceptCompressed ask server for compressed response
+    */
+    inline void setCompression(Compression_t::Type_t requestEncoding,
+                               unsigned int threshold, bool acceptCompressed)
+    {
+        compressor.reset(requestEncoding, threshold);
+        this->requestEncoding = requestEncoding;
+        this->acceptCompressed = acceptCompressed;
+    }
+
+    /**
+    * @brief sets time budget sent to server in X-Frpc-Timeout header
+    * @param budget milliseconds the caller is going to wait for the
+    *        response, negative value sends no header
+    */
+    inline void setTimeoutBudget(long budget) {
+        timeoutBudget = budget;
+    }
+
+    /**
+    * @brief writer the marshaller should write request to
+    * @return compressing decorator or client itself
+    */
+    inline Writer_t& writer() {
+        if (requestEncoding == Compression_t::NONE) return *this;
+        return compressor;
+    }
+
+    /**
+    * @brief size of request body sent (after compression)
+    */
+    inline unsigned int bytesSent() const {
+        return contentLenght;
+    }
+
+    /**
+    * @brief size of response body received (before decompression)
+    */
+    inline unsigned int bytesReceived() const {
+        return contentReceived;
+    }
+
+    /**
+    * @brief whether the request went over kept-alive connection
+    */
+    inline bool connectionReused() const {
+        return reusedConnection;
+    }
+
+    /**
+    * @brief latency breakdown of the last call (valid after readResponse)
+    */
+    inline const PhaseTimes_t& phaseTimes() const {
+        return phases;
+    }
+
+    /**
+    * @brief protocol of the request
+    */
+    inline unsigned int requestProtocol() const {
+        return useProtocol;
+    }
+
     /**
     * @brief getting server support protocols from last response
     * @return maybe XML_RPC , BINARY_RPC or both
@@ -190,6 +295,14 @@ private:
     ProtocolVersion_t protocolVersion;
 
     std::ostringstream m_customRequestHeaders;
+
+    CompressingWriter_t compressor;
+    Compression_t::Type_t requestEncoding;
+    bool acceptCompressed;
+    unsigned int contentReceived;
+    bool reusedConnection;
+    long timeoutBudget;
+    PhaseTimes_t phases;
 };
 
 } // namespace FRPC
@@ -34,6 +34,7 @@
 #define FRPCINT_H
 
 #include <frpcvalue.h>
+#include <frpcvaluevisitor.h>
 #include <stdint.h>
 
 
@@ -102,6 +103,15 @@ public:
     */
     virtual Value_t& clone(Pool_t &newPool) const;
 
+    /**
+        @brief Dispatch this value to the visitor
+        @param visitor is reference to visitor
+    */
+    virtual void accept(ValueVisitor_t &visitor) const
+    {
+        visitor.visit(*this);
+    }
+
     ///staic
     static const Int_t &FRPC_ZERO;
     static const Int_t &FRPC_MINUS_ONE;
@@ -55,13 +55,13 @@
 namespace FRPC {
 namespace {
 
-inline void write(Writer_t &writer, const std::string &value) {
+inline void write(BufferedWriter_t &writer, const std::string &value) {
     if (!value.empty())
         writer.write(value.data(), value.size());
 }
 
 template <typename Context_t>
-inline bool dec(Context_t &ctx, Writer_t &writer) {
+inline bool dec(Context_t &ctx, BufferedWriter_t &writer) {
     if (ctx.empty()) return true;
     switch (ctx.back().second) {
     case 0:
@@ -89,33 +89,39 @@ std::string escape(unsigned int ch) {
     return os.str();
 }
 
-void quote(Writer_t &writer, const char *ipos, unsigned int size) {
+void quote(BufferedWriter_t &writer, const char *ipos, unsigned int size) {
     writer.write("\"", 1);
+    const char *run = ipos;
+    std::string control;
     for (const char *epos = ipos + size; ipos != epos; ++ipos) {
+        const char *escaped;
         switch (*ipos) {
         case '"':
-            writer.write("\\\"", 2);
+            escaped = "\\\"";
             break;
         case '\\':
-            writer.write("\\\\", 2);
+            escaped = "\\\\";
             break;
         case '\r':
-            writer.write("\\r", 2);
+            escaped = "\\r";
             break;
         case '\n':
-            writer.write("\\n", 2);
+            escaped = "\\n";
             break;
         case '\t':
-            writer.write("\\t", 2);
+            escaped = "\\t";
             break;
         default:
-            if (::iscntrl(*ipos)) {
-                writer.write(escape(*ipos).c_str(), 6);
-            } else {
-                writer.write(ipos, 1);
-            }
+            if (!::iscntrl(*ipos)) continue;
+            control = escape(*ipos);
+            escaped = control.c_str();
         }
+        // copy characters which need no escaping at once
+        writer.write(run, ipos - run);
+        writer.write(escaped, strlen(escaped));
+        run = ipos + 1;
     }
+    writer.write(run, ipos - run);
     writer.write("\"", 1);
 }
 
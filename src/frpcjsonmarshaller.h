@@ -44,10 +44,10 @@
 #include <utility>
 
 #include <frpcmarshaller.h>
+#include <frpcwriter.h>
 
 namespace FRPC {
 
-class Writer_t;
 class ProtocolVersion_t;
 
 /** 
@@ -82,12 +82,12 @@ public:
                               char min, char sec, char weekDay, time_t unixTime,
                               int tz);
 
-    void packNull();
+    virtual void packNull();
 
 private:
     enum State_t { ARRAY = ']', STRUCT = '}'};
 
-    Writer_t  &writer;                                  //!< output writer
+    BufferedWriter_t writer;                            //!< output writer
     std::vector<std::pair<State_t, unsigned int> > ctx; //!< ctx stack
 };
 
@@ -0,0 +1,217 @@
+/*
+ * FastRPC -- Fast RPC library compatible with XML-RPC
+ * Copyright (C) 2005-7  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Radlicka 2, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:fastrpc@firma.seznam.cz
+ *
+ *
+ * FILE          $Id$
+ *
+ * DESCRIPTION   Data builder enforcing security limits on decoded data
+ *
+ * AUTHOR
+ *
+ * HISTORY
+ *
+ */
+#include "frpclimitedbuilder.h"
+#include "frpclimiterror.h"
+#include "frpctreebuilder.h"
+#include "frpc.h"
+
+namespace FRPC {
+
+namespace {
+
+/** Estimated memory taken by struct member (map node and key). */
+const unsigned long MEMBER_OVERHEAD = sizeof(std::string) + 4 * sizeof(void*);
+
+} // namespace
+
+LimitedBuilder_t::LimitedBuilder_t(DataBuilder_t &builder,
+                                   const Limits_t &limits)
+    : builder(builder),
+      treeBuilder(dynamic_cast<TreeBuilder_t*>(&builder)),
+      nullBuilder(dynamic_cast<DataBuilderWithNull_t*>(&builder)),
+      limits(limits), depth(0), elements(0), poolBytes(0)
+{}
+
+LimitedBuilder_t::~LimitedBuilder_t() {}
+
+void LimitedBuilder_t::element(unsigned long bytes) {
+    ++elements;
+    if (limits.maxElements && (elements > limits.maxElements)) {
+        throw LimitError_t::format("Security limit exceeded: too many "
+                                   "elements (> %lu)", limits.maxElements);
+    }
+
+    allocate(bytes);
+}
+
+void LimitedBuilder_t::allocate(unsigned long bytes) {
+    poolBytes += bytes;
+    if (limits.maxPoolBytes && (poolBytes > limits.maxPoolBytes)) {
+        throw LimitError_t::format("Security limit exceeded: data too "
+                                   "large (> %lu bytes)",
+                                   limits.maxPoolBytes);
+    }
+}
+
+void LimitedBuilder_t::declared(unsigned long items,
+                                unsigned long itemBytes)
+{
+    if (limits.maxElements && (items > limits.maxElements - elements)) {
+        throw LimitError_t::format("Security limit exceeded: too many "
+                                   "elements (> %lu)", limits.maxElements);
+    }
+
+    if (limits.maxPoolBytes && itemBytes
+        && (items > (limits.maxPoolBytes - poolBytes) / itemBytes))
+    {
+        throw LimitError_t::format("Security limit exceeded: data too "
+                                   "large (> %lu bytes)",
+                                   limits.maxPoolBytes);
+    }
+}
+
+void LimitedBuilder_t::open() {
+    ++depth;
+    if (limits.maxDepth && (depth > limits.maxDepth)) {
+        throw LimitError_t::format("Security limit exceeded: nesting too "
+                                   "deep (> %u)", limits.maxDepth);
+    }
+}
+
+void LimitedBuilder_t::buildMethodResponse() {
+    builder.buildMethodResponse();
+}
+
+void LimitedBuilder_t::buildBinary(const char* data, unsigned int size) {
+    element(sizeof(Binary_t) + size);
+    builder.buildBinary(data, size);
+}
+
+void LimitedBuilder_t::buildBinary(const std::string &data) {
+    element(sizeof(Binary_t) + data.size());
+    builder.buildBinary(data);
+}
+
+void LimitedBuilder_t::buildBool(bool value) {
+    element(sizeof(Bool_t));
+    builder.buildBool(value);
+}
+
+void LimitedBuilder_t::buildDateTime(short year, char month, char day,
+                                     char hour, char minute, char sec,
+                                     char weekDay, time_t unixTime,
+                                     int timeZone)
+{
+    element(sizeof(DateTime_t));
+    builder.buildDateTime(year, month, day, hour, minute, sec, weekDay,
+                          unixTime, timeZone);
+}
+
+void LimitedBuilder_t::buildDouble(double value) {
+    element(sizeof(Double_t));
+    builder.buildDouble(value);
+}
+
+void LimitedBuilder_t::buildFault(int errNumber, const char* errMsg,
+                                  unsigned int size)
+{
+    builder.buildFault(errNumber, errMsg, size);
+}
+
+void LimitedBuilder_t::buildFault(int errNumber, const std::string &errMsg) {
+    builder.buildFault(errNumber, errMsg);
+}
+
+void LimitedBuilder_t::buildInt(Int_t::value_type value) {
+    element(sizeof(Int_t));
+    builder.buildInt(value);
+}
+
+void LimitedBuilder_t::buildMethodCall(const char* methodName,
+                                       unsigned int size)
+{
+    builder.buildMethodCall(methodName, size);
+}
+
+void LimitedBuilder_t::buildMethodCall(const std::string &methodName) {
+    builder.buildMethodCall(methodName);
+}
+
+void LimitedBuilder_t::buildString(const char* data, unsigned int size) {
+    element(sizeof(String_t) + size);
+    builder.buildString(data, size);
+}
+
+void LimitedBuilder_t::buildString(const std::string &data) {
+    element(sizeof(String_t) + data.size());
+    builder.buildString(data);
+}
+
+void LimitedBuilder_t::buildStructMember(const char *memberName,
+                                         unsigned int size)
+{
+    allocate(MEMBER_OVERHEAD + size);
+    builder.buildStructMember(memberName, size);
+}
+
+void LimitedBuilder_t::buildStructMember(const std::string &memberName) {
+    allocate(MEMBER_OVERHEAD + memberName.size());
+    builder.buildStructMember(memberName);
+}
+
+void LimitedBuilder_t::closeArray() {
+    if (depth) --depth;
+    builder.closeArray();
+}
+
+void LimitedBuilder_t::closeStruct() {
+    if (depth) --depth;
+    builder.closeStruct();
+}
+
+void LimitedBuilder_t::openArray(unsigned int numOfItems) {
+    open();
+    element(sizeof(Array_t) + numOfItems * sizeof(Value_t*));
+    declared(numOfItems, sizeof(Int_t));
+    builder.openArray(numOfItems);
+}
+
+void LimitedBuilder_t::openStruct(unsigned int numOfMembers) {
+    open();
+    element(sizeof(Struct_t));
+    declared(numOfMembers, sizeof(Int_t) + MEMBER_OVERHEAD);
+    builder.openStruct(numOfMembers);
+}
+
+void LimitedBuilder_t::buildNull() {
+    element(sizeof(Null_t));
+    if (treeBuilder) {
+        treeBuilder->buildNull();
+    } else if (nullBuilder) {
+        nullBuilder->buildNull();
+    } else {
+        throw StreamError_t("Builder doesn't support null");
+    }
+}
+
+}
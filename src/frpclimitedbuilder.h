@@ -0,0 +1,152 @@
+/*
+ * FastRPC -- Fast RPC library compatible with XML-RPC
+ * Copyright (C) 2005-7  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Radlicka 2, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:fastrpc@firma.seznam.cz
+ *
+ *
+ * FILE          $Id$
+ *
+ * DESCRIPTION   Data builder enforcing security limits on decoded data
+ *
+ * AUTHOR
+ *
+ * HISTORY
+ *
+ */
+#ifndef FRPCFRPCLIMITEDBUILDER_H
+#define FRPCFRPCLIMITEDBUILDER_H
+
+#include <frpcplatform.h>
+
+#include <frpcdatabuilder.h>
+
+namespace FRPC
+{
+
+class TreeBuilder_t;
+
+/**
+@brief Data builder checking security limits before passing events on
+
+Sits between the unmarshaller and the real builder. Every event is
+checked as it comes from the stream, so oversized request is rejected
+before it is fully read. Sizes of arrays and structs declared in the
+binary protocol are checked before their items arrive. Exceeded limit
+raises LimitError_t.
+*/
+class FRPC_DLLEXPORT LimitedBuilder_t : public DataBuilderWithNull_t
+{
+public:
+    /**
+        @brief Limits of decoded data, zero means unlimited
+    */
+    struct Limits_t {
+        Limits_t()
+            : maxDepth(0), maxElements(0), maxPoolBytes(0)
+        {}
+
+        Limits_t(unsigned int maxDepth, unsigned long maxElements,
+                 unsigned long maxPoolBytes)
+            : maxDepth(maxDepth), maxElements(maxElements),
+              maxPoolBytes(maxPoolBytes)
+        {}
+
+        /**
+            @brief Returns true if any limit is set
+        */
+        bool enabled() const {
+            return maxDepth || maxElements || maxPoolBytes;
+        }
+
+        ///@brief max nesting of arrays and structs
+        unsigned int maxDepth;
+        ///@brief max number of values (including containers)
+        unsigned long maxElements;
+        ///@brief max (estimated) memory allocated in Pool_t for values
+        unsigned long maxPoolBytes;
+    };
+
+    /**
+        @brief Create limiting builder
+        @param builder builder receiving checked events
+        @param limits limits to enforce
+    */
+    LimitedBuilder_t(DataBuilder_t &builder, const Limits_t &limits);
+
+    virtual ~LimitedBuilder_t();
+
+    virtual void buildMethodResponse();
+    virtual void buildBinary(const char* data, unsigned int size);
+    virtual void buildBinary(const std::string &data);
+    virtual void buildBool(bool value);
+    virtual void buildDateTime(short year, char month, char day,char hour,
+                               char minute, char sec, char weekDay,
+                               time_t unixTime, int timeZone);
+    virtual void buildDouble(double value);
+    virtual void buildFault(int errNumber, const char* errMsg,
+                            unsigned int size);
+    virtual void buildFault(int errNumber, const std::string &errMsg);
+    virtual void buildInt(Int_t::value_type value);
+    virtual void buildMethodCall(const char* methodName, unsigned int size);
+    virtual void buildMethodCall(const std::string &methodName);
+    virtual void buildString(const char* data, unsigned int size);
+    virtual void buildString(const std::string &data);
+    virtual void buildStructMember(const char *memberName,
+                                   unsigned int size);
+    virtual void buildStructMember(const std::string &memberName);
+    virtual void closeArray();
+    virtual void closeStruct();
+    virtual void openArray(unsigned int numOfItems);
+    virtual void openStruct(unsigned int numOfMembers);
+    virtual void buildNull();
+
+private:
+    LimitedBuilder_t(const LimitedBuilder_t&);
+    LimitedBuilder_t& operator=(const LimitedBuilder_t&);
+
+    /**
+        @brief Account one value of given size and check limits
+    */
+    void element(unsigned long bytes);
+
+    /**
+        @brief Account memory of given size and check limits
+    */
+    void allocate(unsigned long bytes);
+
+    /**
+        @brief Check declared number of items of container
+    */
+    void declared(unsigned long items, unsigned long itemBytes);
+
+    void open();
+
+    DataBuilder_t &builder;
+    TreeBuilder_t *treeBuilder;
+    DataBuilderWithNull_t *nullBuilder;
+    Limits_t limits;
+    unsigned int depth;
+    unsigned long elements;
+    unsigned long poolBytes;
+};
+
+};
+
+#endif
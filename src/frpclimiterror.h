@@ -0,0 +1,59 @@
+/*
+ * FastRPC -- Fast RPC library compatible with XML-RPC
+ * Copyright (C) 2005-7  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Radlicka 2, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:fastrpc@firma.seznam.cz
+ *
+ *
+ * FILE          $Id$
+ *
+ * DESCRIPTION   Error raised when decoding exceeds configured limits
+ *
+ * AUTHOR
+ *
+ * HISTORY
+ *
+ */
+#ifndef FRPCFRPCLIMITERROR_H
+#define FRPCFRPCLIMITERROR_H
+
+#include <frpcstreamerror.h>
+
+namespace FRPC
+{
+
+/**
+@brief Security limit (depth, elements, size) exceeded while unmarshalling
+
+Derived from StreamError_t so code not aware of limits handles it as
+an invalid stream. Server_t reports it as FRPC_LIMIT_EXCEEDED_ERROR fault.
+*/
+class FRPC_DLLEXPORT LimitError_t : public StreamError_t
+{
+public:
+    LimitError_t(const std::string &msg) : StreamError_t(msg) {}
+
+    static LimitError_t format(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+    ~LimitError_t() throw();
+};
+
+};
+
+#endif
@@ -0,0 +1,452 @@
+/*
+ * FastRPC -- Fast RPC library compatible with XML-RPC
+ * Copyright (C) 2005-7  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Radlicka 2, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:fastrpc@firma.seznam.cz
+ *
+ *
+ * FILE          $Id$
+ *
+ * DESCRIPTION   Listening sockets and multi-threaded acceptor for Server_t
+ *
+ * AUTHOR
+ *
+ * HISTORY
+ *
+ */
+#include "frpclistener.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stddef.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <memory>
+
+#ifndef WIN32
+# include <sys/un.h>
+# include <pthread.h>
+#endif //WIN32
+
+#ifndef UNIX_PATH_MAX
+# define UNIX_PATH_MAX   108
+#endif
+
+#include "frpcsocket.h"
+#include "frpchttp.h"
+#include "frpchttperror.h"
+#include "frpcserver.h"
+
+namespace FRPC {
+
+namespace {
+    void closeSocket(int &fd) {
+        if (fd > -1) {
+            TEMP_FAILURE_RETRY(::close(fd));
+            fd = -1;
+        }
+    }
+
+    void throwSyscallError(const char *what) {
+        STRERROR_PRE();
+        throw HTTPError_t::format(HTTP_SYSCALL, "%s: <%d, %s>.",
+                                  what, ERRNO, STRERROR(ERRNO));
+    }
+} // namespace
+
+Listener_t::Listener_t(const std::string &address, int backlog,
+                       bool reusePort)
+    : fd(-1)
+{
+    URL_t url(address, std::string());
+
+#ifndef WIN32
+    // URL_t::isUnix() can't tell unix socket from TCP port 0 (ephemeral)
+    if (!strncasecmp(address.c_str(), "unix://", 7)) {
+        struct sockaddr_un local;
+        memset(&local, 0, sizeof(local));
+        if (url.path.size() >= sizeof(local.sun_path)) {
+            throw HTTPError_t::format(HTTP_SYSCALL,
+                                      "Unix socket path '%s' is too long.",
+                                      url.path.c_str());
+        }
+        local.sun_family = AF_UNIX;
+        strncpy(local.sun_path, url.path.c_str(), sizeof(local.sun_path) - 1);
+
+        // remove stale socket left by previous process
+        struct stat st;
+        if (!::stat(url.path.c_str(), &st) && S_ISSOCK(st.st_mode))
+            ::unlink(url.path.c_str());
+
+        if ((fd = ::socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+            throwSyscallError("Cannot create socket");
+
+        if ((::bind(fd, (struct sockaddr*)&local, sizeof(local)) < 0)
+            || (::listen(fd, backlog) < 0))
+        {
+            int error = ERRNO;
+            closeSocket(fd);
+            errno = error;
+            throwSyscallError("Cannot listen on unix socket");
+        }
+
+        unixPath = url.path;
+        return;
+    }
+#endif //WIN32
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+    hints.ai_flags = AI_PASSIVE;
+
+    std::string host = url.host;
+    if (!host.empty() && (*host.begin() == '[') && (*host.rbegin() == ']'))
+        host = host.substr(1, host.size() - 2);
+    if (host == "*") host.erase();
+
+    char port[8] = {0};
+    snprintf(port, sizeof(port), "%u", url.port);
+
+    struct addrinfo *addrInfo = 0;
+    int errcode = getaddrinfo(host.empty() ? 0 : host.c_str(), port, &hints,
+                              &addrInfo);
+    if (errcode != 0) {
+        throw HTTPError_t::format(
+                HTTP_DNS, "Cannot resolve host '%s': <%d, %s>.",
+                url.host.c_str(), errcode, gai_strerror(errcode));
+    }
+
+    // use the first address we can bind to
+    int error = 0;
+    for (struct addrinfo *ai = addrInfo; ai; ai = ai->ai_next) {
+        if ((fd = ::socket(ai->ai_family, SOCK_STREAM, 0)) < 0) {
+            error = ERRNO;
+            continue;
+        }
+
+        int optval = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR,
+                     (char*)&optval, sizeof(optval));
+        if (reusePort) {
+#ifdef SO_REUSEPORT
+            ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT,
+                         (char*)&optval, sizeof(optval));
+#endif //SO_REUSEPORT
+        }
+
+        if ((::bind(fd, ai->ai_addr, ai->ai_addrlen) == 0)
+            && (::listen(fd, backlog) == 0))
+            break;
+
+        error = ERRNO;
+        closeSocket(fd);
+    }
+    freeaddrinfo(addrInfo);
+
+    if (fd < 0) {
+        errno = error;
+        throwSyscallError("Cannot listen on TCP socket");
+    }
+}
+
+Listener_t::~Listener_t() {
+    closeSocket(fd);
+    if (!unixPath.empty())
+        ::unlink(unixPath.c_str());
+}
+
+unsigned short Listener_t::port() const {
+    struct sockaddr_storage addr;
+    socklen_t length = sizeof(addr);
+    if (!unixPath.empty()
+        || (::getsockname(fd, (struct sockaddr*)&addr, &length) != 0))
+        return 0;
+
+    switch (addr.ss_family) {
+    case AF_INET:
+        return ntohs(reinterpret_cast<struct sockaddr_in*>(&addr)->sin_port);
+    case AF_INET6:
+        return ntohs(
+                reinterpret_cast<struct sockaddr_in6*>(&addr)->sin6_port);
+    default:
+        return 0;
+    }
+}
+
+int Listener_t::accept(std::string &clientAddress) {
+    struct sockaddr_storage addr;
+    socklen_t length = sizeof(addr);
+
+    int client = TEMP_FAILURE_RETRY(
+            ::accept(fd, (struct sockaddr*)&addr, &length));
+    if (client < 0) {
+        switch (ERRNO) {
+        case EAGAIN:
+#if EAGAIN != EWOULDBLOCK
+        case EWOULDBLOCK:
+#endif
+        case ECONNABORTED:
+            // nothing to accept (connection stolen by another thread)
+            return -1;
+
+        default:
+            throwSyscallError("Cannot accept connection");
+        }
+    }
+
+    clientAddress = formatAddress((struct sockaddr*)&addr, length);
+    return client;
+}
+
+std::string Listener_t::formatAddress(const struct sockaddr *addr,
+                                      socklen_t length)
+{
+    char buffer[INET6_ADDRSTRLEN + 1] = {0};
+
+    if (!addr || (length < sizeof(addr->sa_family)))
+        return "unknown";
+
+    switch (addr->sa_family) {
+    case AF_INET:
+        {
+            const struct sockaddr_in *in
+                = reinterpret_cast<const struct sockaddr_in*>(addr);
+            if (inet_ntop(AF_INET, &in->sin_addr, buffer, sizeof(buffer)))
+                return buffer;
+        }
+        break;
+
+    case AF_INET6:
+        {
+            const struct sockaddr_in6 *in6
+                = reinterpret_cast<const struct sockaddr_in6*>(addr);
+            // dual stack socket: show IPv4 client as IPv4
+            if (IN6_IS_ADDR_V4MAPPED(&in6->sin6_addr)) {
+                if (inet_ntop(AF_INET, in6->sin6_addr.s6_addr + 12, buffer,
+                              sizeof(buffer)))
+                    return buffer;
+            } else if (inet_ntop(AF_INET6, &in6->sin6_addr, buffer,
+                                 sizeof(buffer)))
+            {
+                return buffer;
+            }
+        }
+        break;
+
+#ifndef WIN32
+    case AF_UNIX:
+        {
+            const struct sockaddr_un *un
+                = reinterpret_cast<const struct sockaddr_un*>(addr);
+            size_t offset = offsetof(struct sockaddr_un, sun_path);
+            if (length <= offset) return "unix:";
+            return "unix:" + std::string(
+                    un->sun_path, strnlen(un->sun_path, length - offset));
+        }
+#endif //WIN32
+
+    default:
+        break;
+    }
+
+    return "unknown";
+}
+
+std::string Listener_t::peerAddress(int fd) {
+    struct sockaddr_storage addr;
+    socklen_t length = sizeof(addr);
+    if (::getpeername(fd, (struct sockaddr*)&addr, &length) != 0)
+        return "unknown";
+    return formatAddress((struct sockaddr*)&addr, length);
+}
+
+#ifndef WIN32
+
+struct Acceptor_t::Thread_t {
+    Thread_t(Acceptor_t &acceptor, Listener_t &listener)
+        : acceptor(acceptor), listener(listener), started(false)
+    {}
+
+    Acceptor_t &acceptor;
+    Listener_t &listener;
+    pthread_t id;
+    bool started;
+};
+
+Acceptor_t::ServerFactory_t::~ServerFactory_t() {}
+
+Acceptor_t::Acceptor_t(const std::string &address, ServerFactory_t &factory,
+                       unsigned int threadCount, int backlog)
+    : factory(factory), running(false)
+{
+    if (!threadCount) threadCount = 1;
+
+    if (::pipe(stopPipe) < 0)
+        throwSyscallError("Cannot create pipe");
+
+    try {
+        // one listener per thread for TCP, shared one for unix socket
+        std::auto_ptr<Listener_t> first(
+                new Listener_t(address, backlog, threadCount > 1));
+        bool shared = first->isUnix();
+        listeners.push_back(first.get());
+        first.release();
+
+        // other threads must bind the ephemeral port of the first one
+        std::string boundAddress(address);
+        URL_t url(address, std::string());
+        if (!shared && !url.port) {
+            char port[8] = {0};
+            snprintf(port, sizeof(port), "%u", listeners.front()->port());
+            boundAddress = "http://" + url.host + ":" + port + "/";
+        }
+
+        while (!shared && (listeners.size() < threadCount)) {
+            std::auto_ptr<Listener_t> listener(
+                    new Listener_t(boundAddress, backlog, true));
+            listeners.push_back(listener.get());
+            listener.release();
+        }
+
+        // accept in non-blocking mode: other thread may take the connection
+        for (std::vector<Listener_t*>::iterator ilisteners = listeners.begin();
+             ilisteners != listeners.end(); ++ilisteners)
+        {
+            if (::fcntl((*ilisteners)->socket(), F_SETFL, O_NONBLOCK) < 0)
+                throwSyscallError("Cannot set socket non-blocking");
+        }
+
+        for (unsigned int i = 0; i < threadCount; ++i) {
+            threads.push_back(
+                    new Thread_t(*this, *listeners[i % listeners.size()]));
+        }
+    } catch (...) {
+        for (std::vector<Listener_t*>::iterator ilisteners = listeners.begin();
+             ilisteners != listeners.end(); ++ilisteners)
+            delete *ilisteners;
+        closeSocket(stopPipe[0]);
+        closeSocket(stopPipe[1]);
+        throw;
+    }
+}
+
+Acceptor_t::~Acceptor_t() {
+    stop();
+
+    for (std::vector<Thread_t*>::iterator ithreads = threads.begin();
+         ithreads != threads.end(); ++ithreads)
+        delete *ithreads;
+    for (std::vector<Listener_t*>::iterator ilisteners = listeners.begin();
+         ilisteners != listeners.end(); ++ilisteners)
+        delete *ilisteners;
+
+    closeSocket(stopPipe[0]);
+    closeSocket(stopPipe[1]);
+}
+
+void Acceptor_t::start() {
+    if (running) return;
+    running = true;
+
+    for (std::vector<Thread_t*>::iterator ithreads = threads.begin();
+         ithreads != threads.end(); ++ithreads)
+    {
+        if (pthread_create(&(*ithreads)->id, 0, &Acceptor_t::run, *ithreads)) {
+            stop();
+            throw HTTPError_t(HTTP_SYSCALL, "Cannot create accepting thread.");
+        }
+        (*ithreads)->started = true;
+    }
+}
+
+void Acceptor_t::stop() {
+    if (!running) return;
+
+    // wake up all threads, the byte stays in the pipe until they finish
+    char stopMark = 0;
+    TEMP_FAILURE_RETRY(::write(stopPipe[1], &stopMark, 1));
+
+    for (std::vector<Thread_t*>::iterator ithreads = threads.begin();
+         ithreads != threads.end(); ++ithreads)
+    {
+        if ((*ithreads)->started) {
+            pthread_join((*ithreads)->id, 0);
+            (*ithreads)->started = false;
+        }
+    }
+
+    // consume stop mark so we can start again
+    TEMP_FAILURE_RETRY(::read(stopPipe[0], &stopMark, 1));
+    running = false;
+}
+
+void* Acceptor_t::run(void *thread_) {
+    Thread_t *thread = static_cast<Thread_t*>(thread_);
+    try {
+        thread->acceptor.serve(thread->listener);
+    } catch (...) {
+        // nobody to report it to
+    }
+    return 0;
+}
+
+void Acceptor_t::serve(Listener_t &listener) {
+    std::auto_ptr<Server_t> server(factory.createServer());
+
+    pollfd pfd[2];
+    pfd[0].fd = stopPipe[0];
+    pfd[0].events = POLLIN;
+    pfd[1].fd = listener.socket();
+    pfd[1].events = POLLIN;
+
+    for (;;) {
+        pfd[0].revents = pfd[1].revents = 0;
+        if (TEMP_FAILURE_RETRY(::poll(pfd, 2, -1)) < 0)
+            throwSyscallError("Cannot poll listening socket");
+
+        // stop requested
+        if (pfd[0].revents) break;
+        if (!pfd[1].revents) continue;
+
+        std::string clientAddress;
+        int fd = listener.accept(clientAddress);
+        if (fd < 0) continue;
+
+        // accepted socket must block, server uses poll for timeouts
+        ::fcntl(fd, F_SETFL, 0);
+
+        try {
+            HTTPHeader_t headerIn;
+            HTTPHeader_t headerOut;
+            server->serve(fd, clientAddress, headerIn, headerOut);
+        } catch (const std::exception &) {
+            // connection is broken, go on with next one
+        }
+        closeSocket(fd);
+    }
+}
+
+#endif //WIN32
+
+};
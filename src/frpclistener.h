@@ -0,0 +1,181 @@
+/*
+ * FastRPC -- Fast RPC library compatible with XML-RPC
+ * Copyright (C) 2005-7  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Radlicka 2, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:fastrpc@firma.seznam.cz
+ *
+ *
+ * FILE          $Id$
+ *
+ * DESCRIPTION   Listening sockets and multi-threaded acceptor for Server_t
+ *
+ * AUTHOR
+ *
+ * HISTORY
+ *
+ */
+#ifndef FRPCFRPCLISTENER_H
+#define FRPCFRPCLISTENER_H
+
+#include <string>
+#include <vector>
+
+#include <frpcplatform.h>
+
+namespace FRPC {
+
+class Server_t;
+
+/** Listening socket.
+ *
+ *  Address is given in the same form as client URLs:
+ *  @n http://host:port/ -- TCP over IPv4 or IPv6 (host "*" or empty means
+ *  any address, IPv6 addresses are enclosed in brackets)
+ *  @n unix:///path/to/socket -- unix domain socket (stale socket file is
+ *  removed before bind and on destruction)
+ */
+class FRPC_DLLEXPORT Listener_t {
+public:
+    /**
+     * @param address address to bind to
+     * @param backlog listen queue length
+     * @param reusePort set SO_REUSEPORT so more listeners can share the
+     *        port and kernel balances connections among them (TCP only)
+     */
+    Listener_t(const std::string &address, int backlog = 128,
+               bool reusePort = false);
+
+    ~Listener_t();
+
+    /** Accept new connection. Waits when the socket is blocking.
+     *
+     * @param clientAddress address of the peer (see formatAddress)
+     * @return connected socket or -1 when listener is non-blocking and
+     *         there is nothing to accept
+     */
+    int accept(std::string &clientAddress);
+
+    /** Listening socket.
+     */
+    int socket() const {
+        return fd;
+    }
+
+    /** Whether it listens on unix domain socket.
+     */
+    bool isUnix() const {
+        return !unixPath.empty();
+    }
+
+    /** Port the TCP socket is bound to (the actual one when listening on
+     *  port 0), 0 for unix sockets.
+     */
+    unsigned short port() const;
+
+    /** Textual representation of socket address: IP address for TCP
+     *  (IPv4-mapped IPv6 addresses are shown as plain IPv4), "unix:" and
+     *  the path for unix sockets, "unknown" when not available.
+     */
+    static std::string formatAddress(const struct sockaddr *addr,
+                                     socklen_t length);
+
+    /** Address of the peer of connected socket.
+     */
+    static std::string peerAddress(int fd);
+
+private:
+    Listener_t(const Listener_t&);
+    Listener_t& operator=(const Listener_t&);
+
+    int fd;
+    std::string unixPath;
+};
+
+#ifndef WIN32
+
+/** Accepts connections in N threads and serves them with Server_t.
+ *
+ *  TCP listeners get one socket per thread bound with SO_REUSEPORT (kernel
+ *  spreads the connections among them), unix socket is shared by all
+ *  threads. When the address has port 0 all listeners share the ephemeral
+ *  port picked for the first one (see port()). Every thread has its own Server_t created by the factory since
+ *  Server_t is not thread safe.
+ */
+class FRPC_DLLEXPORT Acceptor_t {
+public:
+    /** Creates server for one accepting thread.
+     */
+    class FRPC_DLLEXPORT ServerFactory_t {
+    public:
+        virtual ~ServerFactory_t();
+
+        /** Called from the accepting thread; caller owns the result.
+         */
+        virtual Server_t* createServer() = 0;
+    };
+
+    /**
+     * @param address listening address (see Listener_t)
+     * @param factory creates servers for threads
+     * @param threads number of accepting threads
+     * @param backlog listen queue length
+     */
+    Acceptor_t(const std::string &address, ServerFactory_t &factory,
+               unsigned int threads = 1, int backlog = 128);
+
+    /** Stops and joins the threads.
+     */
+    ~Acceptor_t();
+
+    /** Start accepting threads.
+     */
+    void start();
+
+    /** Stop accepting; waits until all threads finish their connections.
+     */
+    void stop();
+
+    /** Port the listeners are bound to, 0 for unix sockets.
+     */
+    unsigned short port() const {
+        return listeners.front()->port();
+    }
+
+private:
+    Acceptor_t(const Acceptor_t&);
+    Acceptor_t& operator=(const Acceptor_t&);
+
+    struct Thread_t;
+
+    static void* run(void *thread);
+
+    void serve(Listener_t &listener);
+
+    ServerFactory_t &factory;
+    std::vector<Listener_t*> listeners;
+    std::vector<Thread_t*> threads;
+    int stopPipe[2];
+    bool running;
+};
+
+#endif // !WIN32
+
+};
+
+#endif
@@ -0,0 +1,218 @@
+/*
+ * FastRPC -- Fast RPC library compatible with XML-RPC
+ * Copyright (C) 2005-7  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Radlicka 2, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:fastrpc@firma.seznam.cz
+ *
+ *
+ * FILE          $Id$
+ *
+ * DESCRIPTION   Locale-free civil date arithmetic and cached local zone
+ *
+ * AUTHOR
+ *
+ * HISTORY
+ *
+ */
+#include "frpclocaltime.h"
+
+#include <string.h>
+
+namespace FRPC {
+
+namespace {
+
+const int64_t SECONDS_PER_DAY = 86400;
+const int64_t SECONDS_PER_HOUR = 3600;
+
+/** Cache entry of a day:
+ *  (day + DAY_BIAS) << 25 | (offset + OFFSET_BIAS) << 2 | unstable << 1 | dst;
+ *  zero means empty slot. Stable day has the same offset from the start of
+ *  previous day to the end of the next day, unstable one is near a zone
+ *  transition and its offsets are not cached.
+ */
+const unsigned int CACHE_SIZE = 4096;
+const int64_t OFFSET_BIAS = 1 << 20;
+const int64_t DAY_BIAS = int64_t(1) << 37;
+const uint64_t UNSTABLE = 2;
+
+uint64_t cache[CACHE_SIZE];
+
+inline int64_t floorDiv(int64_t value, int64_t divisor) {
+    int64_t result = value / divisor;
+    return ((value % divisor) < 0) ? result - 1 : result;
+}
+
+inline int64_t civilSeconds(int64_t year, int month, int day,
+                            int hour, int minute, int sec)
+{
+    return daysFromCivil(year, month, day) * SECONDS_PER_DAY
+        + int64_t(hour) * SECONDS_PER_HOUR + minute * 60 + sec;
+}
+
+/** Ask libc for the offset at given instant.
+ */
+int computeOffset(time_t utc, bool &dst) {
+    struct tm local;
+    memset(&local, 0, sizeof(local));
+    localtime_r(&utc, &local);
+    dst = local.tm_isdst > 0;
+    return int(civilSeconds(local.tm_year + 1900, local.tm_mon + 1,
+                            local.tm_mday, local.tm_hour, local.tm_min,
+                            local.tm_sec) - utc);
+}
+
+} // namespace
+
+int64_t daysFromCivil(int64_t year, int month, int day) {
+    // normalize month to 1-12
+    int64_t months = int64_t(month) - 1;
+    year += floorDiv(months, 12);
+    unsigned int m = unsigned(months - floorDiv(months, 12) * 12) + 1;
+
+    // days from 0000-03-01 (years start in March, leap day is the last one)
+    year -= (m <= 2);
+    int64_t era = floorDiv(year, 400);
+    unsigned int yoe = unsigned(year - era * 400);
+    unsigned int doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5;
+    unsigned int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + int64_t(doe) - 719468 + (day - 1);
+}
+
+void civilFromDays(int64_t days, int64_t &year, int &month, int &day) {
+    days += 719468;
+    int64_t era = floorDiv(days, 146097);
+    unsigned int doe = unsigned(days - era * 146097);
+    unsigned int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    unsigned int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned int mp = (5 * doy + 2) / 153;
+    day = int(doy - (153 * mp + 2) / 5 + 1);
+    month = int(mp < 10 ? mp + 3 : mp - 9);
+    year = int64_t(yoe) + era * 400 + (month <= 2);
+}
+
+namespace {
+
+/** Cache entry of the day containing given instant, 0 when the day is out
+ *  of cached range.
+ */
+uint64_t dayEntry(int64_t utc) {
+    int64_t day = floorDiv(utc, SECONDS_PER_DAY);
+    if ((day <= -DAY_BIAS) || (day >= DAY_BIAS)) return 0;
+
+    uint64_t key = uint64_t(day + DAY_BIAS);
+    uint64_t &slot = cache[key % CACHE_SIZE];
+    uint64_t entry = __sync_fetch_and_add(&slot, 0);
+    if ((entry >> 25) == key) return entry;
+
+    // zone transitions are months apart: equal offsets at the start of the
+    // previous and the next day mean no transition in between
+    bool dst, endDst;
+    int offset = computeOffset(time_t((day - 1) * SECONDS_PER_DAY), dst);
+    bool unstable = (computeOffset(time_t((day + 2) * SECONDS_PER_DAY),
+                                   endDst) != offset)
+        || (endDst != dst);
+    entry = (key << 25) | (uint64_t(offset + OFFSET_BIAS) << 2)
+        | (unstable ? UNSTABLE : 0) | dst;
+    __sync_lock_test_and_set(&slot, entry);
+    return entry;
+}
+
+inline int entryOffset(uint64_t entry) {
+    return int(int64_t((entry >> 2) & 0x7fffff) - OFFSET_BIAS);
+}
+
+} // namespace
+
+int LocalZone_t::offset(time_t utc, bool *dst) {
+    uint64_t entry = dayEntry(utc);
+    if (!entry || (entry & UNSTABLE)) {
+        bool isDst;
+        int result = computeOffset(utc, isDst);
+        if (dst) *dst = isDst;
+        return result;
+    }
+
+    if (dst) *dst = entry & 1;
+    return entryOffset(entry);
+}
+
+time_t LocalZone_t::fromLocal(int64_t year, int month, int day,
+                              int hour, int minute, int sec, int *offset)
+{
+    int64_t local = civilSeconds(year, month, day, hour, minute, sec);
+
+    // offset of stable day is valid within a day around, i.e. for every
+    // instant the local time can belong to
+    uint64_t entry = dayEntry(local);
+    int result;
+    if (entry && !(entry & UNSTABLE)) {
+        result = entryOffset(entry);
+    } else {
+        bool dst;
+        result = computeOffset(time_t(local - SECONDS_PER_DAY), dst);
+        int after = computeOffset(time_t(local + SECONDS_PER_DAY), dst);
+        if (after != result) {
+            // near transition: local time may exist once (use the valid
+            // offset), twice (use the earlier instant, as mktime does) or
+            // not at all (use the offset before, as mktime does)
+            bool beforeValid =
+                (computeOffset(time_t(local - result), dst) == result);
+            bool afterValid =
+                (computeOffset(time_t(local - after), dst) == after);
+            if (afterValid && (!beforeValid || (after > result)))
+                result = after;
+        }
+    }
+
+    if (offset) *offset = result;
+    return time_t(local - result);
+}
+
+int LocalZone_t::toLocal(time_t utc, struct tm &local) {
+    bool dst;
+    int result = offset(utc, &dst);
+    int64_t seconds = int64_t(utc) + result;
+    int64_t days = floorDiv(seconds, SECONDS_PER_DAY);
+    int secondOfDay = int(seconds - days * SECONDS_PER_DAY);
+
+    int64_t year;
+    int month, day;
+    civilFromDays(days, year, month, day);
+
+    memset(&local, 0, sizeof(local));
+    local.tm_year = int(year - 1900);
+    local.tm_mon = month - 1;
+    local.tm_mday = day;
+    local.tm_hour = secondOfDay / 3600;
+    local.tm_min = secondOfDay / 60 % 60;
+    local.tm_sec = secondOfDay % 60;
+    local.tm_wday = weekDayFromDays(days);
+    local.tm_yday = int(days - daysFromCivil(year, 1, 1));
+    local.tm_isdst = dst;
+    return result;
+}
+
+void LocalZone_t::reset() {
+    tzset();
+    for (unsigned int i = 0; i < CACHE_SIZE; ++i)
+        __sync_lock_test_and_set(&cache[i], 0);
+}
+
+};
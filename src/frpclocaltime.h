@@ -0,0 +1,99 @@
+/*
+ * FastRPC -- Fast RPC library compatible with XML-RPC
+ * Copyright (C) 2005-7  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Radlicka 2, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:fastrpc@firma.seznam.cz
+ *
+ *
+ * FILE          $Id$
+ *
+ * DESCRIPTION   Locale-free civil date arithmetic and cached local zone
+ *
+ * AUTHOR
+ *
+ * HISTORY
+ *
+ */
+#ifndef FRPCFRPCLOCALTIME_H
+#define FRPCFRPCLOCALTIME_H
+
+#include <stdint.h>
+#include <time.h>
+
+#include <frpcplatform.h>
+
+namespace FRPC {
+
+/** Days since 1970-01-01 of given date of proleptic Gregorian calendar.
+ *  Month out of 1-12 and day out of month range are normalized (as by
+ *  mktime).
+ */
+int64_t daysFromCivil(int64_t year, int month, int day);
+
+/** Date of given number of days since 1970-01-01.
+ */
+void civilFromDays(int64_t days, int64_t &year, int &month, int &day);
+
+/** Day of week (0 = Sunday) of given number of days since 1970-01-01.
+ */
+inline int weekDayFromDays(int64_t days) {
+    int weekDay = int((days + 4) % 7);
+    return (weekDay < 0) ? weekDay + 7 : weekDay;
+}
+
+/** Local timezone of the process.
+ *
+ *  UTC offsets are remembered per day in a lock-free table covering about
+ *  11 years of distinct days, so localtime_r() (which takes global lock in
+ *  libc) is called twice for a day not seen yet and then only for days
+ *  near a zone transition. Like localtime_r(), the table does not follow
+ *  changes of TZ environment variable; call reset() (instead of tzset())
+ *  after changing it.
+ */
+class FRPC_DLLEXPORT LocalZone_t {
+public:
+    /** Offset of local time from UTC in seconds (east positive) at given
+     *  instant.
+     *
+     * @param utc unix time
+     * @param dst set to daylight saving flag when not 0
+     */
+    static int offset(time_t utc, bool *dst = 0);
+
+    /** Local time to unix time, as mktime() with tm_isdst = -1.
+     *
+     * @param offset set to UTC offset (east positive) when not 0
+     */
+    static time_t fromLocal(int64_t year, int month, int day,
+                            int hour, int minute, int sec, int *offset = 0);
+
+    /** Unix time to local time, as localtime_r() (tm_gmtoff is not set).
+     *
+     * @return UTC offset (east positive)
+     */
+    static int toLocal(time_t utc, struct tm &local);
+
+    /** Reload the zone (tzset()) and forget cached offsets.
+     */
+    static void reset();
+};
+
+};
+
+#endif
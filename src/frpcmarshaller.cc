@@ -59,6 +59,10 @@ Marshaller_t* Marshaller_t::create(unsigned int contentType, Writer_t& writer,
         marshaller = new XmlMarshaller_t(writer,protocolVersion);
         break;
 
+    case XML_RPC_COMPACT:
+        marshaller = new XmlMarshaller_t(writer, protocolVersion, true);
+        break;
+
     case JSON:
         marshaller = new JSONMarshaller_t(writer,protocolVersion);
         break;
@@ -77,6 +81,10 @@ Marshaller_t* Marshaller_t::create(unsigned int contentType, Writer_t& writer,
     return marshaller;
 }
 
+void Marshaller_t::packNull() {
+    throw Error_t("This marshaller doesn't know how to pack null");
+}
+
 void Marshaller_t::packStructMember(const char* memberName) {
     unsigned int size = strlen(memberName);
     packStructMember(memberName, size);
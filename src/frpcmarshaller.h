@@ -51,7 +51,10 @@ struct  ProtocolVersion_t;
 class FRPC_DLLEXPORT Marshaller_t
 {
 public:
-    enum{ BINARY_RPC, XML_RPC, JSON, BASE64_RPC};
+    /** Content types; XML_RPC_COMPACT is XML-RPC without line breaks
+     *  and indentation.
+     */
+    enum{ BINARY_RPC, XML_RPC, JSON, BASE64_RPC, XML_RPC_COMPACT};
     /**
         @brief Default constructor
     */
@@ -150,6 +153,13 @@ public:
         or if created as XML using method XML(Xml-RPC)
     */
     virtual void packStruct(unsigned int numOfMembers) = 0;
+    /**
+        @brief Marshall a null value
+
+        Default implementation throws Error_t, marshallers supporting
+        null value override it.
+    */
+    virtual void packNull();
     /**
         @brief Marshall a fault message
         @param errNumber is error number
@@ -36,6 +36,10 @@
 #include <frpcmethod.h>
 #include <frpcdefaultmethod.h>
 #include <frpcheadmethod.h>
+#include <frpctypedmethod.h>
+#include <frpcstreammethod.h>
+#include <frpcadmission.h>
+#include <frpcsingleflight.h>
 #include <frpctreebuilder.h>
 #include <frpctreefeeder.h>
 #include <frpcunmarshaller.h>
@@ -46,6 +50,8 @@
 #include <frpckeyerror.h>
 #include <frpcindexerror.h>
 #include <frpcprotocolerror.h>
+#include <frpchttperror.h>
+#include <frpchttp.h>
 #include <frpc.h>
 #include <frpcinternals.h>
 #include <memory>
@@ -98,7 +104,8 @@ MethodRegistry_t::TimeDiff_t MethodRegistry_t::TimeDiff_t::diff()
 
 MethodRegistry_t::MethodRegistry_t(Callbacks_t *callbacks, bool introspectionEnabled)
         :callbacks(callbacks), introspectionEnabled(introspectionEnabled),
-        defaultMethod(0),headMethod(0)
+        defaultMethod(0),headMethod(0), metrics(0), unknownStats(0),
+        responseStream(0), admission(0), singleFlight(0)
 {
     if(introspectionEnabled)
     {
@@ -122,7 +129,8 @@ void MethodRegistry_t::registerMethod(const std::string &methodName, Method_t *m
 {
     typedef std::map<std::string, RegistryEntry_t> Map_t;
 
-    RegistryEntry_t entry(method, signature, help);
+    RegistryEntry_t entry(method, signature, help,
+                          metrics ? &metrics->method(methodName) : 0);
 
     // try to insert method
     std::pair<Map_t::iterator, bool>
@@ -134,6 +142,33 @@ void MethodRegistry_t::registerMethod(const std::string &methodName, Method_t *m
     }
 }
 
+void MethodRegistry_t::registerMethod(const std::string &methodName,
+                                      TypedMethod_t *method,
+                                      const std::string help)
+{
+    registerMethod(methodName, method, method->getSignature(), help);
+}
+
+void MethodRegistry_t::setMetrics(Metrics_t *metrics)
+{
+    this->metrics = metrics;
+    unknownStats = metrics ? &metrics->method("(unknown)") : 0;
+
+    if (metrics && introspectionEnabled
+        && (methodMap.find("system.stats") == methodMap.end()))
+    {
+        registerMethod("system.stats", boundMethod(&MethodRegistry_t::stats,
+                       *this), "S:,s:s", "Return call statistics");
+    }
+
+    // resolve stats of already registered methods
+    for (std::map<std::string, RegistryEntry_t>::iterator
+             i = methodMap.begin(); i != methodMap.end(); ++i)
+    {
+        i->second.stats = metrics ? &metrics->method(i->first) : 0;
+    }
+}
+
 void MethodRegistry_t::registerDefaultMethod(DefaultMethod_t *defaultMethod)
 {
     if(this->defaultMethod != 0)
@@ -163,10 +198,67 @@ namespace
 const long BUFFER_SIZE = 1<<16;
 }
 */
+
+namespace
+{
+
+/** Marshals items of streamed result as they come, freeing the item pool
+ *  after each of them.
+ */
+class MarshallingStream_t : public ResponseStream_t
+{
+public:
+    MarshallingStream_t(Marshaller_t &marshaller)
+        : ResponseStream_t(itemPool), marshaller(marshaller),
+          feeder(marshaller)
+    {}
+
+protected:
+    virtual void openArray(unsigned int numOfItems)
+    {
+        marshaller.packMethodResponse();
+        marshaller.packArray(numOfItems);
+    }
+
+    virtual void pushItem(const Value_t &item)
+    {
+        feeder.feedValue(item);
+        itemPool.free();
+    }
+
+private:
+    Pool_t itemPool;
+    Marshaller_t &marshaller;
+    TreeFeeder_t feeder;
+};
+
+/** Sets stream for top level call and resets it on the way out.
+ */
+class StreamScope_t
+{
+public:
+    StreamScope_t(ResponseStream_t *&current, ResponseStream_t *stream)
+        : current(current)
+    {
+        current = stream;
+    }
+
+    ~StreamScope_t()
+    {
+        current = 0;
+    }
+
+private:
+    ResponseStream_t *&current;
+};
+
+} // namespace
+
 int MethodRegistry_t::processCall(const std::string &clientIP, const std::string &methodName,
                                    Array_t &params,
                                    Writer_t &writer, unsigned int typeOut,
-                                   const ProtocolVersion_t &protocolVersion)
+                                   const ProtocolVersion_t &protocolVersion,
+                                   PhaseTimes_t *phases)
 {
     Pool_t pool;
     std::auto_ptr<Marshaller_t> marshaller(Marshaller_t::create(typeOut, writer,
@@ -175,14 +267,27 @@ int MethodRegistry_t::processCall(const std::string &clientIP, const std::string
 
     TreeFeeder_t feeder(*marshaller);
 
+    // stream methods marshal the result themselves
+    std::map<std::string, RegistryEntry_t>::const_iterator
+        pos = methodMap.find(methodName);
+    MarshallingStream_t stream(*marshaller);
+    bool streamed = (pos != methodMap.end())
+        && dynamic_cast<StreamMethod_t*>(pos->second.method);
+
     try
     {
 
-        Value_t &retValue = processCall(clientIP, methodName, params, pool);
-
+        Value_t *retValue;
+        {
+            PhaseScope_t handler(phases, PhaseTimes_t::HANDLER);
+            StreamScope_t scope(responseStream, streamed ? &stream : 0);
+            retValue = &processCall(clientIP, methodName, params, pool);
+        }
 
-        marshaller->packMethodResponse();
-        feeder.feedValue(retValue);
+        if (!stream.isOpened()) {
+            marshaller->packMethodResponse();
+            feeder.feedValue(*retValue);
+        }
         marshaller->flush();
 
     }
@@ -236,15 +341,86 @@ Value_t& MethodRegistry_t::processCall(const std::string &clientIP,
                                        const std::string &methodName,
                                        Array_t &params,
                                        Pool_t &pool)
+{
+    std::map<std::string, RegistryEntry_t>::const_iterator
+        pos = methodMap.find(methodName);
+    const RegistryEntry_t *entry = (pos == methodMap.end()) ? 0 : &pos->second;
+
+    if (!metrics)
+        return execute(clientIP, methodName, params, pool, entry);
+
+    Metrics_t::MethodStats_t &stats = entry ? *entry->stats : *unknownStats;
+    uint64_t start = Metrics_t::now();
+    try {
+        Value_t &result = execute(clientIP, methodName, params, pool, entry);
+        stats.record(Metrics_t::now() - start);
+        return result;
+    } catch (const Fault_t &fault) {
+        stats.record(Metrics_t::now() - start, true, fault.errorNum());
+        throw;
+    } catch (const HTTPError_t &httpError) {
+        // call refused by admission control with HTTP 503
+        stats.record(Metrics_t::now() - start, true,
+                     (httpError.errorNum() == HTTP_SERVICE_UNAVAILABLE)
+                     ? FRPC_REQUEST_REFUSED_ERROR : FRPC_INTERNAL_ERROR);
+        throw;
+    } catch (...) {
+        stats.record(Metrics_t::now() - start, true, FRPC_INTERNAL_ERROR);
+        throw;
+    }
+}
+
+/** Admitted dispatch of coalesced call.
+ */
+class MethodRegistry_t::FlightCall_t : public SingleFlight_t::Call_t {
+public:
+    FlightCall_t(MethodRegistry_t &registry, const std::string &clientIP,
+                 const std::string &methodName, Array_t &params,
+                 const RegistryEntry_t *entry)
+        : registry(registry), clientIP(clientIP), methodName(methodName),
+          params(params), entry(entry)
+    {}
+
+    virtual Value_t& operator()(Pool_t &pool) {
+        AdmissionControl_t::Ticket_t ticket(registry.admission, methodName);
+        return registry.dispatch(clientIP, methodName, params, pool, entry);
+    }
+
+private:
+    MethodRegistry_t &registry;
+    const std::string &clientIP;
+    const std::string &methodName;
+    Array_t &params;
+    const RegistryEntry_t *entry;
+};
+
+Value_t& MethodRegistry_t::execute(const std::string &clientIP,
+                                   const std::string &methodName,
+                                   Array_t &params, Pool_t &pool,
+                                   const RegistryEntry_t *entry)
+{
+    FlightCall_t call(*this, clientIP, methodName, params, entry);
+
+    // streamed response can't be shared
+    if (!singleFlight || responseStream || !singleFlight->covers(methodName))
+        return call(pool);
+
+    return singleFlight->call(
+            pool, SingleFlight_t::key(std::string(), methodName,
+                                      params.begin(), params.end()),
+            call);
+}
+
+Value_t& MethodRegistry_t::dispatch(const std::string &clientIP,
+                                    const std::string &methodName,
+                                    Array_t &params, Pool_t &pool,
+                                    const RegistryEntry_t *entry)
 {
     TimeDiff_t timeD;
     Value_t *result;
     try
     {
-        std::map<std::string, RegistryEntry_t>::const_iterator
-            pos = methodMap.find(methodName);
-
-        if (pos == methodMap.end()){
+        if (!entry){
             if (callbacks)
                 callbacks->preProcess(methodName, clientIP, params);
 
@@ -262,7 +438,11 @@ Value_t& MethodRegistry_t::processCall(const std::string &clientIP,
             if(callbacks)
                 callbacks->preProcess(methodName, clientIP, params);
 
-            result = &(pos->second.method->call(pool, params));
+            if (StreamMethod_t *method
+                    = dynamic_cast<StreamMethod_t*>(entry->method))
+                result = &streamCall(*method, params, pool);
+            else
+                result = &(entry->method->call(pool, params));
 
             // prepare deprecated warning
 
@@ -296,6 +476,33 @@ Value_t& MethodRegistry_t::processCall(const std::string &clientIP,
 
 }
 
+Value_t& MethodRegistry_t::streamCall(StreamMethod_t &method,
+                                      Array_t &params, Pool_t &pool)
+{
+    if (!responseStream)
+        return method.call(pool, params);
+
+    // nested calls (e.g. from the method itself) get collected result
+    ResponseStream_t &stream = *responseStream;
+    responseStream = 0;
+
+    try {
+        method.stream(params, stream);
+        stream.finish();
+    } catch (const ProtocolError_t &) {
+        throw;
+    } catch (...) {
+        if (!stream.isOpened())
+            throw;
+        // part of the response may be already sent, fault can't follow
+        throw ProtocolError_t(HTTP_INTERNAL_SERVER_ERROR,
+                              "Stream method failed after opening response");
+    }
+
+    // stands for the streamed result in Callbacks_t::postProcess()
+    return pool.Int(stream.size());
+}
+
 Value_t& MethodRegistry_t::processCall(const std::string &clientIP, Reader_t &reader,
                                        unsigned int typeIn, Pool_t &pool)
 {
@@ -536,9 +743,14 @@ Value_t& MethodRegistry_t::multicall(Pool_t &pool, Array_t &params)
         {
 
             Struct_t &strct = Struct(**pos);
+            const std::string &methodName
+                = String(strct["methodName"]).getString();
 
             std::map<std::string, RegistryEntry_t>::const_iterator pos =
-                methodMap.find(String(strct["methodName"]).getString());
+                methodMap.find(methodName);
+
+            // multicall holds the global slot, sub-call needs method one
+            AdmissionControl_t::Ticket_t ticket(admission, methodName, false);
 
             if (pos == methodMap.end()) {
                 //if default method registered call it
@@ -546,12 +758,11 @@ Value_t& MethodRegistry_t::multicall(Pool_t &pool, Array_t &params)
                     throw Fault_t::format(
                             FRPC_NO_SUCH_METHOD_ERROR,
                             "Method %s not found",
-                            String(strct["methodName"]).getString().c_str());
+                            methodName.c_str());
 
                 } else {
                     array.append(defaultMethod->call(
-                        pool, String(strct["methodName"]).getString(),
-                        Array(strct["params"])));
+                        pool, methodName, Array(strct["params"])));
                 }
 
             } else {
@@ -597,4 +808,26 @@ Value_t& MethodRegistry_t::multicall(Pool_t &pool, Array_t &params)
     return array;
 }
 
+Value_t& MethodRegistry_t::stats(Pool_t &pool, Array_t &params)
+{
+    if(params.size() > 1)
+        throw Fault_t::format(
+            FRPC_TYPE_ERROR,
+            "Method required 0 or 1 argument but %zd argumet(s) given",
+            params.size());
+
+    if (!metrics)
+        throw Fault_t(FRPC_INTROSPECTION_DISABLED_ERROR,
+                      "Statistics are not collected");
+
+    if (params.size() == 0)
+        return metrics->toValue(pool);
+
+    params.checkItems("s");
+    if (String(params[0]).getString() != "text")
+        throw Fault_t::format(FRPC_TYPE_ERROR, "Unknown format '%s'",
+                              String(params[0]).getString().c_str());
+    return pool.String(metrics->format());
+}
+
 }
@@ -36,6 +36,8 @@
 #include<map>
 #include<string>
 #include<frpcmethod.h>
+#include<frpcmetrics.h>
+#include<frpcphasetimes.h>
 
 #include "frpcsocket.h"
 
@@ -54,6 +56,11 @@ class Fault_t;
 class DefaultMethod_t;
 class HeadMethod_t;
 class Pool_t;
+class TypedMethod_t;
+class StreamMethod_t;
+class ResponseStream_t;
+class AdmissionControl_t;
+class SingleFlight_t;
 
 class FRPC_DLLEXPORT MethodRegistry_t {
 public:
@@ -71,13 +78,15 @@ public:
          };
 
     struct RegistryEntry_t {
-        RegistryEntry_t(Method_t* method, const std::string &signature,const std::string &help)
-                :method(method),signature(signature),help(help) {}
+        RegistryEntry_t(Method_t* method, const std::string &signature,const std::string &help,
+                        Metrics_t::MethodStats_t *stats = 0)
+                :method(method),signature(signature),help(help),stats(stats) {}
         ~RegistryEntry_t() {}
 
         Method_t *method;
         std::string signature;
         std::string help;
+        Metrics_t::MethodStats_t *stats;
     };
 
 
@@ -117,6 +126,10 @@ public:
 
         /**
         @brief this method was called after method call if status ok 
+
+        Result of StreamMethod_t streamed directly to the client is not
+        available any more; @p result is then Int_t holding the number of
+        streamed items (see ResponseStream_t::size()).
         */
         virtual void postProcess(const std::string &methodName, const std::string &clientIP,
                                  const Array_t &params,
@@ -129,6 +142,14 @@ public:
                                  const Array_t &params,
                                  const Fault_t &fault, const TimeDiff_t &time) = 0 ;
 
+        /**
+        @brief this method was called after response was sent, with latency
+        breakdown of whole request (see PhaseTimes_t)
+        */
+        virtual void postRequest(const std::string &methodName,
+                                 const std::string &clientIP,
+                                 const PhaseTimes_t &phases)
+        {}
 
         virtual ~Callbacks_t() {}
 
@@ -166,6 +187,15 @@ public:
                         const std::string signature = "",
                         const std::string help = "No help" );
     /**
+    @brief register method with typed parameters (see typedMethod())
+    @param methodName it is the method name in string
+    @param method it is the TypedMethod_t handler of method, signature is
+    taken from the handler
+    @param help  is method help as string
+    */
+    void registerMethod(const std::string &methodName, TypedMethod_t *method,
+                        const std::string help = "No help" );
+    /**
     @brief call head method on HTTP HEAD
     @return long 
     @li @b   0 -OK
@@ -183,7 +213,8 @@ public:
 
     int  processCall(const std::string &clientIP, const std::string &methodName,
                      Array_t &params, Writer_t &writer, unsigned int typeOut,
-                     const ProtocolVersion_t &protocolVersion);
+                     const ProtocolVersion_t &protocolVersion,
+                     PhaseTimes_t *phases = 0);
 
     Value_t& processCall(const std::string &clientIP, const std::string &methodName,
                          Array_t &params, Pool_t &pool);
@@ -191,6 +222,49 @@ public:
     Value_t& processCall(const std::string &clientIP, Reader_t &reader,
                          unsigned int typeIn,Pool_t &pool);
 
+    /**
+    @brief collect call statistics to given metrics (0 = off)
+    @n When introspection is enabled method system.stats is registered:
+    @li struct system.stats() - metrics as struct
+    @li string system.stats("text") - metrics in text exposition format
+    @param metrics metrics object, must outlive the registry; may be
+    shared by more registries
+    */
+    void setMetrics(Metrics_t *metrics);
+
+    Metrics_t* getMetrics() const {
+        return metrics;
+    }
+
+    /**
+    @brief limit concurrency of calls by given admission control (0 = off),
+    calls over the limit are refused by FRPC_REQUEST_REFUSED_ERROR
+    @param admission admission control, must outlive the registry; may be
+    shared by more registries
+    */
+    void setAdmission(AdmissionControl_t *admission) {
+        this->admission = admission;
+    }
+
+    AdmissionControl_t* getAdmission() const {
+        return admission;
+    }
+
+    /**
+    @brief run identical concurrent calls of methods covered by given
+    single flight only once (0 = off); callbacks are not called for calls
+    served by result of other call
+    @param singleFlight must outlive the registry; may be shared by more
+    registries
+    */
+    void setSingleFlight(SingleFlight_t *singleFlight) {
+        this->singleFlight = singleFlight;
+    }
+
+    SingleFlight_t* getSingleFlight() const {
+        return singleFlight;
+    }
+
     /**
     @brief register  default method which be call when method not found
     */
@@ -209,6 +283,15 @@ public:
         }
     }
 
+    void postRequestCallback(const std::string &methodName,
+                             const std::string &clientIP,
+                             const PhaseTimes_t &phases)
+    {
+        if (callbacks) {
+            callbacks->postRequest(methodName, clientIP, phases);
+        }
+    }
+
 
 private:
     //system methods
@@ -216,6 +299,19 @@ private:
     Value_t& methodHelp(Pool_t &pool, Array_t &params);
     Value_t& methodSignature(Pool_t &pool, Array_t &params);
     Value_t& multicall(Pool_t &pool, Array_t &params);
+    Value_t& stats(Pool_t &pool, Array_t &params);
+
+    class FlightCall_t;
+    friend class FlightCall_t;
+
+    Value_t& execute(const std::string &clientIP,
+                     const std::string &methodName, Array_t &params,
+                     Pool_t &pool, const RegistryEntry_t *entry);
+    Value_t& dispatch(const std::string &clientIP,
+                      const std::string &methodName, Array_t &params,
+                      Pool_t &pool, const RegistryEntry_t *entry);
+    Value_t& streamCall(StreamMethod_t &method, Array_t &params,
+                        Pool_t &pool);
 
 
     std::map<std::string, RegistryEntry_t> methodMap;
@@ -224,6 +320,11 @@ private:
     bool introspectionEnabled;
     DefaultMethod_t *defaultMethod;
     HeadMethod_t *headMethod;
+    Metrics_t *metrics;
+    Metrics_t::MethodStats_t *unknownStats;   //!< stats of not found methods
+    ResponseStream_t *responseStream;   //!< output of top level stream call
+    AdmissionControl_t *admission;
+    SingleFlight_t *singleFlight;
 };
 
 };
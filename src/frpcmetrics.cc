@@ -0,0 +1,333 @@
+/*
+ * FastRPC -- Fast RPC library compatible with XML-RPC
+ * Copyright (C) 2005-7  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Radlicka 2, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:fastrpc@firma.seznam.cz
+ *
+ *
+ * FILE          $Id$
+ *
+ * DESCRIPTION   Call, fault, latency and traffic metrics
+ *
+ * AUTHOR
+ *
+ * HISTORY
+ *
+ */
+#include "frpcmetrics.h"
+
+#include <time.h>
+#include <stdio.h>
+#include <limits>
+#include <sstream>
+#include <memory>
+
+#include <frpcpool.h>
+#include <frpcstruct.h>
+#include "frpcutils.h"
+
+#ifdef WIN32
+#include <windows.h>
+#endif //WIN32
+
+namespace FRPC {
+
+namespace {
+    const double QUANTILES[] = { 0.5, 0.9, 0.99, 0.999 };
+    const char *QUANTILE_NAMES[] = { "0.5", "0.9", "0.99", "0.999" };
+    const unsigned int QUANTILE_COUNT = sizeof(QUANTILES) / sizeof(double);
+
+    /** Escape label value for text exposition format.
+     */
+    std::string escapeLabel(const std::string &value) {
+        std::string result;
+        result.reserve(value.size());
+        for (std::string::const_iterator ivalue = value.begin();
+             ivalue != value.end(); ++ivalue)
+        {
+            switch (*ivalue) {
+            case '\\': result += "\\\\"; break;
+            case '"': result += "\\\""; break;
+            case '\n': result += "\\n"; break;
+            default: result += *ivalue; break;
+            }
+        }
+        return result;
+    }
+
+    /** Microseconds as seconds.
+     */
+    std::string seconds(uint64_t usec) {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%.6f", usec / 1000000.0);
+        return buffer;
+    }
+
+    Value_t& countValue(Pool_t &pool, uint64_t value) {
+        return pool.Int(static_cast<Int_t::value_type>(value));
+    }
+} // namespace
+
+unsigned int Metrics_t::Histogram_t::bucket(uint64_t value) {
+    if (value < 4) return static_cast<unsigned int>(value);
+
+    // position of the most significant bit and two bits below it
+    unsigned int msb = 63 - __builtin_clzll(value);
+    unsigned int sub = static_cast<unsigned int>(value >> (msb - 2)) & 3;
+    return (msb - 1) * 4 + sub;
+}
+
+uint64_t Metrics_t::Histogram_t::upperBound(unsigned int bucket) {
+    if (bucket < 4) return bucket;
+
+    unsigned int msb = bucket / 4 + 1;
+    uint64_t lower = uint64_t(4 + bucket % 4) << (msb - 2);
+    return lower + ((uint64_t(1) << (msb - 2)) - 1);
+}
+
+uint64_t Metrics_t::Histogram_t::quantile(double q) const {
+    // snapshot (buckets may move while we read them)
+    uint64_t snapshot[BUCKETS];
+    uint64_t total = 0;
+    for (unsigned int i = 0; i < BUCKETS; ++i) {
+        snapshot[i] = buckets[i].get();
+        total += snapshot[i];
+    }
+    if (!total) return 0;
+
+    uint64_t rank = static_cast<uint64_t>(q * total);
+    if (rank < q * total) ++rank;
+    if (!rank) rank = 1;
+
+    uint64_t seen = 0;
+    for (unsigned int i = 0; i < BUCKETS; ++i) {
+        seen += snapshot[i];
+        if (seen >= rank) return upperBound(i);
+    }
+    return upperBound(BUCKETS - 1);
+}
+
+const int64_t Metrics_t::FaultTable_t::EMPTY
+    = std::numeric_limits<int64_t>::min();
+
+Metrics_t::FaultTable_t::FaultTable_t() {
+    for (unsigned int i = 0; i < SLOTS; ++i) codes[i] = EMPTY;
+}
+
+void Metrics_t::FaultTable_t::record(int faultCode) {
+    unsigned int hash = static_cast<unsigned int>(faultCode);
+    for (unsigned int i = 0; i < SLOTS; ++i) {
+        unsigned int slot = (hash + i) % SLOTS;
+        int64_t current = code(slot);
+        if (current == EMPTY) {
+            // claim free slot, somebody may be faster
+            current = __sync_val_compare_and_swap(&codes[slot], EMPTY,
+                                                  int64_t(faultCode));
+            if (current == EMPTY) current = faultCode;
+        }
+        if (current == faultCode) {
+            counts[slot].add();
+            return;
+        }
+    }
+    others.add();
+}
+
+Metrics_t::Metrics_t(const std::string &prefix)
+    : prefix(prefix)
+{
+    pthread_mutex_init(&mutex, 0);
+}
+
+Metrics_t::~Metrics_t() {
+    for (MethodMap_t::iterator imethods = methods.begin();
+         imethods != methods.end(); ++imethods)
+        delete imethods->second;
+    pthread_mutex_destroy(&mutex);
+}
+
+Metrics_t::MethodStats_t& Metrics_t::method(const std::string &name) {
+    Locker_t locker(mutex);
+    MethodMap_t::iterator imethods = methods.find(name);
+    if (imethods == methods.end()) {
+        std::auto_ptr<MethodStats_t> stats(new MethodStats_t());
+        imethods = methods.insert(
+                MethodMap_t::value_type(name, stats.get())).first;
+        stats.release();
+    }
+    return *imethods->second;
+}
+
+const char* Metrics_t::protocolName(Protocol_t protocol) {
+    switch (protocol) {
+    case XML_RPC: return "xml";
+    case BINARY_RPC: return "binary";
+    case JSON: return "json";
+    case BASE64_RPC: return "base64";
+    case URL_ENCODED: return "urlencoded";
+    default: return "unknown";
+    }
+}
+
+uint64_t Metrics_t::now() {
+#ifdef WIN32
+    return uint64_t(GetTickCount64()) * 1000;
+#else //WIN32
+    struct timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+#endif //WIN32
+}
+
+std::string Metrics_t::format() const {
+    std::ostringstream os;
+
+    MethodMap_t snapshot;
+    {
+        Locker_t locker(mutex);
+        snapshot = methods;
+    }
+
+    os << "# TYPE " << prefix << "_calls_total counter\n";
+    for (MethodMap_t::const_iterator imethods = snapshot.begin();
+         imethods != snapshot.end(); ++imethods)
+    {
+        os << prefix << "_calls_total{method=\""
+           << escapeLabel(imethods->first) << "\"} "
+           << imethods->second->calls.get() << '\n';
+    }
+
+    os << "# TYPE " << prefix << "_faults_total counter\n";
+    for (MethodMap_t::const_iterator imethods = snapshot.begin();
+         imethods != snapshot.end(); ++imethods)
+    {
+        const FaultTable_t &faults = imethods->second->faultCodes;
+        std::string method(escapeLabel(imethods->first));
+        for (unsigned int i = 0; i < FaultTable_t::SLOTS; ++i) {
+            if (faults.code(i) == FaultTable_t::EMPTY) continue;
+            os << prefix << "_faults_total{method=\"" << method
+               << "\",code=\"" << faults.code(i) << "\"} "
+               << faults.count(i) << '\n';
+        }
+        if (faults.other()) {
+            os << prefix << "_faults_total{method=\"" << method
+               << "\",code=\"other\"} " << faults.other() << '\n';
+        }
+    }
+
+    os << "# TYPE " << prefix << "_latency_seconds summary\n";
+    for (MethodMap_t::const_iterator imethods = snapshot.begin();
+         imethods != snapshot.end(); ++imethods)
+    {
+        const Histogram_t &latency = imethods->second->latency;
+        std::string method(escapeLabel(imethods->first));
+        for (unsigned int i = 0; i < QUANTILE_COUNT; ++i) {
+            os << prefix << "_latency_seconds{method=\"" << method
+               << "\",quantile=\"" << QUANTILE_NAMES[i] << "\"} "
+               << seconds(latency.quantile(QUANTILES[i])) << '\n';
+        }
+        os << prefix << "_latency_seconds_sum{method=\"" << method << "\"} "
+           << seconds(latency.getSum()) << '\n';
+        os << prefix << "_latency_seconds_count{method=\"" << method
+           << "\"} " << latency.getCount() << '\n';
+    }
+
+    os << "# TYPE " << prefix << "_received_bytes_total counter\n";
+    for (int i = 0; i < PROTOCOL_COUNT; ++i) {
+        os << prefix << "_received_bytes_total{protocol=\""
+           << protocolName(Protocol_t(i)) << "\"} " << bytesIn[i].get()
+           << '\n';
+    }
+
+    os << "# TYPE " << prefix << "_sent_bytes_total counter\n";
+    for (int i = 0; i < PROTOCOL_COUNT; ++i) {
+        os << prefix << "_sent_bytes_total{protocol=\""
+           << protocolName(Protocol_t(i)) << "\"} " << bytesOut[i].get()
+           << '\n';
+    }
+
+    os << "# TYPE " << prefix << "_connections_total counter\n";
+    os << prefix << "_connections_total{state=\"opened\"} "
+       << connectionsOpened.get() << '\n';
+    os << prefix << "_connections_total{state=\"reused\"} "
+       << connectionsReused.get() << '\n';
+
+    return os.str();
+}
+
+Value_t& Metrics_t::toValue(Pool_t &pool) const {
+    MethodMap_t snapshot;
+    {
+        Locker_t locker(mutex);
+        snapshot = methods;
+    }
+
+    Struct_t &methodsValue = pool.Struct();
+    for (MethodMap_t::const_iterator imethods = snapshot.begin();
+         imethods != snapshot.end(); ++imethods)
+    {
+        const MethodStats_t &stats = *imethods->second;
+
+        Struct_t &faultCodes = pool.Struct();
+        for (unsigned int i = 0; i < FaultTable_t::SLOTS; ++i) {
+            int64_t code = stats.faultCodes.code(i);
+            if (code == FaultTable_t::EMPTY) continue;
+            char name[32];
+            snprintf(name, sizeof(name), "%lld", (long long)code);
+            faultCodes.append(name, countValue(pool, stats.faultCodes.count(i)));
+        }
+        if (stats.faultCodes.other())
+            faultCodes.append("other",
+                              countValue(pool, stats.faultCodes.other()));
+
+        Struct_t &latency = pool.Struct();
+        latency.append("count", countValue(pool, stats.latency.getCount()));
+        latency.append("sumUsec", countValue(pool, stats.latency.getSum()));
+        for (unsigned int i = 0; i < QUANTILE_COUNT; ++i) {
+            latency.append(std::string("p") + (QUANTILE_NAMES[i] + 2),
+                           countValue(pool,
+                                      stats.latency.quantile(QUANTILES[i])));
+        }
+
+        methodsValue.append(imethods->first, pool.Struct(
+                "calls", countValue(pool, stats.calls.get()),
+                "faults", countValue(pool, stats.faults.get()),
+                "faultCodes", faultCodes,
+                "latencyUsec", latency));
+    }
+
+    Struct_t &received = pool.Struct();
+    Struct_t &sent = pool.Struct();
+    for (int i = 0; i < PROTOCOL_COUNT; ++i) {
+        received.append(protocolName(Protocol_t(i)),
+                        countValue(pool, bytesIn[i].get()));
+        sent.append(protocolName(Protocol_t(i)),
+                    countValue(pool, bytesOut[i].get()));
+    }
+
+    return pool.Struct("methods", methodsValue,
+                       "receivedBytes", received,
+                       "sentBytes", sent,
+                       "connectionsOpened",
+                       countValue(pool, connectionsOpened.get()),
+                       "connectionsReused",
+                       countValue(pool, connectionsReused.get()));
+}
+
+};
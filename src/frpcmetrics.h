@@ -0,0 +1,242 @@
+/*
+ * FastRPC -- Fast RPC library compatible with XML-RPC
+ * Copyright (C) 2005-7  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Radlicka 2, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:fastrpc@firma.seznam.cz
+ *
+ *
+ * FILE          $Id$
+ *
+ * DESCRIPTION   Call, fault, latency and traffic metrics
+ *
+ * AUTHOR
+ *
+ * HISTORY
+ *
+ */
+#ifndef FRPCFRPCMETRICS_H
+#define FRPCFRPCMETRICS_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <string>
+#include <map>
+
+#include <frpcplatform.h>
+
+namespace FRPC {
+
+class Pool_t;
+class Value_t;
+
+/** Metrics of server or client side.
+ *
+ *  Counters are updated by atomic operations only, so one instance can be
+ *  shared by all threads (e.g. all servers of Acceptor_t). Only lookup of
+ *  method by name takes a mutex; the registry resolves its methods at
+ *  registration time and the proxy caches them, so the request path never
+ *  locks after the first call of a method.
+ */
+class FRPC_DLLEXPORT Metrics_t {
+public:
+    /** Protocol of HTTP body.
+     */
+    enum Protocol_t {
+        XML_RPC = 0, BINARY_RPC, JSON, BASE64_RPC, URL_ENCODED,
+        PROTOCOL_COUNT
+    };
+
+    /** Monotonic counter.
+     */
+    class FRPC_DLLEXPORT Counter_t {
+    public:
+        Counter_t() : value(0) {}
+
+        void add(uint64_t n = 1) {
+            __sync_fetch_and_add(&value, n);
+        }
+
+        uint64_t get() const {
+            return __sync_fetch_and_add(const_cast<uint64_t*>(&value), 0);
+        }
+
+    private:
+        uint64_t value;
+    };
+
+    /** Log-linear histogram of latencies in microseconds: every power of
+     *  two is split into four buckets (relative error below 25%).
+     */
+    class FRPC_DLLEXPORT Histogram_t {
+    public:
+        enum { BUCKETS = 252 };
+
+        void record(uint64_t value) {
+            buckets[bucket(value)].add();
+            count.add();
+            sum.add(value);
+        }
+
+        /** Upper bound of the bucket holding given quantile (0.0 - 1.0).
+         */
+        uint64_t quantile(double q) const;
+
+        uint64_t getCount() const {
+            return count.get();
+        }
+
+        uint64_t getSum() const {
+            return sum.get();
+        }
+
+        static unsigned int bucket(uint64_t value);
+
+        static uint64_t upperBound(unsigned int bucket);
+
+    private:
+        Counter_t buckets[BUCKETS];
+        Counter_t count;
+        Counter_t sum;
+    };
+
+    /** Fault counts by fault code. Fixed open-addressing table filled by
+     *  compare-and-swap; codes not fitting in are counted as "other".
+     */
+    class FRPC_DLLEXPORT FaultTable_t {
+    public:
+        enum { SLOTS = 16 };
+
+        FaultTable_t();
+
+        void record(int code);
+
+        /** Code stored in slot (or EMPTY).
+         */
+        int64_t code(unsigned int slot) const {
+            return __sync_fetch_and_add(const_cast<int64_t*>(&codes[slot]), 0);
+        }
+
+        uint64_t count(unsigned int slot) const {
+            return counts[slot].get();
+        }
+
+        uint64_t other() const {
+            return others.get();
+        }
+
+        static const int64_t EMPTY;
+
+    private:
+        int64_t codes[SLOTS];
+        Counter_t counts[SLOTS];
+        Counter_t others;
+    };
+
+    /** Statistics of one method.
+     */
+    struct FRPC_DLLEXPORT MethodStats_t {
+        /** Record finished call.
+         *
+         * @param usec duration in microseconds
+         * @param fault whether the call ended with fault
+         * @param faultCode code of the fault
+         */
+        void record(uint64_t usec, bool fault = false, int faultCode = 0) {
+            calls.add();
+            latency.record(usec);
+            if (fault) {
+                faults.add();
+                faultCodes.record(faultCode);
+            }
+        }
+
+        Counter_t calls;
+        Counter_t faults;
+        FaultTable_t faultCodes;
+        Histogram_t latency;
+    };
+
+    /**
+     * @param prefix name prefix of metrics in text exposition format
+     */
+    Metrics_t(const std::string &prefix = "frpc");
+
+    ~Metrics_t();
+
+    /** Statistics of the method, created on first use. Returned reference
+     *  is valid for the whole life of metrics.
+     */
+    MethodStats_t& method(const std::string &name);
+
+    /** Count bytes of request/response bodies.
+     */
+    void received(Protocol_t protocol, uint64_t bytes) {
+        bytesIn[protocol].add(bytes);
+    }
+
+    void sent(Protocol_t protocol, uint64_t bytes) {
+        bytesOut[protocol].add(bytes);
+    }
+
+    /** Count connection use.
+     *
+     * @param reused true when request goes over kept-alive connection
+     */
+    void connection(bool reused) {
+        if (reused) {
+            connectionsReused.add();
+        } else {
+            connectionsOpened.add();
+        }
+    }
+
+    /** Text (Prometheus) exposition format.
+     */
+    std::string format() const;
+
+    /** Metrics as FastRPC struct (used by system.stats).
+     */
+    Value_t& toValue(Pool_t &pool) const;
+
+    /** Name of the protocol as used in metric labels.
+     */
+    static const char* protocolName(Protocol_t protocol);
+
+    /** Microseconds of monotonic clock.
+     */
+    static uint64_t now();
+
+private:
+    Metrics_t(const Metrics_t&);
+    Metrics_t& operator=(const Metrics_t&);
+
+    typedef std::map<std::string, MethodStats_t*> MethodMap_t;
+
+    std::string prefix;
+    mutable pthread_mutex_t mutex;      //!< guards methods
+    MethodMap_t methods;
+    Counter_t bytesIn[PROTOCOL_COUNT];
+    Counter_t bytesOut[PROTOCOL_COUNT];
+    Counter_t connectionsOpened;
+    Counter_t connectionsReused;
+};
+
+};
+
+#endif
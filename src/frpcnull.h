@@ -34,6 +34,7 @@
 #define FRPCNULL_H
 
 #include <frpcvalue.h>
+#include <frpcvaluevisitor.h>
 #include <typeinfo>
 
 namespace FRPC
@@ -78,6 +79,15 @@ public:
     */
     virtual Value_t& clone(Pool_t &newPool) const;
 
+    /**
+        @brief Dispatch this value to the visitor
+        @param visitor is reference to visitor
+    */
+    virtual void accept(ValueVisitor_t &visitor) const
+    {
+        visitor.visit(*this);
+    }
+
 private :
     /**
         @brief Default constructor
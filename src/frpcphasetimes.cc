@@ -0,0 +1,79 @@
+/*
+ * FastRPC -- Fast RPC library compatible with XML-RPC
+ * Copyright (C) 2005-7  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Radlicka 2, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:fastrpc@firma.seznam.cz
+ *
+ *
+ * FILE          $Id$
+ *
+ * DESCRIPTION   Per-request latency breakdown by processing phase
+ *
+ * AUTHOR
+ *
+ * HISTORY
+ *
+ */
+#include "frpcphasetimes.h"
+#include <frpcmetrics.h>
+
+namespace FRPC {
+
+void PhaseTimes_t::start(Phase_t phase) {
+    clear();
+    current = phase;
+    mark = Metrics_t::now();
+    running = true;
+}
+
+PhaseTimes_t::Phase_t PhaseTimes_t::enter(Phase_t phase) {
+    Phase_t previous = current;
+    if (running) {
+        uint64_t now = Metrics_t::now();
+        durations[current] += now - mark;
+        mark = now;
+    }
+    current = phase;
+    return previous;
+}
+
+void PhaseTimes_t::stop() {
+    if (!running) return;
+    durations[current] += Metrics_t::now() - mark;
+    running = false;
+}
+
+uint64_t PhaseTimes_t::total() const {
+    uint64_t sum = 0;
+    for (int i = 0; i < PHASE_COUNT; ++i) sum += durations[i];
+    return sum;
+}
+
+const char* PhaseTimes_t::name(Phase_t phase) {
+    switch (phase) {
+    case READ: return "read";
+    case DECODE: return "decode";
+    case HANDLER: return "handler";
+    case ENCODE: return "encode";
+    case WRITE: return "write";
+    default: return "unknown";
+    }
+}
+
+};
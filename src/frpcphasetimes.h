@@ -0,0 +1,135 @@
+/*
+ * FastRPC -- Fast RPC library compatible with XML-RPC
+ * Copyright (C) 2005-7  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Radlicka 2, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:fastrpc@firma.seznam.cz
+ *
+ *
+ * FILE          $Id$
+ *
+ * DESCRIPTION   Per-request latency breakdown by processing phase
+ *
+ * AUTHOR
+ *
+ * HISTORY
+ *
+ */
+#ifndef FRPCFRPCPHASETIMES_H
+#define FRPCFRPCPHASETIMES_H
+
+#include <stdint.h>
+
+#include <frpcplatform.h>
+
+namespace FRPC {
+
+/** Time spent (in microseconds, monotonic clock) in each phase of one RPC
+ *  exchange.
+ *
+ *  Exactly one phase is running at any moment: enter() charges the time
+ *  elapsed since the last switch to the running phase and switches to the
+ *  new one. Nested work (e.g. unmarshalling called from inside socket
+ *  reading) is therefore charged exclusively, see PhaseScope_t.
+ *
+ *  Server side: READ is reading of request (from request line), DECODE
+ *  unmarshalling, HANDLER the method itself, ENCODE marshalling (and
+ *  compression) of response, WRITE sending of response.
+ *
+ *  Client side: ENCODE is marshalling of request, WRITE connecting and
+ *  sending, HANDLER waiting for the response status line (remote handler
+ *  plus network), READ reading of the rest of response, DECODE
+ *  unmarshalling.
+ */
+class FRPC_DLLEXPORT PhaseTimes_t {
+public:
+    enum Phase_t {
+        READ = 0, DECODE, HANDLER, ENCODE, WRITE,
+        PHASE_COUNT
+    };
+
+    PhaseTimes_t() : running(false), current(READ), mark(0) {
+        clear();
+    }
+
+    /** Clear all durations and start clock in given phase.
+     */
+    void start(Phase_t phase);
+
+    /** Switch to given phase.
+     *
+     * @return previously running phase
+     */
+    Phase_t enter(Phase_t phase);
+
+    /** Stop clock (charge running phase).
+     */
+    void stop();
+
+    void clear() {
+        for (int i = 0; i < PHASE_COUNT; ++i) durations[i] = 0;
+    }
+
+    bool isRunning() const {
+        return running;
+    }
+
+    /** Time spent in given phase (us).
+     */
+    uint64_t get(Phase_t phase) const {
+        return durations[phase];
+    }
+
+    /** Time spent in all phases (us).
+     */
+    uint64_t total() const;
+
+    static const char* name(Phase_t phase);
+
+private:
+    bool running;
+    Phase_t current;
+    uint64_t mark;
+    uint64_t durations[PHASE_COUNT];
+};
+
+/** Run given phase while in scope, then return to the previous one. Does
+ *  nothing when times are 0 or the clock is not running.
+ */
+class FRPC_DLLEXPORT PhaseScope_t {
+public:
+    PhaseScope_t(PhaseTimes_t *times, PhaseTimes_t::Phase_t phase)
+        : times((times && times->isRunning()) ? times : 0),
+          previous(this->times ? this->times->enter(phase) : phase)
+    {}
+
+    ~PhaseScope_t() {
+        if (times && times->isRunning()) times->enter(previous);
+    }
+
+private:
+    PhaseScope_t(const PhaseScope_t&);
+    PhaseScope_t& operator=(const PhaseScope_t&);
+
+    PhaseTimes_t *times;
+    PhaseTimes_t::Phase_t previous;
+};
+
+};
+
+#endif
@@ -30,14 +30,61 @@
  * HISTORY
  *
  */
+#include <algorithm>
 #include <frpc.h>
+#include <frpcconfig.h>
 //remove
 #include <stdio.h>
 
 namespace FRPC
 {
 
+/** Shared immutable values.
+ */
+struct Pool_t::Shared_t {
+    Bool_t *booleans[2];
+    Int_t::value_type intMin;
+    Int_t::value_type intMax;
+    std::vector<Int_t*> ints;
+
+    bool hasInt(Int_t::value_type value) const {
+        return (value >= intMin) && (value <= intMax);
+    }
+};
+
+const Pool_t::Shared_t& Pool_t::buildShared()
+{
+    LibConfig_t *config = LibConfig_t::getInstance();
+    Shared_t *values = new Shared_t();
+    values->booleans[0] = new Bool_t(false);
+    values->booleans[1] = new Bool_t(true);
+    long intMin = config->getSharedIntMin();
+    long intMax = config->getSharedIntMax();
+
+    // setSharedValuesPolicy() rejects larger ranges
+    unsigned long count = 0;
+    if (intMax >= intMin) {
+        count = std::min(static_cast<unsigned long>(intMax)
+                         - static_cast<unsigned long>(intMin),
+                         LibConfig_t::MAX_SHARED_INTS - 1) + 1;
+    }
+    values->intMin = intMin;
+    values->intMax = values->intMin + Int_t::value_type(count) - 1;
+    for (unsigned long i = 0; i < count; ++i)
+        values->ints.push_back(new Int_t(values->intMin + i));
+    return *values;
+}
+
+const Pool_t::Shared_t& Pool_t::shared()
+{
+    // initialized once (thread safe), never freed
+    static const Shared_t &values = buildShared();
+    return values;
+}
+
 Pool_t::Pool_t()
+    : sharedValues(LibConfig_t::getInstance()->getSharedValuesPolicy()
+                   ? &shared() : 0)
 {
     pointerStorage.reserve(1024);
 }
@@ -76,6 +123,9 @@ void Pool_t::free()
 
 Int_t&  Pool_t::Int(const Int_t::value_type &value)
 {
+    if (sharedValues && sharedValues->hasInt(value))
+        return *sharedValues->ints[value - sharedValues->intMin];
+
     Int_t* newValue =  new Int_t(value);
 
     //printf("Alokujem %p\n",newValue);
@@ -87,6 +137,8 @@ Int_t&  Pool_t::Int(const Int_t::value_type &value)
 
 Bool_t& Pool_t::Bool(const bool &value)
 {
+    if (sharedValues) return *sharedValues->booleans[value];
+
     Bool_t* newValue =  new Bool_t(value);
 
     pointerStorage.push_back(newValue);
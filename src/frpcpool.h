@@ -58,6 +58,9 @@ class Null_t;
 @brief Memory pool
  
 Thic obbject has completely control of pointers to all Value_t
+
+When LibConfig_t shared values policy is enabled, Bool() and Int() for
+small numbers return shared immutable instances not owned by the pool.
 */
 class FRPC_DLLEXPORT Pool_t
 {
@@ -356,6 +359,17 @@ public:
     std::vector< Value_t* > pointerStorage; ///@brief pointer storage of pool
 
 private:
+    struct Shared_t;
+
+    /**
+        @brief Process-wide shared values, built on first use
+    */
+    static const Shared_t& shared();
+    static const Shared_t& buildShared();
+
+    ///@brief shared values (LibConfig_t::getSharedValuesPolicy()) or 0
+    const Shared_t *sharedValues;
+
     // this is denied
     DateTime_t& DateTime(time_t);
     DateTime_t& DateTime(int);
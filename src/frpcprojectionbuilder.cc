@@ -0,0 +1,263 @@
+/*
+ * FastRPC -- Fast RPC library compatible with XML-RPC
+ * Copyright (C) 2005-7  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Radlicka 2, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:fastrpc@firma.seznam.cz
+ *
+ * FILE          $Id$
+ *
+ * DESCRIPTION   Data builder passing on selected paths only
+ *
+ * AUTHOR
+ *
+ * HISTORY
+ *
+ */
+#include "frpcprojectionbuilder.h"
+#include "frpctreebuilder.h"
+#include "frpcstreamerror.h"
+#include "frpcerror.h"
+#include <string.h>
+
+namespace FRPC {
+
+const ProjectionBuilder_t::Node_t*
+ProjectionBuilder_t::Node_t::member(const char *name, unsigned int size) const
+{
+    if (whole) return this;
+
+    // few members per node, linear search needs no key allocation
+    for (std::vector<std::pair<std::string, Node_t*> >::const_iterator
+             i = members.begin(); i != members.end(); ++i)
+    {
+        if ((i->first.size() == size) && !memcmp(i->first.data(), name, size))
+            return i->second;
+    }
+    return 0;
+}
+
+ProjectionBuilder_t::ProjectionBuilder_t(DataBuilder_t &builder,
+                                         const std::string &paths)
+    : builder(builder),
+      treeBuilder(dynamic_cast<TreeBuilder_t*>(&builder)),
+      nullBuilder(dynamic_cast<DataBuilderWithNull_t*>(&builder)),
+      root(newNode()), next(root), skipDepth(0)
+{
+    std::string::size_type begin = 0;
+    while (begin < paths.size()) {
+        std::string::size_type end = paths.find(',', begin);
+        if (end == std::string::npos) end = paths.size();
+        if (end > begin) select(paths.substr(begin, end - begin));
+        begin = end + 1;
+    }
+}
+
+ProjectionBuilder_t::~ProjectionBuilder_t() {
+    for (std::vector<Node_t*>::iterator
+             i = nodes.begin(); i != nodes.end(); ++i)
+    {
+        delete *i;
+    }
+}
+
+ProjectionBuilder_t::Node_t* ProjectionBuilder_t::newNode() {
+    nodes.push_back(0);
+    nodes.back() = new Node_t();
+    return nodes.back();
+}
+
+ProjectionBuilder_t& ProjectionBuilder_t::select(const std::string &path) {
+    Node_t *node = root;
+    std::string::size_type pos = 0;
+    while (pos < path.size()) {
+        if (!path.compare(pos, 2, "[]")) {
+            if (!node->items) node->items = newNode();
+            node = node->items;
+            pos += 2;
+        } else {
+            std::string::size_type end = path.find_first_of(".[", pos);
+            if (end == std::string::npos) end = path.size();
+            if (end == pos)
+                throw Error_t::format("Invalid projection path '%s'",
+                                      path.c_str());
+
+            std::string name(path, pos, end - pos);
+            Node_t *child = 0;
+            for (std::vector<std::pair<std::string, Node_t*> >::iterator
+                     i = node->members.begin(); i != node->members.end(); ++i)
+            {
+                if (i->first == name) child = i->second;
+            }
+            if (!child) {
+                child = newNode();
+                node->members.push_back(std::make_pair(name, child));
+            }
+            node = child;
+            pos = end;
+        }
+
+        if ((pos < path.size()) && (path[pos] == '.')) {
+            if (++pos == path.size())
+                throw Error_t::format("Invalid projection path '%s'",
+                                      path.c_str());
+        }
+    }
+
+    node->whole = true;
+    return *this;
+}
+
+bool ProjectionBuilder_t::open(bool array) {
+    if (!selected()) {
+        ++skipDepth;
+        return false;
+    }
+
+    frames.push_back(Frame_t(next, array));
+    next = array ? next->item() : 0;
+    return true;
+}
+
+bool ProjectionBuilder_t::close() {
+    if (skipDepth) {
+        --skipDepth;
+        return false;
+    }
+
+    frames.pop_back();
+    if (frames.empty()) {
+        next = root;
+    } else {
+        next = frames.back().array ? frames.back().node->item() : 0;
+    }
+    return true;
+}
+
+void ProjectionBuilder_t::buildMethodResponse() {
+    builder.buildMethodResponse();
+}
+
+void ProjectionBuilder_t::buildBinary(const char* data, unsigned int size) {
+    if (selected()) builder.buildBinary(data, size);
+}
+
+void ProjectionBuilder_t::buildBinary(const std::string &data) {
+    if (selected()) builder.buildBinary(data);
+}
+
+void ProjectionBuilder_t::buildBool(bool value) {
+    if (selected()) builder.buildBool(value);
+}
+
+void ProjectionBuilder_t::buildDateTime(short year, char month, char day,
+                                        char hour, char minute, char sec,
+                                        char weekDay, time_t unixTime,
+                                        int timeZone)
+{
+    if (selected())
+        builder.buildDateTime(year, month, day, hour, minute, sec, weekDay,
+                              unixTime, timeZone);
+}
+
+void ProjectionBuilder_t::buildDouble(double value) {
+    if (selected()) builder.buildDouble(value);
+}
+
+void ProjectionBuilder_t::buildFault(int errNumber, const char* errMsg,
+                                     unsigned int size)
+{
+    builder.buildFault(errNumber, errMsg, size);
+}
+
+void ProjectionBuilder_t::buildFault(int errNumber,
+                                     const std::string &errMsg)
+{
+    builder.buildFault(errNumber, errMsg);
+}
+
+void ProjectionBuilder_t::buildInt(Int_t::value_type value) {
+    if (selected()) builder.buildInt(value);
+}
+
+void ProjectionBuilder_t::buildMethodCall(const char* methodName,
+                                          unsigned int size)
+{
+    // params array is opened implicitly
+    frames.push_back(Frame_t(root, true));
+    next = root->item();
+    builder.buildMethodCall(methodName, size);
+}
+
+void ProjectionBuilder_t::buildMethodCall(const std::string &methodName) {
+    frames.push_back(Frame_t(root, true));
+    next = root->item();
+    builder.buildMethodCall(methodName);
+}
+
+void ProjectionBuilder_t::buildString(const char* data, unsigned int size) {
+    if (selected()) builder.buildString(data, size);
+}
+
+void ProjectionBuilder_t::buildString(const std::string &data) {
+    if (selected()) builder.buildString(data);
+}
+
+void ProjectionBuilder_t::buildStructMember(const char *memberName,
+                                            unsigned int size)
+{
+    if (skipDepth) return;
+    next = frames.back().node->member(memberName, size);
+    if (next) builder.buildStructMember(memberName, size);
+}
+
+void ProjectionBuilder_t::buildStructMember(const std::string &memberName) {
+    if (skipDepth) return;
+    next = frames.back().node->member(memberName.data(), memberName.size());
+    if (next) builder.buildStructMember(memberName);
+}
+
+void ProjectionBuilder_t::closeArray() {
+    if (close()) builder.closeArray();
+}
+
+void ProjectionBuilder_t::closeStruct() {
+    if (close()) builder.closeStruct();
+}
+
+void ProjectionBuilder_t::openArray(unsigned int numOfItems) {
+    if (!open(true)) return;
+    builder.openArray(next ? numOfItems : 0);
+}
+
+void ProjectionBuilder_t::openStruct(unsigned int numOfMembers) {
+    if (open(false)) builder.openStruct(numOfMembers);
+}
+
+void ProjectionBuilder_t::buildNull() {
+    if (!selected()) return;
+    if (treeBuilder) {
+        treeBuilder->buildNull();
+    } else if (nullBuilder) {
+        nullBuilder->buildNull();
+    } else {
+        throw StreamError_t("Builder doesn't support null");
+    }
+}
+
+}
@@ -0,0 +1,173 @@
+/*
+ * FastRPC -- Fast RPC library compatible with XML-RPC
+ * Copyright (C) 2005-7  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Radlicka 2, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:fastrpc@firma.seznam.cz
+ *
+ * FILE          $Id$
+ *
+ * DESCRIPTION   Data builder passing on selected paths only
+ *
+ * AUTHOR
+ *
+ * HISTORY
+ *
+ */
+#ifndef FRPCFRPCPROJECTIONBUILDER_H
+#define FRPCFRPCPROJECTIONBUILDER_H
+
+#include <frpcplatform.h>
+
+#include <frpcdatabuilder.h>
+#include <string>
+#include <vector>
+
+namespace FRPC
+{
+
+class TreeBuilder_t;
+
+/**
+@brief Data builder passing on only values on selected paths
+
+Sits between the unmarshaller and the real builder (usually TreeBuilder_t)
+and drops every value not selected by projection paths, so the pool holds
+just the requested parts of large responses. Skipped subtrees cost no
+allocation.
+
+Path is relative to the unmarshalled value (method response, or params
+array of method call) and consists of struct member names separated by
+dots; "[]" selects all items of array:
+
+@code
+FRPC::TreeBuilder_t tree(pool);
+FRPC::ProjectionBuilder_t builder(tree, "result.items[].id,status");
+proxy.call(builder, "search", ...);
+@endcode
+
+Values whose path is a prefix of some projection path are passed on as
+well, so containers on the way keep their shape: a struct keeps only the
+selected members and an array not selected by "[]" arrives empty. Selected
+containers are passed on whole. Declared size of pruned struct is passed
+on unchanged, it is an upper bound only.
+*/
+class FRPC_DLLEXPORT ProjectionBuilder_t : public DataBuilderWithNull_t
+{
+public:
+    /**
+        @brief Create projecting builder
+        @param builder builder receiving selected values
+        @param paths comma separated projection paths
+    */
+    ProjectionBuilder_t(DataBuilder_t &builder,
+                        const std::string &paths = std::string());
+
+    virtual ~ProjectionBuilder_t();
+
+    /**
+        @brief Add projection path
+        @param path path (without commas) to select
+        @return *this
+    */
+    ProjectionBuilder_t& select(const std::string &path);
+
+    virtual void buildMethodResponse();
+    virtual void buildBinary(const char* data, unsigned int size);
+    virtual void buildBinary(const std::string &data);
+    virtual void buildBool(bool value);
+    virtual void buildDateTime(short year, char month, char day,char hour,
+                               char minute, char sec, char weekDay,
+                               time_t unixTime, int timeZone);
+    virtual void buildDouble(double value);
+    virtual void buildFault(int errNumber, const char* errMsg,
+                            unsigned int size);
+    virtual void buildFault(int errNumber, const std::string &errMsg);
+    virtual void buildInt(Int_t::value_type value);
+    virtual void buildMethodCall(const char* methodName, unsigned int size);
+    virtual void buildMethodCall(const std::string &methodName);
+    virtual void buildString(const char* data, unsigned int size);
+    virtual void buildString(const std::string &data);
+    virtual void buildStructMember(const char *memberName,
+                                   unsigned int size);
+    virtual void buildStructMember(const std::string &memberName);
+    virtual void closeArray();
+    virtual void closeStruct();
+    virtual void openArray(unsigned int numOfItems);
+    virtual void openStruct(unsigned int numOfMembers);
+    virtual void buildNull();
+
+private:
+    ProjectionBuilder_t(const ProjectionBuilder_t&);
+    ProjectionBuilder_t& operator=(const ProjectionBuilder_t&);
+
+    /** Node of projection tree; whole subtree is selected by leaf. */
+    struct Node_t {
+        Node_t() : items(0), whole(false) {}
+
+        const Node_t* member(const char *name, unsigned int size) const;
+        const Node_t* item() const {
+            return whole ? this : items;
+        }
+
+        std::vector<std::pair<std::string, Node_t*> > members;
+        Node_t *items;
+        bool whole;
+    };
+
+    struct Frame_t {
+        Frame_t(const Node_t *node, bool array)
+            : node(node), array(array)
+        {}
+
+        const Node_t *node;
+        bool array;
+    };
+
+    Node_t* newNode();
+
+    /**
+        @brief Returns true if next scalar value is selected
+    */
+    bool selected() const {
+        return !skipDepth && next;
+    }
+
+    /**
+        @brief Enter container; returns true if it is passed on
+    */
+    bool open(bool array);
+
+    /**
+        @brief Leave container; returns true if it is passed on
+    */
+    bool close();
+
+    DataBuilder_t &builder;
+    TreeBuilder_t *treeBuilder;
+    DataBuilderWithNull_t *nullBuilder;
+    std::vector<Node_t*> nodes;
+    Node_t *root;
+    std::vector<Frame_t> frames;
+    const Node_t *next;         //!< node of next value, 0 if not selected
+    unsigned int skipDepth;     //!< nesting inside skipped container
+};
+
+};
+
+#endif
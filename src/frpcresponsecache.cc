@@ -0,0 +1,182 @@
+/*
+ * FastRPC -- Fast RPC library compatible with XML-RPC
+ * Copyright (C) 2005-7  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Radlicka 2, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:fastrpc@firma.seznam.cz
+ *
+ * FILE          $Id$
+ *
+ * DESCRIPTION   Client side LRU cache of call results
+ *
+ * AUTHOR
+ *
+ * HISTORY
+ *
+ */
+#include "frpcresponsecache.h"
+#include <fnmatch.h>
+#include <memory>
+#include <frpc.h>
+#include <frpcpool.h>
+#include <frpcvalue.h>
+#include <frpcmetrics.h>
+#include <frpcwriter.h>
+#include <frpcbinmarshaller.h>
+#include <frpcunmarshaller.h>
+#include <frpctreefeeder.h>
+#include <frpctreebuilder.h>
+#include "frpcutils.h"
+
+namespace FRPC {
+
+namespace {
+
+/** Rough overhead of list node, map node and strings of an entry.
+ */
+const size_t ENTRY_OVERHEAD = 128;
+
+} // namespace
+
+ResponseCache_t::ResponseCache_t(size_t maxBytes)
+    : maxBytes(maxBytes), usedBytes(0), hitCount(0), missCount(0)
+{
+    pthread_mutex_init(&mutex, 0);
+}
+
+ResponseCache_t::~ResponseCache_t() {
+    pthread_mutex_destroy(&mutex);
+}
+
+void ResponseCache_t::setTtl(const std::string &methods, unsigned int ttl) {
+    std::vector<std::string> patterns(splitPatterns(methods));
+    Locker_t locker(mutex);
+    for (std::vector<std::string>::const_iterator ipatterns
+             = patterns.begin(); ipatterns != patterns.end(); ++ipatterns)
+    {
+        rules.push_back(RuleVector_t::value_type(*ipatterns, ttl));
+    }
+}
+
+unsigned int ResponseCache_t::ttl(const std::string &methodName) const {
+    Locker_t locker(mutex);
+    for (RuleVector_t::const_iterator i = rules.begin(); i != rules.end(); ++i)
+    {
+        if (!fnmatch(i->first.c_str(), methodName.c_str(), 0))
+            return i->second;
+    }
+    return 0;
+}
+
+size_t ResponseCache_t::cost(const Entry_t &entry) {
+    // key is stored twice (list and index)
+    return 2 * entry.key.size() + entry.data.size() + ENTRY_OVERHEAD;
+}
+
+void ResponseCache_t::remove(EntryList_t::iterator entry) {
+    usedBytes -= cost(*entry);
+    index.erase(entry->key);
+    entries.erase(entry);
+}
+
+Value_t* ResponseCache_t::get(Pool_t &pool, const std::string &key) {
+    std::string data;
+    {
+        Locker_t locker(mutex);
+        EntryMap_t::iterator pos = index.find(key);
+        if (pos == index.end()) {
+            ++missCount;
+            return 0;
+        }
+        if (pos->second->expires <= Metrics_t::now()) {
+            remove(pos->second);
+            ++missCount;
+            return 0;
+        }
+        ++hitCount;
+        entries.splice(entries.begin(), entries, pos->second);
+        data = pos->second->data;
+    }
+
+    TreeBuilder_t builder(pool);
+    std::auto_ptr<UnMarshaller_t> unmarshaller(
+            UnMarshaller_t::create(UnMarshaller_t::BINARY_RPC, builder));
+    unmarshaller->unMarshall(data.data(), data.size(),
+                             UnMarshaller_t::TYPE_METHOD_RESPONSE);
+    return &builder.getUnMarshaledData();
+}
+
+void ResponseCache_t::put(const std::string &key, const Value_t &value,
+                          unsigned int ttl)
+{
+    Entry_t entry;
+    entry.key = key;
+    StringWriter_t writer(entry.data);
+    BinMarshaller_t marshaller(writer, ProtocolVersion_t(3, 0));
+    TreeFeeder_t feeder(marshaller);
+    marshaller.packMethodResponse();
+    feeder.feedValue(value);
+    marshaller.flush();
+    entry.expires = Metrics_t::now() + uint64_t(ttl) * 1000;
+
+    size_t size = cost(entry);
+    Locker_t locker(mutex);
+    EntryMap_t::iterator pos = index.find(key);
+    if (pos != index.end()) remove(pos->second);
+    if (size > maxBytes) return;
+
+    while (usedBytes + size > maxBytes)
+        remove(--entries.end());
+
+    entries.push_front(Entry_t());
+    Entry_t &stored = entries.front();
+    stored.key.swap(entry.key);
+    stored.data.swap(entry.data);
+    stored.expires = entry.expires;
+    index[key] = entries.begin();
+    usedBytes += size;
+}
+
+void ResponseCache_t::clear() {
+    Locker_t locker(mutex);
+    entries.clear();
+    index.clear();
+    usedBytes = 0;
+}
+
+uint64_t ResponseCache_t::hits() const {
+    Locker_t locker(mutex);
+    return hitCount;
+}
+
+uint64_t ResponseCache_t::misses() const {
+    Locker_t locker(mutex);
+    return missCount;
+}
+
+size_t ResponseCache_t::size() const {
+    Locker_t locker(mutex);
+    return entries.size();
+}
+
+size_t ResponseCache_t::bytes() const {
+    Locker_t locker(mutex);
+    return usedBytes;
+}
+
+};
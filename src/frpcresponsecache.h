@@ -0,0 +1,139 @@
+/*
+ * FastRPC -- Fast RPC library compatible with XML-RPC
+ * Copyright (C) 2005-7  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Radlicka 2, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:fastrpc@firma.seznam.cz
+ *
+ * FILE          $Id$
+ *
+ * DESCRIPTION   Client side LRU cache of call results
+ *
+ * AUTHOR
+ *
+ * HISTORY
+ *
+ */
+#ifndef FRPCFRPCRESPONSECACHE_H
+#define FRPCFRPCRESPONSECACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+
+#include <frpcplatform.h>
+
+namespace FRPC {
+
+class Pool_t;
+class Value_t;
+
+/** LRU cache of call results with per-method time to live.
+ *
+ *  Results are kept serialized to FRPC binary and unmarshalled into
+ *  caller's pool on hit. Total size of keys and results is bounded, least
+ *  recently used entries are evicted first. Faults are never cached.
+ *
+ *  The key contains server URL (see SingleFlight_t::key()), so one
+ *  instance can be shared by more ServerProxy_t objects
+ *  (ServerProxy_t::Config_t::responseCache) and threads.
+ */
+class FRPC_DLLEXPORT ResponseCache_t {
+public:
+    /** @param maxBytes memory budget of entries (keys and results)
+     */
+    explicit ResponseCache_t(size_t maxBytes);
+
+    ~ResponseCache_t();
+
+    /** Cache results of methods matching given comma separated name
+     *  patterns (fnmatch) for given time. First matching rule wins;
+     *  methods without rule are not cached.
+     *  @param ttl time to live in miliseconds
+     */
+    void setTtl(const std::string &methods, unsigned int ttl);
+
+    /** Time to live of results of given method (0 = not cached).
+     */
+    unsigned int ttl(const std::string &methodName) const;
+
+    /** Fresh result stored under given key, allocated from given pool.
+     *  @return result or 0 on miss
+     */
+    Value_t* get(Pool_t &pool, const std::string &key);
+
+    /** Store result under given key.
+     *  @param ttl time to live in miliseconds
+     */
+    void put(const std::string &key, const Value_t &value, unsigned int ttl);
+
+    /** Drop all entries.
+     */
+    void clear();
+
+    uint64_t hits() const;
+
+    uint64_t misses() const;
+
+    /** Number of entries.
+     */
+    size_t size() const;
+
+    /** Memory taken by entries.
+     */
+    size_t bytes() const;
+
+private:
+    ResponseCache_t(const ResponseCache_t&);
+    ResponseCache_t& operator=(const ResponseCache_t&);
+
+    struct Entry_t {
+        std::string key;
+        std::string data;       //!< serialized result
+        uint64_t expires;       //!< Metrics_t::now() time
+    };
+
+    typedef std::list<Entry_t> EntryList_t;
+    typedef std::map<std::string, EntryList_t::iterator> EntryMap_t;
+    typedef std::vector<std::pair<std::string, unsigned int> > RuleVector_t;
+
+    /** Memory taken by given entry. Call with mutex locked.
+     */
+    static size_t cost(const Entry_t &entry);
+
+    /** Remove given entry. Call with mutex locked.
+     */
+    void remove(EntryList_t::iterator entry);
+
+    size_t maxBytes;
+    size_t usedBytes;
+    RuleVector_t rules;         //!< method pattern => ttl
+    EntryList_t entries;        //!< most recently used first
+    EntryMap_t index;
+    uint64_t hitCount;
+    uint64_t missCount;
+    mutable pthread_mutex_t mutex;
+};
+
+};
+
+#endif
@@ -39,6 +39,7 @@
 #include <functional>
 
 #include <stdexcept>
+#include <stdlib.h>
 #include <frpchttpclient.h>
 #include <frpcstreamerror.h>
 #include <frpchttpclient.h>
@@ -47,14 +48,18 @@
 #include <frpcmarshaller.h>
 #include <frpchttperror.h>
 #include <frpcinternals.h>
+#include <frpclimiterror.h>
+#include <frpcprotocolerror.h>
+#include <frpclistener.h>
 #include <frpc.h>
 #include <frpcsocket.h>
+#include <frpcdeadline.h>
 
 
 namespace FRPC {
 namespace {
 
-inline unsigned int chooseType(unsigned int type) {
+inline unsigned int chooseType(unsigned int type, bool compactXml) {
     switch(type) {
     case Server_t::BINARY_RPC:
         return Marshaller_t::BINARY_RPC;
@@ -64,7 +69,22 @@ inline unsigned int chooseType(unsigned int type) {
         return Marshaller_t::BASE64_RPC;
     case Server_t::XML_RPC:
     default:
-        return Marshaller_t::XML_RPC;
+        return compactXml ? Marshaller_t::XML_RPC_COMPACT
+                          : Marshaller_t::XML_RPC;
+    }
+}
+
+inline Metrics_t::Protocol_t metricsProtocol(unsigned int type) {
+    switch(type) {
+    case Server_t::BINARY_RPC:
+        return Metrics_t::BINARY_RPC;
+    case Server_t::JSON:
+        return Metrics_t::JSON;
+    case Server_t::BASE64_RPC:
+        return Metrics_t::BASE64_RPC;
+    case Server_t::XML_RPC:
+    default:
+        return Metrics_t::XML_RPC;
     }
 }
 
@@ -83,18 +103,14 @@ void Server_t::serve(int fd,
             struct sockaddr_in* addr,
             HTTPHeader_t &headerIn,
             HTTPHeader_t &headerOut) {
+    // address may be of any family (caller could pass casted sockaddr_in6
+    // or sockaddr_un), ask socket for the real one unless it is IPv4
     std::string clientIP;
-    char tmpstr[256] = {};
-    if (!addr) {
-        struct sockaddr_in clientaddr;
-        socklen_t sinSize = sizeof( struct sockaddr_in );
-        if (getpeername(fd,(struct sockaddr*) &clientaddr, &sinSize) == 0 ) {
-            clientIP = inet_ntop(AF_INET, &(clientaddr.sin_addr), tmpstr, 256);
-        } else {
-            clientIP = "unknown";
-        }
+    if (addr && (addr->sin_family == AF_INET)) {
+        clientIP = Listener_t::formatAddress(
+                reinterpret_cast<struct sockaddr*>(addr), sizeof(*addr));
     } else {
-        clientIP = inet_ntop(AF_INET, &(addr->sin_addr), tmpstr, 256);
+        clientIP = Listener_t::peerAddress(fd);
     }
     serve(fd, clientIP, headerIn, headerOut);
 }
@@ -119,26 +135,39 @@ void Server_t::serve(int fd,
     do {
         Pool_t pool;
         TreeBuilder_t builder(pool);
+        LimitedBuilder_t limitedBuilder(builder, limits);
         try {
             methodRegistry.preReadCallback();
-            readRequest(builder, headerIn);
+            if (limits.enabled()) {
+                readRequest(limitedBuilder, headerIn);
+            } else {
+                readRequest(builder, headerIn);
+            }
+
+        } catch(const LimitError_t &limitError) {
+            // rest of the request is not read => can't continue
+            sendFault(MethodRegistry_t::FRPC_LIMIT_EXCEEDED_ERROR,
+                      limitError.message());
+            break;
 
         } catch(const StreamError_t &streamError) {
-            std::auto_ptr<Marshaller_t>
-                marshaller(Marshaller_t::create(chooseType(outType),
-                                                *this,
-                                                ProtocolVersion_t()));
-
-            marshaller->packFault(MethodRegistry_t::FRPC_PARSE_ERROR,
-                                  streamError.message().c_str());
-            marshaller->flush();
+            sendFault(MethodRegistry_t::FRPC_PARSE_ERROR,
+                      streamError.message());
             continue;
 
         } catch(const HTTPError_t &httpError) {
             sendHttpError(httpError);
             break;
+
+        } catch(const ProtocolError_t &protocolError) {
+            if (protocolError.errorNum() != HTTP_BODY_TOO_LONG) throw;
+            sendFault(MethodRegistry_t::FRPC_LIMIT_EXCEEDED_ERROR,
+                      protocolError.message());
+            break;
         }
 
+        if (metrics) metrics->connection(requestCount > 0);
+
         headerOut = HTTPHeader_t();
         this->headerOut = &headerOut;
 
@@ -156,16 +185,36 @@ void Server_t::serve(int fd,
             } else {
                 if ( builder.getUnMarshaledDataPtr() == 0 )
                     throw HTTPError_t(HTTP_BAD_REQUEST, "Demarshaller failed");
+                if (deadline && (Metrics_t::now() >= deadline)) {
+                    // client gave up already, don't waste handler on it
+                    sendFault(MethodRegistry_t::FRPC_TIMEOUT_ERROR,
+                              "Request deadline expired before processing.");
+                    requestCount++;
+                    continue;
+                }
+                compressor.reset(responseEncoding, compressionThreshold);
+                phases.enter(PhaseTimes_t::ENCODE);
+                DeadlineScope_t deadlineScope(deadline);
                 methodRegistry.processCall(clientAddress,
                                            builder.getUnMarshaledMethodName(),
                                            Array(builder.getUnMarshaledData()),
-                                           *this,
-                                           chooseType(outType),
-                                           protocolVersion);
+                                           compressor,
+                                           chooseType(outType, compactXml),
+                                           protocolVersion,
+                                           phaseTimes());
+                if (phases.isRunning()) {
+                    phases.stop();
+                    methodRegistry.postRequestCallback(
+                            builder.getUnMarshaledMethodName(),
+                            clientAddress, phases);
+                }
             }
         } catch(const HTTPError_t &httpError) {
-            sendHttpError(httpError);
-            break;
+            // refused call keeps the connection, reconnecting clients
+            // would only add to the overload
+            bool refused = (httpError.errorNum() == HTTP_SERVICE_UNAVAILABLE);
+            sendHttpError(httpError, refused && keepAlive);
+            if (!refused) break;
         }
 
         requestCount++;
@@ -188,6 +237,9 @@ void Server_t::readRequest(DataBuilder_t &builder,
     contentLength = 0;
     headersSent = false;
     head = false;
+    deadline = 0;
+    responseEncoding = Compression_t::NONE;
+    compressor.reset(Compression_t::NONE, 0);
     queryStorage.clear();
     queryStorage.push_back(std::string());
     queryStorage.back().reserve(BUFFER_SIZE + HTTP_BALLAST);
@@ -198,6 +250,7 @@ void Server_t::readRequest(DataBuilder_t &builder,
     std::string contentType;
     std::string uriPath;
     std::auto_ptr<UnMarshaller_t> unmarshaller;
+    Metrics_t::Protocol_t inProtocol = Metrics_t::XML_RPC;
     //SocketCloser_t closer(httpIO.socket());
 
     //read hlavicku
@@ -212,6 +265,10 @@ void Server_t::readRequest(DataBuilder_t &builder,
 
             if (line.empty())
                 continue;
+            // measure phases from arrival of request (not idle keep-alive)
+            if (callbacks) phases.start(PhaseTimes_t::READ);
+            // deadline budget counts from arrival of request too
+            deadline = Metrics_t::now();
             // break request line down
             std::vector<std::string> header(io.splitBySpace(line, 3));
             if (header.size() != 3)
@@ -263,6 +320,17 @@ void Server_t::readRequest(DataBuilder_t &builder,
         // read header from the request
         io.readHeader(headerIn);
 
+        // time the client is going to wait for the response (ms)
+        std::string timeout;
+        if (headerIn.get(HTTP_HEADER_X_FRPC_TIMEOUT, timeout) == 0) {
+            char *end;
+            long budget = strtol(timeout.c_str(), &end, 10);
+            if ((end == timeout.c_str()) || (budget < 0)) budget = -1;
+            deadline = (budget < 0) ? 0 : deadline + uint64_t(budget) * 1000;
+        } else {
+            deadline = 0;
+        }
+
         if(transferMethod != "POST")
         {
 
@@ -317,6 +385,7 @@ void Server_t::readRequest(DataBuilder_t &builder,
                     UnMarshaller_t::create(
                             UnMarshaller_t::BINARY_RPC,
                             builder));
+            inProtocol = Metrics_t::BINARY_RPC;
 
         } else if (contentType.find("text/xml") != std::string::npos) {
             unmarshaller = std::auto_ptr<UnMarshaller_t>(
@@ -332,6 +401,7 @@ void Server_t::readRequest(DataBuilder_t &builder,
                             UnMarshaller_t::URL_ENCODED,
                             builder,
                             uriPath));
+            inProtocol = Metrics_t::URL_ENCODED;
 
         } else if (contentType.find("application/x-base64-frpc")
                   != std::string::npos)
@@ -340,17 +410,44 @@ void Server_t::readRequest(DataBuilder_t &builder,
                     UnMarshaller_t::create(
                             UnMarshaller_t::BASE64,
                             builder));
+            inProtocol = Metrics_t::BASE64_RPC;
 
         } else {
             throw StreamError_t("Unknown ContentType");
         }
 
         DataSink_t data(*unmarshaller, UnMarshaller_t::TYPE_METHOD_CALL);
+        data.setPhaseTimes(phaseTimes());
+
+        // compressed request?
+        std::string contentEncoding;
+        if (headerIn.get(HTTP_HEADER_CONTENT_ENCODING, contentEncoding) == 0) {
+            Compression_t::Type_t encoding;
+            if (!Compression_t::parse(contentEncoding, encoding)) {
+                throw HTTPError_t::format(
+                        HTTP_UNSUPPORTED_MEDIA_TYPE,
+                        "Unsupported Content-Encoding: '%s'.",
+                        contentEncoding.substr(0, 30).c_str());
+            }
+            data.setContentEncoding(encoding, bodyLimit(maxBodySize));
+        }
+
+        // compress response when client accepts it
+        std::string acceptEncoding;
+        if (compressResponses
+            && (headerIn.get(HTTP_HEADER_ACCEPT_ENCODING, acceptEncoding) == 0))
+        {
+            responseEncoding = Compression_t::negotiate(acceptEncoding);
+        }
 
         // read body of request
         io.readContent(headerIn, data, true);
+        if (metrics) metrics->received(inProtocol, data.written());
 
-        unmarshaller->finish();
+        {
+            PhaseScope_t decode(phaseTimes(), PhaseTimes_t::DECODE);
+            unmarshaller->finish();
+        }
         protocolVersion = unmarshaller->getProtocolVersion();
 
         std::string connection;
@@ -395,9 +492,21 @@ void Server_t::flush() {
     } else {
         sendResponse(true);
     }
+
+    if (metrics) metrics->sent(metricsProtocol(outType), contentLength);
 }
 
-void Server_t::sendHttpError(const HTTPError_t &httpError) {
+void Server_t::sendFault(int errNum, const std::string &message) {
+    std::auto_ptr<Marshaller_t>
+        marshaller(Marshaller_t::create(chooseType(outType, compactXml),
+                                        *this,
+                                        ProtocolVersion_t()));
+
+    marshaller->packFault(errNum, message.c_str());
+    marshaller->flush();
+}
+
+void Server_t::sendHttpError(const HTTPError_t &httpError, bool keepOpen) {
     StreamHolder_t os;
     //create header
     os.os << "HTTP/1.1" << ' '
@@ -408,6 +517,9 @@ void Server_t::sendHttpError(const HTTPError_t &httpError) {
         os.os << ", application/x-frpc";
     os.os << ", application/x-www-form-urlencoded";
     os.os << "\r\n";
+    os.os << HTTP_HEADER_CONNECTION
+          << (keepOpen ? ": keep-alive" : ": close") << "\r\n";
+    os.os << HTTP_HEADER_CONTENT_LENGTH << ": 0\r\n";
     os.os << "Server:" << " Fast-RPC  Server Linux\r\n";
 
     // terminate header
@@ -418,6 +530,7 @@ void Server_t::sendHttpError(const HTTPError_t &httpError) {
 }
 
 void Server_t::sendResponse(bool last) {
+    PhaseScope_t write(phaseTimes(), PhaseTimes_t::WRITE);
     std::string headerData;
     if(!headersSent) {
         StreamHolder_t os;
@@ -478,6 +591,11 @@ void Server_t::sendResponse(bool last) {
         // write content-length or content-transfer-encoding when we can send
         // content
 
+        if (compressor.encoding() != Compression_t::NONE) {
+            os.os << HTTP_HEADER_CONTENT_ENCODING << ": "
+                  << Compression_t::name(compressor.encoding()) << "\r\n";
+        }
+
         if (!useChunks) {
             os.os << HTTP_HEADER_CONTENT_LENGTH << ": " << contentLength
             << "\r\n";
@@ -43,8 +43,15 @@
 #include <frpcwriter.h>
 #include <frpc.h>
 #include <frpchttperror.h>
+#include <frpclimitedbuilder.h>
+#include <frpccompression.h>
+#include <frpcmetrics.h>
+#include <frpcphasetimes.h>
+#include <frpcadmission.h>
+#include <frpcsingleflight.h>
 #include <list>
 #include <string>
+#include <limits.h>
 
 
 namespace FRPC {
@@ -83,7 +90,12 @@ public:
             : readTimeout(readTimeout), writeTimeout(writeTimeout),
               keepAlive(keepAlive), useBinary(true),
               maxKeepalive(maxKeepalive),
-              introspectionEnabled(introspectionEnabled), callbacks(callbacks)
+              introspectionEnabled(introspectionEnabled), callbacks(callbacks),
+              maxBodySize(0), maxDepth(0), maxElements(0), maxPoolBytes(0),
+              compressResponses(false),
+              compressionThreshold(Compression_t::DEFAULT_THRESHOLD),
+              metrics(0), compactXml(false), admission(0),
+              singleFlight(0)
                 //,path(path)
         {}
 
@@ -108,7 +120,12 @@ public:
             : readTimeout(readTimeout), writeTimeout(writeTimeout),
               keepAlive(keepAlive), useBinary(useBinary),
               maxKeepalive(maxKeepalive),
-              introspectionEnabled(introspectionEnabled), callbacks(callbacks)
+              introspectionEnabled(introspectionEnabled), callbacks(callbacks),
+              maxBodySize(0), maxDepth(0), maxElements(0), maxPoolBytes(0),
+              compressResponses(false),
+              compressionThreshold(Compression_t::DEFAULT_THRESHOLD),
+              metrics(0), compactXml(false), admission(0),
+              singleFlight(0)
                 //,path(path)
         {}
         /**
@@ -123,12 +140,24 @@ public:
             @n @b maxKeepalive = 0
             @n @b introspectionEnabled = true
             @n @b callbacks = 0
+            @n @b maxBodySize, maxDepth, maxElements, maxPoolBytes = 0
+            (unlimited)
+            @n @b compressResponses = false
+            @n @b compressionThreshold = 1024 B
+            @n @b metrics = 0
+            @n @b compactXml = false
+            @n @b admission = 0
+            @n @b singleFlight = 0
 
         */
         Config_t()
             : readTimeout(10000), writeTimeout(1000), keepAlive(false),
               useBinary(true), maxKeepalive(0), introspectionEnabled(true),
-              callbacks(0)
+              callbacks(0), maxBodySize(0), maxDepth(0), maxElements(0),
+              maxPoolBytes(0), compressResponses(false),
+              compressionThreshold(Compression_t::DEFAULT_THRESHOLD),
+              metrics(0), compactXml(false), admission(0),
+              singleFlight(0)
         {}
 
         ///@brief internal representation of readTimeout value
@@ -146,18 +175,71 @@ public:
         bool introspectionEnabled;
 
         MethodRegistry_t::Callbacks_t *callbacks;
+
+        /*
+         * Security limits of the request, zero means unlimited. Request
+         * exceeding any of them is answered by FRPC_LIMIT_EXCEEDED_ERROR
+         * fault and the connection is closed.
+         */
+
+        ///@brief max size of HTTP body in bytes (clamped to INT_MAX)
+        unsigned int maxBodySize;
+        ///@brief max nesting of arrays and structs
+        unsigned int maxDepth;
+        ///@brief max number of values in the request
+        unsigned long maxElements;
+        ///@brief max (estimated) memory of decoded request in bytes
+        unsigned long maxPoolBytes;
+
+        /*
+         * Compressed requests (Content-Encoding gzip/deflate) are always
+         * accepted; responses are compressed only when enabled here and the
+         * client sends matching Accept-Encoding.
+         */
+
+        ///@brief compress responses for clients accepting it
+        bool compressResponses;
+        ///@brief responses smaller than this (bytes) stay uncompressed
+        unsigned int compressionThreshold;
+
+        ///@brief call and traffic statistics (not owned, may be shared by
+        ///       more servers), 0 = not collected
+        Metrics_t *metrics;
+
+        ///@brief XML-RPC responses without line breaks between tags
+        bool compactXml;
+
+        ///@brief limits of concurrent calls (not owned, should be shared
+        ///       by all servers of Acceptor_t), 0 = no limits
+        AdmissionControl_t *admission;
+
+        ///@brief coalescing of identical concurrent calls (not owned,
+        ///       should be shared by all servers of Acceptor_t), 0 = off
+        SingleFlight_t *singleFlight;
     };
 
     Server_t(Config_t &config)
         : Writer_t(),
           methodRegistry(config.callbacks, config.introspectionEnabled),
-          io(0, config.readTimeout, config.writeTimeout, -1, -1),
+          io(0, config.readTimeout, config.writeTimeout, -1,
+             bodyLimit(config.maxBodySize)),
           keepAlive(config.keepAlive), useBinary(config.useBinary),
           maxKeepalive(config.maxKeepalive), callbacks(config.callbacks),
           /*path(config.path), */outType(XML_RPC), closeConnection(true),
           queryStorage(), contentLength(0), useChunks(false),
-          headersSent(false), head(false), headerOut(0x0)
-    {}
+          headersSent(false), head(false), headerOut(0x0),
+          limits(config.maxDepth, config.maxElements, config.maxPoolBytes),
+          maxBodySize(config.maxBodySize),
+          compressResponses(config.compressResponses),
+          compressionThreshold(config.compressionThreshold),
+          responseEncoding(Compression_t::NONE), compressor(*this),
+          metrics(config.metrics), compactXml(config.compactXml),
+          deadline(0)
+    {
+        if (metrics) methodRegistry.setMetrics(metrics);
+        methodRegistry.setAdmission(config.admission);
+        methodRegistry.setSingleFlight(config.singleFlight);
+    }
 
     void serve(int fd, struct sockaddr_in* addr = 0);
 
@@ -203,8 +285,32 @@ private:
     /**
     * @brief send HTTP header with HTTPError_t to client
     *
+    * @param keepOpen connection stays open for next request
+    */
+    void sendHttpError(const HTTPError_t &httpError, bool keepOpen = false);
+    /**
+    * @brief send fault to client (used when request can't be processed)
+    *
+    */
+    void sendFault(int errNum, const std::string &message);
+
+    /**
+    * @brief body limit for HTTPIO_t, -1 = unlimited
+    *
+    * Values above INT_MAX are clamped instead of wrapping to negative
+    * (i.e. unlimited) numbers.
     */
-    void sendHttpError(const HTTPError_t &httpError);
+    static int bodyLimit(unsigned int maxBodySize) {
+        if (!maxBodySize) return -1;
+        return (maxBodySize > unsigned(INT_MAX)) ? INT_MAX : int(maxBodySize);
+    }
+
+    /**
+    * @brief phase times to fill, 0 when nobody listens (no callbacks)
+    */
+    PhaseTimes_t* phaseTimes() {
+        return callbacks ? &phases : 0;
+    }
 
     Server_t();
 
@@ -225,6 +331,16 @@ private:
     bool head;
     ProtocolVersion_t protocolVersion;
     HTTPHeader_t *headerOut;
+    LimitedBuilder_t::Limits_t limits;
+    unsigned int maxBodySize;
+    bool compressResponses;
+    unsigned int compressionThreshold;
+    Compression_t::Type_t responseEncoding;       //!< negotiated coding
+    CompressingWriter_t compressor;
+    Metrics_t *metrics;
+    bool compactXml;                              //!< XML without breaks
+    PhaseTimes_t phases;                          //!< current request
+    uint64_t deadline;                            //!< of current request
 };
 
 }
@@ -33,9 +33,18 @@
 
 #include <sstream>
 #include <memory>
+#include <map>
+#include <vector>
+#include <algorithm>
 
 #include <stdarg.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <fnmatch.h>
+#include <poll.h>
 
+#include "nonglibc.h"
 #include "frpcserverproxy.h"
 #include <frpc.h>
 #include <frpctreebuilder.h>
@@ -43,11 +52,20 @@
 #include <memory>
 #include <frpcfault.h>
 #include <frpcresponseerror.h>
+#include <frpcprotocolerror.h>
 
 #include <frpcstruct.h>
 #include <frpcstring.h>
 #include <frpcint.h>
 #include <frpcbool.h>
+#include <frpcstreamerror.h>
+#include <frpccompression.h>
+#include <frpcmetrics.h>
+#include <frpcmethodregistry.h>
+#include <frpcdeadline.h>
+#include <frpcsingleflight.h>
+#include <frpcresponsecache.h>
+#include "frpcutils.h"
 
 
 namespace {
@@ -81,6 +99,20 @@ namespace {
         return FRPC::ProtocolVersion_t(major, minor);
     }
 
+    unsigned int parseCompression(const FRPC::Struct_t &config,
+                                  const std::string &name)
+    {
+        std::string encoding
+            (FRPC::String(config.get(name, FRPC::String_t::FRPC_EMPTY)));
+
+        FRPC::Compression_t::Type_t type;
+        if (!FRPC::Compression_t::parse(encoding, type)) {
+            throw FRPC::StreamError_t::format(
+                "Unknown compression '%s'.", encoding.c_str());
+        }
+        return type;
+    }
+
     FRPC::ServerProxy_t::Config_t configFromStruct(const FRPC::Struct_t &s)
     {
         FRPC::ServerProxy_t::Config_t config;
@@ -93,20 +125,86 @@ namespace {
         config.protocolVersion = parseProtocolVersion(s, "protocolVersion");
         config.connectTimeout = getTimeout(s, "connectTimeout", 10000);
         config.keepAlive = FRPC::Bool(s.get("keepAlive", FRPC::Bool_t::FRPC_FALSE));
+        config.raceConnect = FRPC::Bool(s.get("raceConnect", FRPC::Bool_t::FRPC_FALSE));
+        config.connectAttemptDelay = getTimeout(s, "connectAttemptDelay", 250);
+        config.dnsCacheTtl = getTimeout(s, "dnsCacheTtl", 60);
+        config.failedAddressPenalty = getTimeout(s, "failedAddressPenalty", 30);
+        config.requestCompression = parseCompression(s, "requestCompression");
+        config.compressionThreshold = getTimeout(
+            s, "compressionThreshold", FRPC::Compression_t::DEFAULT_THRESHOLD);
+        config.acceptCompression = FRPC::Bool(
+            s.get("acceptCompression", FRPC::Bool_t::FRPC_FALSE));
+        config.compactXml = FRPC::Bool(
+            s.get("compactXml", FRPC::Bool_t::FRPC_FALSE));
+        config.idempotentMethods = FRPC::String(
+            s.get("idempotentMethods", FRPC::String_t::FRPC_EMPTY));
+        config.maxRetries = getTimeout(s, "maxRetries", 0);
+        config.retryBackoff = getTimeout(s, "retryBackoff", 50);
+        config.retryBackoffMax = getTimeout(s, "retryBackoffMax", 1000);
+        config.hedgeDelay = getTimeout(s, "hedgeDelay", 0);
+        config.sendDeadline = FRPC::Bool(
+            s.get("sendDeadline", FRPC::Bool_t::FRPC_FALSE));
 
         return config;
     }
 
     FRPC::Connector_t* makeConnector(
         const FRPC::URL_t &url,
-        const unsigned &connectTimeout,
-        const bool &keepAlive)
+        const FRPC::ServerProxy_t::Config_t &config)
     {
         if (url.isUnix()) {
             return new FRPC::SimpleConnectorUnix_t(
-               url, connectTimeout, keepAlive);
+               url, config.connectTimeout, config.keepAlive);
+        }
+        if (config.raceConnect) {
+            return new FRPC::RacingConnector_t(
+                url, config.connectTimeout, config.keepAlive,
+                config.connectAttemptDelay, config.dnsCacheTtl,
+                config.failedAddressPenalty);
+        }
+        return new FRPC::SimpleConnectorIPv6_t(
+            url, config.connectTimeout, config.keepAlive);
+    }
+
+    /** Whether failed call may be repeated: network errors and responses
+     *  of overloaded or unreachable upstream.
+     */
+    bool retryable(const FRPC::ProtocolError_t &error) {
+        switch (error.errorNum()) {
+        case FRPC::HTTP_TIMEOUT:
+        case FRPC::HTTP_SYSCALL:
+        case FRPC::HTTP_CLOSED:
+        case FRPC::HTTP_DNS:
+        case FRPC::HTTP_BAD_GATEWAY:
+        case FRPC::HTTP_SERVICE_UNAVAILABLE:
+        case FRPC::HTTP_GATEWAY_TIMEOUT:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    /** Wait until one of sockets is readable.
+     *  @return 1 or 2 for first or second socket, 0 on timeout
+     */
+    int waitReadable(int first, int second, int timeout) {
+        pollfd pfd[2];
+        pfd[0].fd = first;
+        pfd[0].events = POLLIN;
+        pfd[0].revents = 0;
+        pfd[1].fd = second;
+        pfd[1].events = POLLIN;
+        pfd[1].revents = 0;
+
+        if (TEMP_FAILURE_RETRY(::poll(pfd, 2, timeout)) <= 0) return 0;
+        return pfd[0].revents ? 1 : 2;
+    }
+
+    void closeSocket(FRPC::HTTPIO_t &io) {
+        if (io.socket() > -1) {
+            TEMP_FAILURE_RETRY(::close(io.socket()));
+            io.socket() = -1;
         }
-        return new FRPC::SimpleConnectorIPv6_t(url, connectTimeout, keepAlive);
     }
 }
 
@@ -121,29 +219,57 @@ public:
           rpcTransferMode(config.useBinary), useHTTP10(config.useHTTP10),
           serverSupportedProtocols(HTTPClient_t::XML_RPC),
           protocolVersion(config.protocolVersion),
-          connector(makeConnector(url, config.connectTimeout,
-                                          config.keepAlive))
+          connector(makeConnector(url, config)),
+          requestCompression(
+              static_cast<Compression_t::Type_t>(config.requestCompression)),
+          compressionThreshold(config.compressionThreshold),
+          acceptCompression(config.acceptCompression),
+          metrics(config.metrics),
+          xmlType(config.compactXml ? Marshaller_t::XML_RPC_COMPACT
+                                    : Marshaller_t::XML_RPC),
+          idempotentMethods(splitPatterns(config.idempotentMethods)),
+          maxRetries(config.maxRetries), retryBackoff(config.retryBackoff),
+          retryBackoffMax(config.retryBackoffMax),
+          hedgeDelay(config.hedgeDelay), readTimeout(config.readTimeout),
+          sendDeadline(config.sendDeadline), singleFlight(config.singleFlight),
+          responseCache(config.responseCache),
+          hedgeIo(-1, config.readTimeout, config.writeTimeout, -1 ,-1),
+          hedgeConnector(config.hedgeDelay ? makeConnector(url, config) : 0),
+          seed(static_cast<unsigned int>(time(0))
+               ^ static_cast<unsigned int>(reinterpret_cast<size_t>(this)))
     {}
 
+    ~ServerProxyImpl_t() {
+        closeSocket(hedgeIo);
+    }
+
     /** Set new read timeout */
     void setReadTimeout(int timeout) {
         io.setReadTimeout(timeout);
+        hedgeIo.setReadTimeout(timeout);
+        readTimeout = timeout;
     }
 
     /** Set new write timeout */
     void setWriteTimeout(int timeout) {
         io.setWriteTimeout(timeout);
+        hedgeIo.setWriteTimeout(timeout);
     }
 
     /** Set new connect timeout */
     void setConnectTimeout(int timeout) {
         connector->setTimeout(timeout);
+        if (hedgeConnector.get()) hedgeConnector->setTimeout(timeout);
     }
 
     const URL_t& getURL() {
         return url;
     }
 
+    const PhaseTimes_t& getLastCallPhases() {
+        return lastCallPhases;
+    }
+
     /** Create marshaller.
      */
     Marshaller_t* createMarshaller(HTTPClient_t &client);
@@ -169,6 +295,85 @@ public:
     void deleteRequestHttpHeaders();
 
 private:
+    typedef Array_t::const_iterator Params_t;
+
+    /** Call method with params given by range, using cached result or
+     *  coalescing identical concurrent calls by single flight.
+     */
+    Value_t& call(Pool_t &pool, const std::string &methodName,
+                  Params_t begin, Params_t end);
+
+    /** Call method on the server, retrying and hedging idempotent
+     *  methods.
+     */
+    Value_t& callServer(Pool_t &pool, const std::string &methodName,
+                        Params_t begin, Params_t end);
+
+    /** Call on the server run by single flight.
+     */
+    class ServerCall_t : public SingleFlight_t::Call_t {
+    public:
+        ServerCall_t(ServerProxyImpl_t &proxy, const std::string &methodName,
+                     Params_t begin, Params_t end)
+            : proxy(proxy), methodName(methodName), begin(begin), end(end)
+        {}
+
+        virtual Value_t& operator()(Pool_t &pool) {
+            return proxy.callServer(pool, methodName, begin, end);
+        }
+
+    private:
+        ServerProxyImpl_t &proxy;
+        const std::string &methodName;
+        Params_t begin;
+        Params_t end;
+    };
+
+    /** One attempt of call. With hedge builder given, the request is
+     *  sent once more if no response comes within hedge delay.
+     *  @return builder that got the response
+     */
+    DataBuilder_t& exchange(DataBuilder_t &builder,
+                            DataBuilder_t *hedgeBuilder,
+                            const std::string &methodName,
+                            Params_t begin, Params_t end,
+                            const HTTPClient_t::HeaderVector_t &callHeaders);
+
+    /** Marshal and send request.
+     */
+    void sendRequest(HTTPClient_t &client, const std::string &methodName,
+                     Params_t begin, Params_t end,
+                     const HTTPClient_t::HeaderVector_t &callHeaders,
+                     int timeout);
+
+    /** Read timeout of next attempt: configured one shortened to the
+     *  remaining time of inherited deadline (see Deadline_t).
+     *  @throw Fault_t FRPC_TIMEOUT_ERROR when the deadline has expired
+     */
+    int attemptTimeout() const;
+
+    /** Remember server capabilities and record finished exchange.
+     */
+    void finishExchange(HTTPClient_t &client);
+
+    /** Whether method name matches some of idempotent patterns.
+     */
+    bool isIdempotent(const std::string &methodName) const;
+
+    /** Sleep before given retry (exponential backoff, full jitter).
+     */
+    void backoff(unsigned int attempt);
+
+    /** Statistics of given method (0 if metrics are not collected).
+     */
+    Metrics_t::MethodStats_t* methodStats(const std::string &methodName);
+
+    /** Record traffic and phase times of finished HTTP exchange.
+     */
+    void recordExchange(const HTTPClient_t &client);
+
+    typedef std::map<std::string, Metrics_t::MethodStats_t*> StatsMap_t;
+
     URL_t url;
     HTTPIO_t io;
     unsigned int rpcTransferMode;
@@ -178,9 +383,82 @@ private:
     std::auto_ptr<Connector_t> connector;
     HTTPClient_t::HeaderVector_t requestHttpHeadersForCall;
     HTTPClient_t::HeaderVector_t requestHttpHeaders;
+    Compression_t::Type_t requestCompression;
+    unsigned int compressionThreshold;
+    bool acceptCompression;
+    Metrics_t *metrics;
+    unsigned int xmlType;           //!< plain or compact XML marshaller
+    StatsMap_t stats;
+    PhaseTimes_t lastCallPhases;
+    std::vector<std::string> idempotentMethods;
+    unsigned int maxRetries;
+    unsigned int retryBackoff;
+    unsigned int retryBackoffMax;
+    unsigned int hedgeDelay;
+    int readTimeout;
+    bool sendDeadline;
+    SingleFlight_t *singleFlight;   //!< coalescing of identical calls
+    ResponseCache_t *responseCache;
+    HTTPIO_t hedgeIo;               //!< connection for hedged requests
+    std::auto_ptr<Connector_t> hedgeConnector;
+    unsigned int seed;              //!< backoff jitter
 };
 
+namespace {
+    /** Record one call to the method statistics on destruction. Call ends
+     *  as network error unless success() or fault() is called.
+     */
+    class CallMetrics_t {
+    public:
+        CallMetrics_t(Metrics_t::MethodStats_t *stats)
+            : stats(stats), start(stats ? Metrics_t::now() : 0),
+              code(MethodRegistry_t::FRPC_NETWORK_ERROR)
+        {}
+
+        ~CallMetrics_t() {
+            if (stats) stats->record(Metrics_t::now() - start, code != 0, code);
+        }
+
+        void success() { code = 0; }
+
+        void fault(int errorNum) { code = errorNum ? errorNum : -1; }
+
+    private:
+        CallMetrics_t(const CallMetrics_t&);
+        CallMetrics_t& operator=(const CallMetrics_t&);
+
+        Metrics_t::MethodStats_t *stats;
+        uint64_t start;
+        int code;
+    };
+}
+
+Metrics_t::MethodStats_t*
+ServerProxyImpl_t::methodStats(const std::string &methodName) {
+    if (!metrics) return 0;
+    StatsMap_t::iterator istats = stats.find(methodName);
+    if (istats == stats.end()) {
+        istats = stats.insert(StatsMap_t::value_type(
+                methodName, &metrics->method(methodName))).first;
+    }
+    return istats->second;
+}
+
+void ServerProxyImpl_t::recordExchange(const HTTPClient_t &client) {
+    lastCallPhases = client.phaseTimes();
+    if (!metrics) return;
+    Metrics_t::Protocol_t protocol =
+        (client.requestProtocol() == HTTPClient_t::BINARY_RPC)
+        ? Metrics_t::BINARY_RPC : Metrics_t::XML_RPC;
+    metrics->connection(client.connectionReused());
+    metrics->sent(protocol, client.bytesSent());
+    metrics->received(protocol, client.bytesReceived());
+}
+
 Marshaller_t* ServerProxyImpl_t::createMarshaller(HTTPClient_t &client) {
+    client.setCompression(requestCompression, compressionThreshold,
+                          acceptCompression);
+
     Marshaller_t *marshaller;
     switch (rpcTransferMode) {
     case ServerProxy_t::Config_t::ON_SUPPORT:
@@ -188,12 +466,12 @@ Marshaller_t* ServerProxyImpl_t::createMarshaller(HTTPClient_t &client) {
             if (serverSupportedProtocols & HTTPClient_t::BINARY_RPC) {
                 //using BINARY_RPC
                 marshaller= Marshaller_t::create(Marshaller_t::BINARY_RPC,
-                                                 client,protocolVersion);
+                                                 client.writer(), protocolVersion);
                 client.prepare(HTTPClient_t::BINARY_RPC);
             } else {
                 //using XML_RPC
                 marshaller = Marshaller_t::create
-                    (Marshaller_t::XML_RPC,client, protocolVersion);
+                    (xmlType,client.writer(), protocolVersion);
                 client.prepare(HTTPClient_t::XML_RPC);
             }
         }
@@ -202,8 +480,8 @@ Marshaller_t* ServerProxyImpl_t::createMarshaller(HTTPClient_t &client) {
     case ServerProxy_t::Config_t::NEVER:
         {
             // never using BINARY_RPC
-            marshaller= Marshaller_t::create(Marshaller_t::XML_RPC,
-                                             client,protocolVersion);
+            marshaller= Marshaller_t::create(xmlType,
+                                             client.writer(), protocolVersion);
             client.prepare(HTTPClient_t::XML_RPC);
         }
     break;
@@ -212,7 +490,7 @@ Marshaller_t* ServerProxyImpl_t::createMarshaller(HTTPClient_t &client) {
         {
             //using BINARY_RPC  always
             marshaller= Marshaller_t::create(Marshaller_t::BINARY_RPC,
-                                             client,protocolVersion);
+                                             client.writer(), protocolVersion);
             client.prepare(HTTPClient_t::BINARY_RPC);
         }
     break;
@@ -225,12 +503,12 @@ Marshaller_t* ServerProxyImpl_t::createMarshaller(HTTPClient_t &client) {
                 || io.socket() != -1) {
                 //using XML_RPC
                 marshaller= Marshaller_t::create
-                    (Marshaller_t::XML_RPC,client, protocolVersion);
+                    (xmlType,client.writer(), protocolVersion);
                 client.prepare(HTTPClient_t::XML_RPC);
             } else {
                 //using BINARY_RPC
                 marshaller= Marshaller_t::create
-                    (Marshaller_t::BINARY_RPC, client,protocolVersion);
+                    (Marshaller_t::BINARY_RPC, client.writer(), protocolVersion);
                 client.prepare(HTTPClient_t::BINARY_RPC);
             }
         }
@@ -254,67 +532,224 @@ ServerProxy_t::~ServerProxy_t() {
     // get rid of implementation
 }
 
-Value_t& ServerProxyImpl_t::call(Pool_t &pool, const std::string &methodName,
-                                 const Array_t &params)
-{
-    HTTPClient_t client(io, url, connector.get(), useHTTP10);
+bool ServerProxyImpl_t::isIdempotent(const std::string &methodName) const {
+    for (std::vector<std::string>::const_iterator
+             i = idempotentMethods.begin(); i != idempotentMethods.end(); ++i)
     {
-        client.addCustomRequestHeader(requestHttpHeaders);
-        client.addCustomRequestHeader(requestHttpHeadersForCall);
-        requestHttpHeadersForCall.clear();
+        if (!fnmatch(i->c_str(), methodName.c_str(), 0)) return true;
+    }
+    return false;
+}
+
+void ServerProxyImpl_t::backoff(unsigned int attempt) {
+    unsigned long bound = static_cast<unsigned long>(retryBackoff)
+        << std::min(attempt, 16u);
+    if (bound > retryBackoffMax) bound = retryBackoffMax;
+    unsigned long delay = rand_r(&seed) % (bound + 1);
+    if (delay) ::usleep(delay * 1000);
+}
+
+int ServerProxyImpl_t::attemptTimeout() const {
+    long remaining = Deadline_t::remaining();
+    if (remaining < 0) return readTimeout;
+    if (remaining == 0) {
+        throw Fault_t(MethodRegistry_t::FRPC_TIMEOUT_ERROR,
+                      "Deadline expired before call.");
     }
-    TreeBuilder_t builder(pool);
+    if ((readTimeout >= 0) && (readTimeout < remaining)) return readTimeout;
+    return int(remaining);
+}
+
+void ServerProxyImpl_t::sendRequest(
+        HTTPClient_t &client, const std::string &methodName,
+        Params_t begin, Params_t end,
+        const HTTPClient_t::HeaderVector_t &callHeaders, int timeout)
+{
+    if (sendDeadline || Deadline_t::get()) client.setTimeoutBudget(timeout);
+    client.addCustomRequestHeader(requestHttpHeaders);
+    client.addCustomRequestHeader(callHeaders);
     std::auto_ptr<Marshaller_t>marshaller(createMarshaller(client));
     TreeFeeder_t feeder(*marshaller);
 
     try {
         marshaller->packMethodCall(methodName.c_str());
-        for (Array_t::const_iterator
-                 iparams = params.begin(),
-                 eparams = params.end();
-             iparams != eparams; ++iparams) {
-            feeder.feedValue(**iparams);
-        }
+        for (; begin != end; ++begin)
+            feeder.feedValue(**begin);
 
         marshaller->flush();
     } catch (const ResponseError_t &e) {}
+}
 
-    client.readResponse(builder);
+void ServerProxyImpl_t::finishExchange(HTTPClient_t &client) {
     serverSupportedProtocols = client.getSupportedProtocols();
     protocolVersion = client.getProtocolVersion();
-
-    // OK, return unmarshalled data (throws fault if NULL)
-    return builder.getUnMarshaledData();
+    recordExchange(client);
 }
 
-
-void ServerProxyImpl_t::call(DataBuilder_t &builder, const std::string &methodName,
-                                 const Array_t &params)
+DataBuilder_t& ServerProxyImpl_t::exchange(
+        DataBuilder_t &builder, DataBuilder_t *hedgeBuilder,
+        const std::string &methodName, Params_t begin, Params_t end,
+        const HTTPClient_t::HeaderVector_t &callHeaders)
 {
+    int timeout = attemptTimeout();
+    uint64_t start = Metrics_t::now();
+    io.setReadTimeout(timeout);
     HTTPClient_t client(io, url, connector.get(), useHTTP10);
-    {
-        client.addCustomRequestHeader(requestHttpHeaders);
-        client.addCustomRequestHeader(requestHttpHeadersForCall);
-        requestHttpHeadersForCall.clear();
+    sendRequest(client, methodName, begin, end, callHeaders, timeout);
+
+    if (!hedgeBuilder || waitReadable(io.socket(), -1, hedgeDelay)) {
+        client.readResponse(builder);
+        finishExchange(client);
+        return builder;
     }
-    std::auto_ptr<Marshaller_t>marshaller(createMarshaller(client));
-    TreeFeeder_t feeder(*marshaller);
 
+    // both requests get only what is left of the attempt timeout
+    if (timeout >= 0) {
+        uint64_t spent = (Metrics_t::now() - start) / 1000;
+        if (spent >= uint64_t(timeout)) {
+            closeSocket(io);
+            throw ProtocolError_t(HTTP_TIMEOUT, "Timeout while reading.");
+        }
+        timeout -= int(spent);
+        io.setReadTimeout(timeout);
+    }
+
+    // no response within hedge delay, ask once more over other connection
+    hedgeIo.setReadTimeout(timeout);
+    HTTPClient_t hedge(hedgeIo, url, hedgeConnector.get(), useHTTP10);
     try {
-        marshaller->packMethodCall(methodName.c_str());
-        for (Array_t::const_iterator
-                 iparams = params.begin(),
-                 eparams = params.end();
-             iparams != eparams; ++iparams) {
-            feeder.feedValue(**iparams);
+        sendRequest(hedge, methodName, begin, end, callHeaders, timeout);
+    } catch (const ProtocolError_t &) {
+        client.readResponse(builder);
+        finishExchange(client);
+        return builder;
+    }
+
+    int ready = waitReadable(io.socket(), hedgeIo.socket(), timeout);
+    if (!ready) {
+        closeSocket(io);
+        closeSocket(hedgeIo);
+        throw ProtocolError_t(HTTP_TIMEOUT, "Timeout while reading.");
+    }
+
+    HTTPClient_t &winner = (ready == 1) ? client : hedge;
+    HTTPClient_t &loser = (ready == 1) ? hedge : client;
+    DataBuilder_t &winnerBuilder = (ready == 1) ? builder : *hedgeBuilder;
+    DataBuilder_t &loserBuilder = (ready == 1) ? *hedgeBuilder : builder;
+    HTTPIO_t &loserIo = (ready == 1) ? hedgeIo : io;
+    try {
+        winner.readResponse(winnerBuilder);
+    } catch (const ProtocolError_t &) {
+        // the other request is still running
+        if (loserIo.socket() < 0) throw;
+        loser.readResponse(loserBuilder);
+        finishExchange(loser);
+        return loserBuilder;
+    }
+
+    // cancel the slower request
+    closeSocket(loserIo);
+    finishExchange(winner);
+    return winnerBuilder;
+}
+
+Value_t& ServerProxyImpl_t::call(Pool_t &pool, const std::string &methodName,
+                                 Params_t begin, Params_t end)
+{
+    // per call headers may change the response
+    bool shared = requestHttpHeadersForCall.empty();
+    unsigned int ttl = (responseCache && shared)
+        ? responseCache->ttl(methodName) : 0;
+    bool coalesced = singleFlight && shared
+        && singleFlight->covers(methodName);
+    if (!ttl && !coalesced)
+        return callServer(pool, methodName, begin, end);
+
+    // persistent headers (auth, tenant) scope the key as well
+    std::string scope(url.getUrl());
+    for (HTTPClient_t::HeaderVector_t::const_iterator
+             iheader = requestHttpHeaders.begin(),
+             eheader = requestHttpHeaders.end();
+         iheader != eheader; ++iheader)
+        scope.append("\n").append(iheader->first)
+            .append(": ").append(iheader->second);
+
+    std::string key(SingleFlight_t::key(scope, methodName, begin, end));
+    if (ttl) {
+        if (Value_t *cached = responseCache->get(pool, key))
+            return *cached;
+    }
+
+    Value_t *result;
+    if (coalesced) {
+        ServerCall_t call(*this, methodName, begin, end);
+        result = &singleFlight->call(pool, key, call);
+    } else {
+        result = &callServer(pool, methodName, begin, end);
+    }
+
+    if (ttl) responseCache->put(key, *result, ttl);
+    return *result;
+}
+
+Value_t& ServerProxyImpl_t::callServer(Pool_t &pool,
+                                       const std::string &methodName,
+                                       Params_t begin, Params_t end)
+{
+    CallMetrics_t callMetrics(methodStats(methodName));
+    HTTPClient_t::HeaderVector_t callHeaders;
+    callHeaders.swap(requestHttpHeadersForCall);
+    bool idempotent = isIdempotent(methodName);
+    bool hedged = idempotent && hedgeDelay;
+
+    for (unsigned int attempt = 0; ; ++attempt) {
+        TreeBuilder_t builder(pool);
+        TreeBuilder_t hedgeBuilder(pool);
+        TreeBuilder_t *response;
+        try {
+            response = (&exchange(builder, hedged ? &hedgeBuilder : 0,
+                                  methodName, begin, end, callHeaders)
+                        == &builder) ? &builder : &hedgeBuilder;
+        } catch (const ProtocolError_t &error) {
+            if (!idempotent || (attempt >= maxRetries) || !retryable(error))
+                throw;
+            backoff(attempt);
+            continue;
+        } catch (const Fault_t &fault) {
+            // inherited deadline expired
+            callMetrics.fault(fault.errorNum());
+            throw;
         }
 
-        marshaller->flush();
-    } catch (const ResponseError_t &e) {}
+        // OK, return unmarshalled data (throws fault if NULL)
+        try {
+            Value_t &result = response->getUnMarshaledData();
+            callMetrics.success();
+            return result;
+        } catch (const Fault_t &fault) {
+            callMetrics.fault(fault.errorNum());
+            throw;
+        }
+    }
+}
 
-    client.readResponse(builder);
-    serverSupportedProtocols = client.getSupportedProtocols();
-    protocolVersion = client.getProtocolVersion();
+Value_t& ServerProxyImpl_t::call(Pool_t &pool, const std::string &methodName,
+                                 const Array_t &params)
+{
+    return call(pool, methodName, params.begin(), params.end());
+}
+
+void ServerProxyImpl_t::call(DataBuilder_t &builder, const std::string &methodName,
+                                 const Array_t &params)
+{
+    CallMetrics_t callMetrics(methodStats(methodName));
+    HTTPClient_t::HeaderVector_t callHeaders;
+    callHeaders.swap(requestHttpHeadersForCall);
+
+    // custom builder can't be reset, so it is neither retried nor hedged
+    exchange(builder, 0, methodName, params.begin(), params.end(),
+             callHeaders);
+    callMetrics.success();
 }
 
 
@@ -327,32 +762,13 @@ Value_t& ServerProxy_t::call(Pool_t &pool, const std::string &methodName,
 Value_t& ServerProxyImpl_t::call(Pool_t &pool, const char *methodName,
                                  va_list args)
 {
-    HTTPClient_t client(io, url, connector.get(), useHTTP10);
-    {
-        client.addCustomRequestHeader(requestHttpHeaders);
-        client.addCustomRequestHeader(requestHttpHeadersForCall);
-        requestHttpHeadersForCall.clear();
-    }
-    TreeBuilder_t builder(pool);
-    std::auto_ptr<Marshaller_t>marshaller(createMarshaller(client));
-    TreeFeeder_t feeder(*marshaller);
-
-    try {
-        marshaller->packMethodCall(methodName);
-
-        // marshall all passed values until null pointer
-        while (const Value_t *value = va_arg(args, Value_t*))
-            feeder.feedValue(*value);
+    // collect all passed values until null pointer
+    std::vector<Value_t*> params;
+    while (Value_t *value = va_arg(args, Value_t*))
+        params.push_back(value);
 
-        marshaller->flush();
-    } catch (const ResponseError_t &e) {}
-
-    client.readResponse(builder);
-    serverSupportedProtocols = client.getSupportedProtocols();
-    protocolVersion = client.getProtocolVersion();
-
-    // OK, return unmarshalled data (throws fault if NULL)
-    return builder.getUnMarshaledData();
+    if (params.empty()) return call(pool, methodName, 0, 0);
+    return call(pool, methodName, &params[0], &params[0] + params.size());
 }
 
 void ServerProxyImpl_t::addRequestHttpHeaderForCall(const HTTPClient_t::Header_t& header)
@@ -430,6 +846,10 @@ const URL_t& ServerProxy_t::getURL() {
     return sp->getURL();
 }
 
+const PhaseTimes_t& ServerProxy_t::getLastCallPhases() {
+    return sp->getLastCallPhases();
+}
+
 void ServerProxy_t::addRequestHttpHeaderForCall(const HTTPClient_t::Header_t& header) {
     sp->addRequestHttpHeaderForCall(header);
 }
@@ -55,6 +55,12 @@ class Struct_t;
 
 class DataBuilder_t;
 
+class Metrics_t;
+
+class SingleFlight_t;
+
+class ResponseCache_t;
+
 /**
 @brief ServerProxy Object
 
@@ -94,7 +100,14 @@ public:
                  bool keepAlive, unsigned int useBinary, bool useHTTP10 = false)
             : connectTimeout(connectTimeout),readTimeout(readTimeout),
               writeTimeout(writeTimeout),
-              keepAlive(keepAlive), useBinary(useBinary), useHTTP10(useHTTP10)
+              keepAlive(keepAlive), useBinary(useBinary), useHTTP10(useHTTP10),
+              raceConnect(false), connectAttemptDelay(250), dnsCacheTtl(60),
+              failedAddressPenalty(30), requestCompression(0),
+              compressionThreshold(1024), acceptCompression(false),
+              metrics(0), compactXml(false), maxRetries(0),
+              retryBackoff(50), retryBackoffMax(1000), hedgeDelay(0),
+              sendDeadline(false), singleFlight(0),
+              responseCache(0)
         {}
 
         /**
@@ -123,7 +136,14 @@ public:
             : connectTimeout(connectTimeout),readTimeout(readTimeout),
               writeTimeout(writeTimeout),
               keepAlive(keepAlive), useBinary(useBinary), useHTTP10(useHTTP10),
-              protocolVersion(protocolVersionMajor,protocolVersionMinor)
+              protocolVersion(protocolVersionMajor,protocolVersionMinor),
+              raceConnect(false), connectAttemptDelay(250), dnsCacheTtl(60),
+              failedAddressPenalty(30), requestCompression(0),
+              compressionThreshold(1024), acceptCompression(false),
+              metrics(0), compactXml(false), maxRetries(0),
+              retryBackoff(50), retryBackoffMax(1000), hedgeDelay(0),
+              sendDeadline(false), singleFlight(0),
+              responseCache(0)
         {}
 
         /**
@@ -137,7 +157,13 @@ public:
         Config_t()
             : connectTimeout(10000), readTimeout(10000), writeTimeout(1000),
               keepAlive(false), useBinary(ON_SUPPORT_ON_KEEP_ALIVE),
-              useHTTP10(false)
+              useHTTP10(false), raceConnect(false), connectAttemptDelay(250),
+              dnsCacheTtl(60), failedAddressPenalty(30), requestCompression(0),
+              compressionThreshold(1024), acceptCompression(false),
+              metrics(0), compactXml(false), maxRetries(0),
+              retryBackoff(50), retryBackoffMax(1000), hedgeDelay(0),
+              sendDeadline(false), singleFlight(0),
+              responseCache(0)
         {}
 
         ///@brief internal representation of connectTimeout value
@@ -157,6 +183,62 @@ public:
         std::string proxyUrl;
         ///@brief Protocol version
         ProtocolVersion_t protocolVersion;
+
+        ///@brief race connects to all resolved addresses (RacingConnector_t)
+        bool raceConnect;
+        ///@brief delay between racing connect attempts in miliseconds
+        unsigned int connectAttemptDelay;
+        ///@brief lifetime of resolved addresses in seconds
+        unsigned int dnsCacheTtl;
+        ///@brief how long (seconds) is failed address tried last
+        unsigned int failedAddressPenalty;
+
+        ///@brief coding of requests (Compression_t::Type_t, NONE = off);
+        ///       use only with servers that understand it
+        unsigned int requestCompression;
+        ///@brief requests smaller than this (bytes) stay uncompressed
+        unsigned int compressionThreshold;
+        ///@brief send Accept-Encoding to get compressed responses
+        bool acceptCompression;
+
+        ///@brief call and traffic statistics (not owned), 0 = not collected
+        Metrics_t *metrics;
+
+        ///@brief XML-RPC requests without line breaks between tags
+        bool compactXml;
+
+        ///@brief comma separated name patterns (fnmatch) of idempotent
+        ///       methods; only these are retried and hedged
+        std::string idempotentMethods;
+        ///@brief max number of retries of idempotent call failed on
+        ///       network error or HTTP 502/503/504 (0 = off); calls with
+        ///       custom DataBuilder_t are never retried
+        unsigned int maxRetries;
+        ///@brief base of exponential backoff between retries in
+        ///       miliseconds; actual delay is random up to the bound
+        unsigned int retryBackoff;
+        ///@brief upper bound of backoff in miliseconds
+        unsigned int retryBackoffMax;
+        ///@brief send the same idempotent request once more over second
+        ///       connection when no response comes within this time in
+        ///       miliseconds (typically p95 latency of the method, see
+        ///       Metrics_t); first response wins, the other connection
+        ///       is closed (0 = off)
+        unsigned int hedgeDelay;
+        ///@brief tell server how long the client is going to wait (read
+        ///       timeout) in X-Frpc-Timeout header so it can drop requests
+        ///       expired in its queue; deadline of request handled by
+        ///       current thread (see Deadline_t) is passed on regardless
+        bool sendDeadline;
+        ///@brief run identical concurrent calls of methods covered by
+        ///       given single flight (not owned, may be shared by more
+        ///       proxies) only once, 0 = off; calls with per call headers
+        ///       are never coalesced
+        SingleFlight_t *singleFlight;
+        ///@brief cache of results of methods it has TTL for (not owned,
+        ///       may be shared by more proxies), 0 = off; calls with per
+        ///       call headers are never cached
+        ResponseCache_t *responseCache;
     };
 
     /**
@@ -547,6 +629,10 @@ public:
 
     const URL_t& getURL();
 
+    /** @brief latency breakdown (PhaseTimes_t) of the last call which got
+     *         response from the server */
+    const PhaseTimes_t& getLastCallPhases();
+
     void addRequestHttpHeaderForCall(const HTTPClient_t::Header_t& header);
     void addRequestHttpHeaderForCall(const HTTPClient_t::HeaderVector_t& headers);
 
@@ -0,0 +1,260 @@
+/*
+ * FastRPC -- Fast RPC library compatible with XML-RPC
+ * Copyright (C) 2005-7  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Radlicka 2, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:fastrpc@firma.seznam.cz
+ *
+ * FILE          $Id$
+ *
+ * DESCRIPTION   Coalescing of identical concurrent calls
+ *
+ * AUTHOR
+ *
+ * HISTORY
+ *
+ */
+#include "frpcsingleflight.h"
+#include <errno.h>
+#include <fnmatch.h>
+#include <memory>
+#include <frpcpool.h>
+#include <frpcvalue.h>
+#include <frpcfault.h>
+#include <frpcprotocolerror.h>
+#include <frpcwriter.h>
+#include <frpcbinmarshaller.h>
+#include <frpctreefeeder.h>
+#include <frpcdeadline.h>
+#include <frpcmethodregistry.h>
+#include "frpcutils.h"
+
+namespace FRPC {
+
+namespace {
+
+/** Outcome of the call.
+ */
+enum { CALL_RESULT, CALL_FAULT, CALL_PROTOCOL_ERROR, CALL_OTHER_ERROR };
+
+} // namespace
+
+/** Running call shared by its callers.
+ */
+struct SingleFlight_t::Flight_t {
+    Flight_t()
+        : refs(1), finished(false), result(0), error(CALL_RESULT),
+          errorNum(0)
+    {
+        pthread_cond_init(&done, 0);
+    }
+
+    ~Flight_t() {
+        pthread_cond_destroy(&done);
+    }
+
+    unsigned int refs;          //!< callers still using the flight
+    bool finished;
+    Pool_t pool;                //!< result copy for waiting callers
+    Value_t *result;
+    int error;
+    long errorNum;
+    std::string message;
+    pthread_cond_t done;
+};
+
+SingleFlight_t::Call_t::~Call_t() {}
+
+SingleFlight_t::SingleFlight_t(const std::string &methods)
+    : patterns(splitPatterns(methods)), executedCalls(0), coalescedCalls(0)
+{
+    pthread_mutex_init(&mutex, 0);
+}
+
+SingleFlight_t::~SingleFlight_t() {
+    pthread_mutex_destroy(&mutex);
+}
+
+bool SingleFlight_t::covers(const std::string &methodName) const {
+    for (std::vector<std::string>::const_iterator
+             i = patterns.begin(); i != patterns.end(); ++i)
+    {
+        if (!fnmatch(i->c_str(), methodName.c_str(), 0)) return true;
+    }
+    return false;
+}
+
+std::string SingleFlight_t::key(const std::string &scope,
+                                const std::string &methodName,
+                                Array_t::const_iterator begin,
+                                Array_t::const_iterator end)
+{
+    std::string data(scope);
+    data.push_back('\0');
+    StringWriter_t writer(data);
+    BinMarshaller_t marshaller(writer, ProtocolVersion_t(3, 0));
+    TreeFeeder_t feeder(marshaller);
+    marshaller.packMethodCall(methodName.data(), methodName.size());
+    for (; begin != end; ++begin)
+        feeder.feedValue(**begin);
+    marshaller.flush();
+    return data;
+}
+
+Value_t& SingleFlight_t::call(Pool_t &pool, const std::string &key,
+                              Call_t &call)
+{
+    // allocate before locking, map never holds an unfinished entry
+    std::auto_ptr<Flight_t> flight(new Flight_t());
+    FlightMap_t::value_type entry(key, flight.get());
+
+    pthread_mutex_lock(&mutex);
+    std::pair<FlightMap_t::iterator, bool> res;
+    try {
+        res = flights.insert(entry);
+    } catch (...) {
+        pthread_mutex_unlock(&mutex);
+        throw;
+    }
+    if (!res.second) {
+        ++res.first->second->refs;
+        ++coalescedCalls;
+        return join(pool, *res.first->second, call);
+    }
+    flight.release();
+    ++executedCalls;
+    pthread_mutex_unlock(&mutex);
+
+    Value_t *result;
+    try {
+        result = &call(pool);
+    } catch (const Fault_t &fault) {
+        land(res.first, 0, CALL_FAULT, fault.errorNum(), fault.message());
+        throw;
+    } catch (const ProtocolError_t &error) {
+        land(res.first, 0, CALL_PROTOCOL_ERROR, error.errorNum(),
+             error.message());
+        throw;
+    } catch (...) {
+        land(res.first, 0, CALL_OTHER_ERROR, 0, std::string());
+        throw;
+    }
+
+    land(res.first, result, CALL_RESULT, 0, std::string());
+    return *result;
+}
+
+Value_t& SingleFlight_t::join(Pool_t &pool, Flight_t &flight, Call_t &call)
+{
+    long remaining = Deadline_t::remaining();
+    if (remaining < 0) {
+        while (!flight.finished)
+            pthread_cond_wait(&flight.done, &mutex);
+    } else {
+        struct timespec deadline = absoluteTime(remaining);
+        int status = 0;
+        while (!flight.finished && (status != ETIMEDOUT))
+            status = pthread_cond_timedwait(&flight.done, &mutex, &deadline);
+        if (!flight.finished) {
+            release(&flight);
+            pthread_mutex_unlock(&mutex);
+            throw Fault_t(MethodRegistry_t::FRPC_TIMEOUT_ERROR,
+                          "Deadline expired while waiting for the same "
+                          "call.");
+        }
+    }
+    pthread_mutex_unlock(&mutex);
+
+    // the flight lives until we release it, clone without lock
+    Value_t *result = 0;
+    if (flight.error == CALL_RESULT) {
+        try {
+            result = &flight.result->clone(pool);
+        } catch (...) {
+            Locker_t locker(mutex);
+            release(&flight);
+            throw;
+        }
+    }
+    int error = flight.error;
+    long errorNum = flight.errorNum;
+    std::string message(flight.message);
+
+    {
+        Locker_t locker(mutex);
+        release(&flight);
+    }
+
+    switch (error) {
+    case CALL_FAULT:
+        throw Fault_t(errorNum, message);
+    case CALL_PROTOCOL_ERROR:
+        throw ProtocolError_t(errorNum, message);
+    case CALL_OTHER_ERROR:
+        return call(pool);
+    default:
+        return *result;
+    }
+}
+
+void SingleFlight_t::land(FlightMap_t::iterator pos, Value_t *result,
+                          int error, long errorNum,
+                          const std::string &message)
+{
+    // nobody joins after the flight leaves the map
+    pthread_mutex_lock(&mutex);
+    Flight_t *flight = pos->second;
+    flights.erase(pos);
+    bool waiting = flight->refs > 1;
+    pthread_mutex_unlock(&mutex);
+
+    if (waiting) {
+        flight->error = error;
+        flight->errorNum = errorNum;
+        flight->message = message;
+        if (result) {
+            try {
+                flight->result = &result->clone(flight->pool);
+            } catch (...) {
+                flight->error = CALL_OTHER_ERROR;
+            }
+        }
+    }
+
+    pthread_mutex_lock(&mutex);
+    flight->finished = true;
+    pthread_cond_broadcast(&flight->done);
+    release(flight);
+    pthread_mutex_unlock(&mutex);
+}
+
+void SingleFlight_t::release(Flight_t *flight) {
+    if (!--flight->refs) delete flight;
+}
+
+uint64_t SingleFlight_t::executed() const {
+    Locker_t locker(mutex);
+    return executedCalls;
+}
+
+uint64_t SingleFlight_t::coalesced() const {
+    Locker_t locker(mutex);
+    return coalescedCalls;
+}
+
+};
@@ -0,0 +1,142 @@
+/*
+ * FastRPC -- Fast RPC library compatible with XML-RPC
+ * Copyright (C) 2005-7  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Radlicka 2, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:fastrpc@firma.seznam.cz
+ *
+ * FILE          $Id$
+ *
+ * DESCRIPTION   Coalescing of identical concurrent calls
+ *
+ * AUTHOR
+ *
+ * HISTORY
+ *
+ */
+#ifndef FRPCFRPCSINGLEFLIGHT_H
+#define FRPCFRPCSINGLEFLIGHT_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include <map>
+
+#include <frpcplatform.h>
+#include <frpcarray.h>
+
+namespace FRPC {
+
+class Pool_t;
+class Value_t;
+
+/** Collapses identical calls running at the same time into one execution.
+ *
+ *  The first caller of given key runs the call, callers coming before it
+ *  finishes wait and get a copy of its result cloned into their own pool.
+ *  Waiting caller gives up when its own deadline (Deadline_t) expires, by
+ *  Fault_t FRPC_TIMEOUT_ERROR.
+ *  Fault_t and ProtocolError_t of the call are passed to the waiting
+ *  callers too (as Fault_t and ProtocolError_t); on any other exception the
+ *  waiting callers run the call themselves.
+ *
+ *  Only methods matching given patterns are coalesced, they should have no
+ *  side effects. One instance can be shared by more ServerProxy_t objects
+ *  (ServerProxy_t::Config_t::singleFlight, the key contains server URL) or
+ *  by all servers of Acceptor_t (Server_t::Config_t::singleFlight).
+ */
+class FRPC_DLLEXPORT SingleFlight_t {
+public:
+    /** Call to be coalesced.
+     */
+    class FRPC_DLLEXPORT Call_t {
+    public:
+        virtual ~Call_t();
+
+        /** Run the call, allocate result from given pool.
+         */
+        virtual Value_t& operator()(Pool_t &pool) = 0;
+    };
+
+    /** @param methods comma separated name patterns (fnmatch) of
+     *         coalesced methods
+     */
+    explicit SingleFlight_t(const std::string &methods = "*");
+
+    ~SingleFlight_t();
+
+    /** Whether calls of given method are coalesced.
+     */
+    bool covers(const std::string &methodName) const;
+
+    /** Key of call: scope (e.g. URL), method name and params serialized
+     *  to FRPC binary (struct members are sorted, so equal params give
+     *  equal keys).
+     */
+    static std::string key(const std::string &scope,
+                           const std::string &methodName,
+                           Array_t::const_iterator begin,
+                           Array_t::const_iterator end);
+
+    /** Run call or wait for the same one already running.
+     *  @return result allocated from given pool
+     */
+    Value_t& call(Pool_t &pool, const std::string &key, Call_t &call);
+
+    /** Number of calls run.
+     */
+    uint64_t executed() const;
+
+    /** Number of calls served by result of other call.
+     */
+    uint64_t coalesced() const;
+
+private:
+    SingleFlight_t(const SingleFlight_t&);
+    SingleFlight_t& operator=(const SingleFlight_t&);
+
+    struct Flight_t;
+
+    typedef std::map<std::string, Flight_t*> FlightMap_t;
+
+    /** Wait for running flight (at most until deadline of the caller)
+     *  and copy its outcome.
+     */
+    Value_t& join(Pool_t &pool, Flight_t &flight, Call_t &call);
+
+    /** Pass outcome of the call to waiting callers.
+     */
+    void land(FlightMap_t::iterator pos, Value_t *result, int error,
+              long errorNum, const std::string &message);
+
+    /** Drop reference to the flight, delete it when it is the last one.
+     *  Call with mutex locked.
+     */
+    void release(Flight_t *flight);
+
+    std::vector<std::string> patterns;
+    FlightMap_t flights;
+    uint64_t executedCalls;
+    uint64_t coalescedCalls;
+    mutable pthread_mutex_t mutex;
+};
+
+};
+
+#endif
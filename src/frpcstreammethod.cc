@@ -0,0 +1,122 @@
+/*
+ * FastRPC -- Fast RPC library compatible with XML-RPC
+ * Copyright (C) 2005-7  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Radlicka 2, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:fastrpc@firma.seznam.cz
+ *
+ * FILE          $Id$
+ *
+ * DESCRIPTION   Methods streaming their array result
+ *
+ * AUTHOR
+ *
+ * HISTORY
+ *
+ */
+#include "frpcstreammethod.h"
+#include <frpcstreamerror.h>
+#include <frpc.h>
+
+namespace FRPC
+{
+
+namespace
+{
+
+/** Collects pushed items into array created in the call pool.
+ */
+class CollectingStream_t : public ResponseStream_t
+{
+public:
+    CollectingStream_t(Pool_t &pool)
+        : ResponseStream_t(pool), result(0)
+    {}
+
+    Array_t& array()
+    {
+        if (!result) result = &pool().Array();
+        return *result;
+    }
+
+protected:
+    virtual void openArray(unsigned int numOfItems)
+    {
+        array().reserve(numOfItems);
+    }
+
+    virtual void pushItem(const Value_t &item)
+    {
+        array().append(item);
+    }
+
+private:
+    Array_t *result;
+};
+
+} // namespace
+
+ResponseStream_t::ResponseStream_t(Pool_t &itemPool)
+        :itemPool(itemPool), opened(false), numOfItems(0), pushed(0)
+{}
+
+ResponseStream_t::~ResponseStream_t()
+{}
+
+void ResponseStream_t::open(unsigned int numOfItems)
+{
+    if (opened)
+        throw StreamError_t("Response stream already opened");
+
+    opened = true;
+    this->numOfItems = numOfItems;
+    openArray(numOfItems);
+}
+
+void ResponseStream_t::push(const Value_t &item)
+{
+    if (!opened)
+        throw StreamError_t("Response stream not opened");
+    if (pushed == numOfItems)
+        throw StreamError_t::format(
+                "Response stream got more than announced %u items",
+                numOfItems);
+
+    ++pushed;
+    pushItem(item);
+}
+
+void ResponseStream_t::finish()
+{
+    if (!opened)
+        open(0);
+    if (pushed != numOfItems)
+        throw StreamError_t::format(
+                "Response stream got %u of announced %u items",
+                pushed, numOfItems);
+}
+
+Value_t& StreamMethod_t::call(Pool_t &pool, Array_t &params)
+{
+    CollectingStream_t response(pool);
+    stream(params, response);
+    response.finish();
+    return response.array();
+}
+
+};
@@ -0,0 +1,169 @@
+/*
+ * FastRPC -- Fast RPC library compatible with XML-RPC
+ * Copyright (C) 2005-7  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Radlicka 2, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:fastrpc@firma.seznam.cz
+ *
+ * FILE          $Id$
+ *
+ * DESCRIPTION   Methods streaming their array result
+ *
+ * AUTHOR
+ *
+ * HISTORY
+ *
+ */
+#ifndef FRPCFRPCSTREAMMETHOD_H
+#define FRPCFRPCSTREAMMETHOD_H
+
+#include <frpcplatform.h>
+#include <frpcmethod.h>
+
+namespace FRPC
+{
+
+/**
+@brief Sink of items of streamed array result
+
+The number of items has to be announced by open() before first push(),
+because both FastRPC and XML-RPC arrays carry their size up front. Items
+should be created in pool(); when the result is marshalled directly to the
+client, the pool is freed after each push().
+*/
+class FRPC_DLLEXPORT ResponseStream_t
+{
+public:
+    explicit ResponseStream_t(Pool_t &itemPool);
+
+    virtual ~ResponseStream_t();
+
+    /**
+        @brief Start array result
+        @param numOfItems exact number of items pushed later
+    */
+    void open(unsigned int numOfItems);
+
+    /**
+        @brief Append next item of array result
+        @param item value, usually created in pool()
+    */
+    void push(const Value_t &item);
+
+    /**
+        @brief Check all announced items have been pushed; opens empty
+        array when open() has not been called at all
+    */
+    void finish();
+
+    /** @brief Pool for items passed to push() */
+    Pool_t& pool()
+    {
+        return itemPool;
+    }
+
+    /** @brief True when some response data may have been produced */
+    bool isOpened() const
+    {
+        return opened;
+    }
+
+    /** @brief Number of announced items */
+    unsigned int size() const
+    {
+        return numOfItems;
+    }
+
+protected:
+    virtual void openArray(unsigned int numOfItems) = 0;
+    virtual void pushItem(const Value_t &item) = 0;
+
+private:
+    ResponseStream_t(const ResponseStream_t&);
+    ResponseStream_t& operator=(const ResponseStream_t&);
+
+    Pool_t &itemPool;
+    bool opened;
+    unsigned int numOfItems;
+    unsigned int pushed;
+};
+
+/**
+@brief Method producing its array result item by item
+
+When called by MethodRegistry_t::processCall() writing the response,
+items are marshalled as they are pushed and binary responses go to the
+client in chunks. Other callers (system.multicall, in-process calls) get
+the result collected in regular Array_t by call().
+
+Errors thrown before ResponseStream_t::open() are reported as ordinary
+faults; once the array is opened, the error can not be reported anymore
+and the connection is closed.
+*/
+class FRPC_DLLEXPORT StreamMethod_t : public Method_t
+{
+public:
+    StreamMethod_t()
+    {}
+
+    virtual ~StreamMethod_t()
+    {}
+
+    virtual void stream(Array_t &params, ResponseStream_t &response) = 0;
+
+    /**
+        @brief Collect the whole result to array
+    */
+    virtual Value_t& call(Pool_t &pool, Array_t &params);
+};
+
+template <typename Object_t>
+class BoundStreamMethod_t : public StreamMethod_t
+{
+public:
+    typedef void (Object_t::*Handler_t) (Array_t &params,
+                                         ResponseStream_t &response);
+
+    BoundStreamMethod_t(Object_t &object, Handler_t handler)
+            :StreamMethod_t(),object(object),handler(handler)
+    {}
+
+    virtual ~BoundStreamMethod_t()
+    {}
+
+    virtual void stream(Array_t &params, ResponseStream_t &response)
+    {
+        (object.*handler)(params, response);
+    }
+
+private:
+    Object_t &object;
+    Handler_t handler;
+};
+
+template <typename Object_t>
+BoundStreamMethod_t<Object_t>* boundStreamMethod(
+        typename BoundStreamMethod_t<Object_t>::Handler_t handler,
+        Object_t &object)
+{
+    return new BoundStreamMethod_t<Object_t>(object, handler);
+}
+
+};
+
+#endif
@@ -34,6 +34,7 @@
 #define FRPCFRPCSTRUCT_H
 
 #include <frpcvalue.h>
+#include <frpcvaluevisitor.h>
 #include "frpctypeerror.h"
 #include <map>
 #include <string>
@@ -91,6 +92,15 @@ public:
         @param newPool is pointer of Pool_t which is used for allocate objects
     */
     virtual Value_t& clone(Pool_t& newPool) const;
+
+    /**
+        @brief Dispatch this value to the visitor
+        @param visitor is reference to visitor
+    */
+    virtual void accept(ValueVisitor_t &visitor) const
+    {
+        visitor.visit(*this);
+    }
     /**
         @brief Getting type of value
         @return  @b unsigned @b short always
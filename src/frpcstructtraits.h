@@ -0,0 +1,267 @@
+/*
+ * FastRPC -- Fast RPC library compatible with XML-RPC
+ * Copyright (C) 2005-7  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Radlicka 2, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:fastrpc@firma.seznam.cz
+ *
+ *
+ * FILE          $Id$
+ *
+ * DESCRIPTION   Mapping between C++ structures and FastRPC structs
+ *
+ * AUTHOR
+ *
+ * HISTORY
+ *
+ */
+#ifndef FRPCFRPCSTRUCTTRAITS_H
+#define FRPCFRPCSTRUCTTRAITS_H
+
+#include <frpcplatform.h>
+
+#include <frpcvaluetraits.h>
+
+#include <string.h>
+
+/**
+@brief Begins field list of C++ structure (use in global namespace)
+
+@code
+struct Point_t {
+    long x;
+    long y;
+    std::string label;
+};
+
+FRPC_STRUCT_TRAITS_BEGIN(Point_t)
+    FRPC_STRUCT_FIELD(x)
+    FRPC_STRUCT_FIELD(y)
+    FRPC_STRUCT_FIELD_NAMED(label, "name")
+FRPC_STRUCT_TRAITS_END()
+
+// marshall without Value_t tree
+FRPC::ValueTraits_t<Point_t>::pack(marshaller, point);
+
+// unmarshall without Value_t tree
+FRPC::TypedBuilder_t builder(point);
+@endcode
+
+The structure can be used as handler parameter or result of typedMethod()
+and as item of std::vector/std::map. Unknown struct members are skipped
+when unmarshalling and missing members leave the field untouched. Member
+names must be string literals, their length is taken at compile time.
+*/
+#define FRPC_STRUCT_TRAITS_BEGIN(Type)                                       \
+namespace FRPC {                                                             \
+template <>                                                                  \
+struct ValueTraits_t<Type> : public StructValueTraits_t<Type> {              \
+    template <typename Fields_t, typename Struct_T>                          \
+    static void fields(Fields_t &fields, Struct_T &value) {
+
+/// Field of C++ structure, struct member has the same name
+#define FRPC_STRUCT_FIELD(member)                                            \
+        fields.field(#member, sizeof(#member) - 1, value.member);
+
+/// Field of C++ structure, struct member has given name
+#define FRPC_STRUCT_FIELD_NAMED(member, memberName)                          \
+        fields.field(memberName, sizeof("" memberName) - 1, value.member);
+
+/// Ends field list of C++ structure
+#define FRPC_STRUCT_TRAITS_END()                                             \
+    }                                                                        \
+};                                                                           \
+}
+
+namespace FRPC
+{
+
+/**
+@brief Counts fields of the structure
+*/
+class CountFields_t {
+public:
+    CountFields_t() : count(0) {}
+
+    template <typename Field_t>
+    void field(const char *, unsigned int, Field_t &) {
+        ++count;
+    }
+
+    unsigned int count;
+};
+
+/**
+@brief Marshalls fields of the structure as struct members
+*/
+class PackFields_t {
+public:
+    explicit PackFields_t(Marshaller_t &marshaller) : marshaller(marshaller) {}
+
+    template <typename Field_t>
+    void field(const char *name, unsigned int size, Field_t &value) {
+        marshaller.packStructMember(name, size);
+        ValueTraits_t<typename ParamType_t<Field_t>::type>::pack(
+                marshaller, value);
+    }
+
+private:
+    Marshaller_t &marshaller;
+};
+
+/**
+@brief Creates sink of the field with given name
+
+Field names are compared by their compile-time length first, memcmp() is
+called only for fields of the same length.
+*/
+class FindField_t {
+public:
+    FindField_t(const char *name, unsigned int size, SinkStack_t &sinks)
+        : name(name), size(size), sinks(sinks), sink(0)
+    {}
+
+    template <typename Field_t>
+    void field(const char *fieldName, unsigned int fieldSize,
+               Field_t &value)
+    {
+        if (!sink && (fieldSize == size) && !memcmp(fieldName, name, size))
+            sink = ValueTraits_t<Field_t>::sink(value, sinks);
+    }
+
+    const char *name;
+    unsigned int size;
+    SinkStack_t &sinks;
+    TypedSink_t *sink;
+};
+
+/**
+@brief Fills fields of the structure from Struct_t
+*/
+class GetFields_t {
+public:
+    GetFields_t(const Struct_t &structVal, unsigned int index)
+        : structVal(structVal), index(index)
+    {}
+
+    template <typename Field_t>
+    void field(const char *name, unsigned int, Field_t &value) {
+        if (const Value_t *member = structVal.get(name))
+            value = ValueTraits_t<Field_t>::get(*member, index);
+    }
+
+private:
+    const Struct_t &structVal;
+    unsigned int index;
+};
+
+/**
+@brief Appends fields of the structure into Struct_t
+*/
+class MakeFields_t {
+public:
+    MakeFields_t(Pool_t &pool, Struct_t &structVal)
+        : pool(pool), structVal(structVal)
+    {}
+
+    template <typename Field_t>
+    void field(const char *name, unsigned int, Field_t &value) {
+        structVal.append(
+                name, ValueTraits_t<typename ParamType_t<Field_t>::type>::make(
+                        pool, value));
+    }
+
+private:
+    Pool_t &pool;
+    Struct_t &structVal;
+};
+
+/**
+@brief Sink filling fields of the structure
+*/
+template <typename Struct_T>
+class StructSink_t : public TypedSink_t {
+public:
+    explicit StructSink_t(Struct_T &target) : target(target) {}
+
+    virtual void openStruct(unsigned int) {}
+
+    virtual TypedSink_t* member(const char *name, unsigned int size,
+                                SinkStack_t &sinks)
+    {
+        FindField_t finder(name, size, sinks);
+        ValueTraits_t<Struct_T>::fields(finder, target);
+        if (!finder.sink) return sinks.push<SkipSink_t>();
+        return finder.sink;
+    }
+
+protected:
+    virtual const char* typeName() const { return "struct"; }
+
+private:
+    Struct_T &target;
+};
+
+/**
+@brief Base of ValueTraits_t generated by FRPC_STRUCT_TRAITS_BEGIN
+
+Derived traits provide fields(fields, value) calling
+fields.field(name, nameSize, value.member) for every field.
+*/
+template <typename Struct_T>
+struct StructValueTraits_t {
+    typedef Struct_T result_type;
+
+    static char signature() { return 'S'; }
+
+    static const char* typeName() { return "struct"; }
+
+    static result_type get(const Value_t &value, unsigned int index) {
+        if (value.getType() != Struct_t::TYPE)
+            throwParamTypeError(value, index, typeName());
+
+        result_type result;
+        GetFields_t getter(static_cast<const Struct_t&>(value), index);
+        ValueTraits_t<Struct_T>::fields(getter, result);
+        return result;
+    }
+
+    static Value_t& make(Pool_t &pool, const Struct_T &value) {
+        Struct_t &structVal = pool.Struct();
+        MakeFields_t maker(pool, structVal);
+        ValueTraits_t<Struct_T>::fields(maker, value);
+        return structVal;
+    }
+
+    static void pack(Marshaller_t &marshaller, const Struct_T &value) {
+        CountFields_t counter;
+        ValueTraits_t<Struct_T>::fields(counter, value);
+        marshaller.packStruct(counter.count);
+
+        PackFields_t packer(marshaller);
+        ValueTraits_t<Struct_T>::fields(packer, value);
+    }
+
+    static TypedSink_t* sink(Struct_T &target, SinkStack_t &sinks) {
+        return sinks.push<StructSink_t<Struct_T> >(target);
+    }
+};
+
+};
+
+#endif
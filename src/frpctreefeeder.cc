@@ -31,113 +31,65 @@
  *       
  */
 
-#include "frpcbinmarshaller.h"
-#include "frpcxmlmarshaller.h"
-#include "frpcjsonmarshaller.h"
-#include "frpcerror.h"
 #include "frpctreefeeder.h"
 
 namespace FRPC {
 
-void TreeFeeder_t::feedValue(const Value_t &value){
-    switch(value.getType()) {
-    case Int_t::TYPE:
-        {
-            marshaller.packInt(Int(value).getValue());
-        }
-        break;
-
-    case Bool_t::TYPE:
-        {
-            marshaller.packBool(Bool(value).getValue());
-        }
-        break;
-
-    case Null_t::TYPE:
-        {
-            if (BinMarshaller_t *m = dynamic_cast<BinMarshaller_t*>(&marshaller)) {
-                m->packNull();
-            } else if (XmlMarshaller_t *m = dynamic_cast<XmlMarshaller_t*>(&marshaller)) {
-                m->packNull();
-            } else if (JSONMarshaller_t *m = dynamic_cast<JSONMarshaller_t*>(&marshaller)) {
-                m->packNull();
-            } else {
-                throw Error_t("Unknown marshaller type, "
-                              "we don't known how to pack null");
-            }
-        }
-        break;
-
-    case Double_t::TYPE:
-        {
-            marshaller.packDouble(Double(value).getValue());
-        }
-        break;
-
-    case String_t::TYPE:
-        {
-            const String_t &str = String(value);
-
-            marshaller.packString(str.data(), str.size());
-        }
-        break;
-
-    case Binary_t::TYPE:
-        {
-            const Binary_t &bin = Binary(value);
-
-            marshaller.packBinary(bin.data(), bin.size());
-        }
-        break;
-
-    case DateTime_t::TYPE:
-        {
-            const DateTime_t &dt = DateTime(value);
-
-            marshaller.packDateTime(dt.getYear(), dt.getMonth(), dt.getDay(),
-                                    dt.getHour(), dt.getMin(), dt.getSec(),
-                                    dt.getDayOfWeek(), dt.getUnixTime(),
-                                    dt.getTimeZone());
-
-        }
-        break;
-
-    case Struct_t::TYPE:
-        {
-            const Struct_t &structVal = Struct(value);
-            marshaller.packStruct(structVal.size());
-
-            for (Struct_t::const_iterator
-                     istructVal = structVal.begin(),
-                     estructVal = structVal.end(); istructVal != estructVal;
-                     ++istructVal)
-            {
-                marshaller.packStructMember(istructVal->first.data(),
-                                            istructVal->first.size());
-
-                feedValue(*(istructVal->second));
-            }
-
-        }
-        break;
-
-    case Array_t::TYPE:
-        {
-            const Array_t &array = Array(value);
-            marshaller.packArray(array.size());
-            for (Array_t::const_iterator
-                     iarray = array.begin(),
-                     earray = array.end(); iarray != earray; ++iarray)
-            {
-                feedValue(**iarray);
-            }
-
-        }
-        break;
+void TreeFeeder_t::visit(const Int_t &value) {
+    marshaller.packInt(value.getValue());
+}
 
+void TreeFeeder_t::visit(const Bool_t &value) {
+    marshaller.packBool(value.getValue());
+}
 
+void TreeFeeder_t::visit(const Null_t &) {
+    marshaller.packNull();
+}
+
+void TreeFeeder_t::visit(const Double_t &value) {
+    marshaller.packDouble(value.getValue());
+}
+
+void TreeFeeder_t::visit(const String_t &value) {
+    marshaller.packString(value.data(), value.size());
+}
+
+void TreeFeeder_t::visit(const Binary_t &value) {
+    marshaller.packBinary(value.data(), value.size());
+}
+
+void TreeFeeder_t::visit(const DateTime_t &value) {
+    marshaller.packDateTime(value.getYear(), value.getMonth(), value.getDay(),
+                            value.getHour(), value.getMin(), value.getSec(),
+                            value.getDayOfWeek(), value.getUnixTime(),
+                            value.getTimeZone());
+}
+
+void TreeFeeder_t::visit(const Struct_t &value) {
+    marshaller.packStruct(value.size());
+
+    for (Struct_t::const_iterator
+             istructVal = value.begin(),
+             estructVal = value.end(); istructVal != estructVal;
+             ++istructVal)
+    {
+        marshaller.packStructMember(istructVal->first.data(),
+                                    istructVal->first.size());
+
+        istructVal->second->accept(*this);
     }
+}
 
+void TreeFeeder_t::visit(const Array_t &value) {
+    marshaller.packArray(value.size());
+
+    for (Array_t::const_iterator
+             iarray = value.begin(),
+             earray = value.end(); iarray != earray; ++iarray)
+    {
+        (*iarray)->accept(*this);
+    }
 }
 
 TreeFeeder_t::~TreeFeeder_t()
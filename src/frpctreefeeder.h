@@ -37,20 +37,24 @@
 
 #include <frpcmarshaller.h>
 #include <frpc.h>
+#include <frpcvaluevisitor.h>
 
 namespace FRPC
 {
 
 /**
+@brief Feeds the Value_t tree into the marshaller
 @author Miroslav Talasek
 */
-class FRPC_DLLEXPORT TreeFeeder_t
+class FRPC_DLLEXPORT TreeFeeder_t : private ValueVisitor_t
 {
 public:
     TreeFeeder_t(Marshaller_t &marshaller):marshaller(marshaller)
     {}
     
-    void feedValue(const Value_t &value);
+    void feedValue(const Value_t &value) {
+        value.accept(*this);
+    }
 
     
     
@@ -58,6 +62,16 @@ public:
     
 private:
 
+    virtual void visit(const Int_t &value);
+    virtual void visit(const Bool_t &value);
+    virtual void visit(const Double_t &value);
+    virtual void visit(const String_t &value);
+    virtual void visit(const Binary_t &value);
+    virtual void visit(const DateTime_t &value);
+    virtual void visit(const Struct_t &value);
+    virtual void visit(const Array_t &value);
+    virtual void visit(const Null_t &value);
+
     Marshaller_t &marshaller;
 
 };
@@ -0,0 +1,288 @@
+/*
+ * FastRPC -- Fast RPC library compatible with XML-RPC
+ * Copyright (C) 2005-7  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Radlicka 2, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:fastrpc@firma.seznam.cz
+ *
+ *
+ * FILE          $Id$
+ *
+ * DESCRIPTION   Data builder filling C++ values directly from the stream
+ *
+ * AUTHOR
+ *
+ * HISTORY
+ *
+ */
+
+#include "frpctypedbuilder.h"
+#include "frpctypeerror.h"
+#include "frpcstreamerror.h"
+#include "frpcfault.h"
+
+namespace FRPC {
+
+namespace {
+
+/**
+ * @short Pops the sink at the end of scope unless it is the root one.
+ */
+class SinkGuard_t {
+public:
+    SinkGuard_t(TypedSink_t *sink, SinkStack_t &sinks,
+                const TypedSink_t *root)
+        : sink(sink), sinks(sinks), root(root)
+    {}
+
+    ~SinkGuard_t() {
+        if (sink && (sink != root)) sinks.pop();
+    }
+
+    TypedSink_t* operator->() const {
+        return sink;
+    }
+
+    TypedSink_t* release() {
+        TypedSink_t *tmp = sink;
+        sink = 0;
+        return tmp;
+    }
+
+private:
+    TypedSink_t *sink;
+    SinkStack_t &sinks;
+    const TypedSink_t *root;
+};
+
+} // namespace
+
+SinkStack_t::~SinkStack_t() {
+    while (depth) pop();
+    for (std::vector<Entry_t>::iterator ientry = entries.begin(),
+             eentry = entries.end(); ientry != eentry; ++ientry)
+    {
+        delete ientry->memory;
+    }
+}
+
+void* SinkStack_t::slot() {
+    if (depth == entries.size()) {
+        Entry_t entry = {new Slot_t(), 0};
+        entries.push_back(entry);
+    }
+    return entries[depth].memory;
+}
+
+void SinkStack_t::pop() {
+    Entry_t &entry = entries[--depth];
+    entry.sink->~TypedSink_t();
+    entry.sink = 0;
+}
+
+TypedSink_t::~TypedSink_t() {}
+
+void TypedSink_t::mismatch(const char *got) const {
+    throw TypeError_t::format("Value must be %s not %s.", typeName(), got);
+}
+
+void TypedSink_t::buildInt(Int_t::value_type) {
+    mismatch("int");
+}
+
+void TypedSink_t::buildBool(bool) {
+    mismatch("bool");
+}
+
+void TypedSink_t::buildDouble(double) {
+    mismatch("double");
+}
+
+void TypedSink_t::buildString(const char*, unsigned int) {
+    mismatch("string");
+}
+
+void TypedSink_t::buildBinary(const char*, unsigned int) {
+    mismatch("binary");
+}
+
+void TypedSink_t::buildDateTime(short, char, char, char, char, char, char,
+                                time_t, int)
+{
+    mismatch("dateTime");
+}
+
+void TypedSink_t::buildNull() {}
+
+void TypedSink_t::openStruct(unsigned int) {
+    mismatch("struct");
+}
+
+TypedSink_t* TypedSink_t::member(const char*, unsigned int, SinkStack_t&) {
+    mismatch("struct");
+    return 0;
+}
+
+void TypedSink_t::openArray(unsigned int) {
+    mismatch("array");
+}
+
+TypedSink_t* TypedSink_t::item(SinkStack_t&) {
+    mismatch("array");
+    return 0;
+}
+
+TypedBuilder_t::TypedBuilder_t(TypedSink_t *root)
+    : ownedRoot(root), root(root), memberSink(0), rootUsed(false)
+{}
+
+TypedBuilder_t::~TypedBuilder_t() {}
+
+TypedSink_t* TypedBuilder_t::next() {
+    if (entityStorage.empty()) {
+        if (rootUsed) throw StreamError_t("Unexpected value after the end");
+        rootUsed = true;
+        return root;
+    }
+
+    if (memberSink) {
+        TypedSink_t *sink = memberSink;
+        memberSink = 0;
+        return sink;
+    }
+
+    return entityStorage.back()->item(sinks);
+}
+
+void TypedBuilder_t::close() {
+    if (entityStorage.empty()) throw StreamError_t("Unexpected end of entity");
+    if (memberSink) {
+        // struct member without value sits above its struct
+        memberSink = 0;
+        sinks.pop();
+    }
+    SinkGuard_t sink(entityStorage.back(), sinks, root);
+    entityStorage.pop_back();
+    sink->close();
+}
+
+void TypedBuilder_t::buildMethodResponse() {}
+
+void TypedBuilder_t::buildBinary(const char* data, unsigned int size) {
+    SinkGuard_t sink(next(), sinks, root);
+    sink->buildBinary(data, size);
+}
+
+void TypedBuilder_t::buildBinary(const std::string &data) {
+    buildBinary(data.data(), data.size());
+}
+
+void TypedBuilder_t::buildBool(bool value) {
+    SinkGuard_t sink(next(), sinks, root);
+    sink->buildBool(value);
+}
+
+void TypedBuilder_t::buildDateTime(short year, char month, char day,
+                                   char hour, char minute, char sec,
+                                   char weekDay, time_t unixTime,
+                                   int timeZone)
+{
+    SinkGuard_t sink(next(), sinks, root);
+    sink->buildDateTime(year, month, day, hour, minute, sec, weekDay,
+                        unixTime, timeZone);
+}
+
+void TypedBuilder_t::buildDouble(double value) {
+    SinkGuard_t sink(next(), sinks, root);
+    sink->buildDouble(value);
+}
+
+void TypedBuilder_t::buildFault(int errNumber, const char* errMsg,
+                                unsigned int size)
+{
+    throw Fault_t(errNumber, std::string(errMsg, size));
+}
+
+void TypedBuilder_t::buildFault(int errNumber, const std::string &errMsg) {
+    throw Fault_t(errNumber, errMsg);
+}
+
+void TypedBuilder_t::buildInt(Int_t::value_type value) {
+    SinkGuard_t sink(next(), sinks, root);
+    sink->buildInt(value);
+}
+
+void TypedBuilder_t::buildMethodCall(const char*, unsigned int) {
+    throw StreamError_t("Typed builder can't build method call");
+}
+
+void TypedBuilder_t::buildMethodCall(const std::string &) {
+    throw StreamError_t("Typed builder can't build method call");
+}
+
+void TypedBuilder_t::buildString(const char* data, unsigned int size) {
+    SinkGuard_t sink(next(), sinks, root);
+    sink->buildString(data, size);
+}
+
+void TypedBuilder_t::buildString(const std::string &data) {
+    buildString(data.data(), data.size());
+}
+
+void TypedBuilder_t::buildStructMember(const char *memberName,
+                                       unsigned int size)
+{
+    if (entityStorage.empty())
+        throw StreamError_t("Struct member outside of struct");
+    if (memberSink) {
+        memberSink = 0;
+        sinks.pop();
+    }
+    memberSink = entityStorage.back()->member(memberName, size, sinks);
+}
+
+void TypedBuilder_t::buildStructMember(const std::string &memberName) {
+    buildStructMember(memberName.data(), memberName.size());
+}
+
+void TypedBuilder_t::closeArray() {
+    close();
+}
+
+void TypedBuilder_t::closeStruct() {
+    close();
+}
+
+void TypedBuilder_t::openArray(unsigned int numOfItems) {
+    SinkGuard_t sink(next(), sinks, root);
+    sink->openArray(numOfItems);
+    entityStorage.push_back(sink.release());
+}
+
+void TypedBuilder_t::openStruct(unsigned int numOfMembers) {
+    SinkGuard_t sink(next(), sinks, root);
+    sink->openStruct(numOfMembers);
+    entityStorage.push_back(sink.release());
+}
+
+void TypedBuilder_t::buildNull() {
+    SinkGuard_t sink(next(), sinks, root);
+    sink->buildNull();
+}
+
+}
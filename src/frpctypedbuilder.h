@@ -0,0 +1,306 @@
+/*
+ * FastRPC -- Fast RPC library compatible with XML-RPC
+ * Copyright (C) 2005-7  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Radlicka 2, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:fastrpc@firma.seznam.cz
+ *
+ *
+ * FILE          $Id$
+ *
+ * DESCRIPTION   Data builder filling C++ values directly from the stream
+ *
+ * AUTHOR
+ *
+ * HISTORY
+ *
+ */
+#ifndef FRPCFRPCTYPEDBUILDER_H
+#define FRPCFRPCTYPEDBUILDER_H
+
+#include <frpcplatform.h>
+
+#include <frpcdatabuilder.h>
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <new>
+
+namespace FRPC
+{
+
+template <typename Type_t>
+struct ValueTraits_t;
+
+class TypedSink_t;
+
+/**
+@brief Stack of sinks living in reused per-builder slots
+
+Sinks are created and destroyed in LIFO order while the value is being
+unmarshalled, so the slots are allocated once per nesting depth and then
+reused for every following value. Sink must fit into one slot (checked
+at compile time).
+*/
+class FRPC_DLLEXPORT SinkStack_t
+{
+public:
+    SinkStack_t() : depth(0) {}
+    ~SinkStack_t();
+
+    /**
+        @brief Create sink filling given target on the top of the stack
+    */
+    template <typename Sink_T, typename Target_T>
+    Sink_T* push(Target_T &target) {
+        // sink must fit into the slot
+        (void) sizeof(char[(sizeof(Sink_T) <= sizeof(Slot_t)) ? 1 : -1]);
+        Sink_T *sink = new (slot()) Sink_T(target);
+        entries[depth++].sink = sink;
+        return sink;
+    }
+
+    /**
+        @brief Create sink without target on the top of the stack
+    */
+    template <typename Sink_T>
+    Sink_T* push() {
+        // sink must fit into the slot
+        (void) sizeof(char[(sizeof(Sink_T) <= sizeof(Slot_t)) ? 1 : -1]);
+        Sink_T *sink = new (slot()) Sink_T();
+        entries[depth++].sink = sink;
+        return sink;
+    }
+
+    /**
+        @brief Destroy sink on the top of the stack
+    */
+    void pop();
+
+    /**
+        @brief Sink on the top of the stack or 0 when empty
+    */
+    TypedSink_t* top() const {
+        return depth ? entries[depth - 1].sink : 0;
+    }
+
+private:
+    SinkStack_t(const SinkStack_t&);
+    SinkStack_t& operator=(const SinkStack_t&);
+
+    /**
+        @brief Raw memory of one sink
+    */
+    union Slot_t {
+        void *pointers[8];
+        long double number;
+    };
+
+    struct Entry_t {
+        Slot_t *memory;
+        TypedSink_t *sink;
+    };
+
+    /**
+        @brief Memory of the next sink, allocated on first use only
+    */
+    void* slot();
+
+    std::vector<Entry_t> entries;
+    unsigned int depth;
+};
+
+/**
+@brief Receiver of unmarshaller events for one C++ value
+
+Default implementation of every event throws TypeError_t, concrete sinks
+override events matching their type. Sinks of containers create sink of
+each struct member or array item on the SinkStack_t of the builder.
+Null leaves the target value untouched.
+*/
+class FRPC_DLLEXPORT TypedSink_t
+{
+public:
+    TypedSink_t() {}
+    virtual ~TypedSink_t();
+
+    virtual void buildInt(Int_t::value_type value);
+    virtual void buildBool(bool value);
+    virtual void buildDouble(double value);
+    virtual void buildString(const char *data, unsigned int size);
+    virtual void buildBinary(const char *data, unsigned int size);
+    virtual void buildDateTime(short year, char month, char day, char hour,
+                               char minute, char sec, char weekDay,
+                               time_t unixTime, int timeZone);
+    virtual void buildNull();
+
+    virtual void openStruct(unsigned int numOfMembers);
+    /**
+        @brief Get sink of struct member
+        @param sinks stack the member sink is created on
+        @return new sink, unknown members should return SkipSink_t
+    */
+    virtual TypedSink_t* member(const char *name, unsigned int size,
+                                SinkStack_t &sinks);
+
+    virtual void openArray(unsigned int numOfItems);
+    /**
+        @brief Get sink of next array item
+        @param sinks stack the item sink is created on
+        @return new sink
+    */
+    virtual TypedSink_t* item(SinkStack_t &sinks);
+
+    /**
+        @brief Called when struct or array is closed
+    */
+    virtual void close() {}
+
+protected:
+    /**
+        @brief Type of this sink used in error messages
+    */
+    virtual const char* typeName() const = 0;
+
+    /**
+        @brief Throws TypeError_t
+    */
+    void mismatch(const char *got) const;
+
+private:
+    TypedSink_t(const TypedSink_t&);
+    TypedSink_t& operator=(const TypedSink_t&);
+};
+
+/**
+@brief Sink silently swallowing any value (e.g. unknown struct member)
+*/
+class FRPC_DLLEXPORT SkipSink_t : public TypedSink_t
+{
+public:
+    virtual void buildInt(Int_t::value_type) {}
+    virtual void buildBool(bool) {}
+    virtual void buildDouble(double) {}
+    virtual void buildString(const char*, unsigned int) {}
+    virtual void buildBinary(const char*, unsigned int) {}
+    virtual void buildDateTime(short, char, char, char, char, char, char,
+                               time_t, int) {}
+    virtual void openStruct(unsigned int) {}
+    virtual TypedSink_t* member(const char*, unsigned int,
+                                SinkStack_t &sinks)
+    {
+        return sinks.push<SkipSink_t>();
+    }
+    virtual void openArray(unsigned int) {}
+    virtual TypedSink_t* item(SinkStack_t &sinks) {
+        return sinks.push<SkipSink_t>();
+    }
+
+protected:
+    virtual const char* typeName() const {
+        return "any";
+    }
+};
+
+/**
+@brief Data builder unmarshalling value directly into C++ variable
+
+Type of the variable must have ValueTraits_t with sink() (see
+frpcvaluetraits.h and frpcstructtraits.h). No Value_t tree is built and
+sinks of nested values reuse slots of the builder's SinkStack_t, so no
+memory is allocated per value.
+
+@code
+Point_t point;
+TypedBuilder_t builder(point);
+BinUnMarshaller_t unmarshaller(builder);
+unmarshaller.unMarshall(data, size, UnMarshaller_t::TYPE_METHOD_RESPONSE);
+unmarshaller.finish();
+@endcode
+
+Fault in the stream is thrown as Fault_t.
+*/
+class FRPC_DLLEXPORT TypedBuilder_t : public DataBuilderWithNull_t
+{
+public:
+    /**
+        @brief Create builder filling given root sink
+        @param root sink of root value, builder takes the ownership
+    */
+    explicit TypedBuilder_t(TypedSink_t *root);
+
+    /**
+        @brief Create builder filling given variable
+        @param target variable which receives unmarshalled value
+    */
+    template <typename Type_t>
+    explicit TypedBuilder_t(Type_t &target)
+        : root(ValueTraits_t<Type_t>::sink(target, sinks)), memberSink(0),
+          rootUsed(false)
+    {}
+
+    virtual ~TypedBuilder_t();
+
+    virtual void buildMethodResponse();
+    virtual void buildBinary(const char* data, unsigned int size);
+    virtual void buildBinary(const std::string &data);
+    virtual void buildBool(bool value);
+    virtual void buildDateTime(short year, char month, char day,char hour,
+                               char minute, char sec, char weekDay,
+                               time_t unixTime, int timeZone);
+    virtual void buildDouble(double value);
+    virtual void buildFault(int errNumber, const char* errMsg,
+                            unsigned int size);
+    virtual void buildFault(int errNumber, const std::string &errMsg);
+    virtual void buildInt(Int_t::value_type value);
+    virtual void buildMethodCall(const char* methodName, unsigned int size);
+    virtual void buildMethodCall(const std::string &methodName);
+    virtual void buildString(const char* data, unsigned int size);
+    virtual void buildString(const std::string &data);
+    virtual void buildStructMember(const char *memberName,
+                                   unsigned int size);
+    virtual void buildStructMember(const std::string &memberName);
+    virtual void closeArray();
+    virtual void closeStruct();
+    virtual void openArray(unsigned int numOfItems);
+    virtual void openStruct(unsigned int numOfMembers);
+    virtual void buildNull();
+
+private:
+    TypedBuilder_t(const TypedBuilder_t&);
+    TypedBuilder_t& operator=(const TypedBuilder_t&);
+
+    /**
+        @brief Sink of next value in the stream
+    */
+    TypedSink_t* next();
+
+    void close();
+
+    std::auto_ptr<TypedSink_t> ownedRoot;
+    SinkStack_t sinks;
+    TypedSink_t *root;
+    std::vector<TypedSink_t*> entityStorage;
+    TypedSink_t *memberSink;
+    bool rootUsed;
+};
+
+};
+
+#endif
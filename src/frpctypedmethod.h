@@ -0,0 +1,438 @@
+/*
+ * FastRPC -- Fast RPC library compatible with XML-RPC
+ * Copyright (C) 2005-7  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Radlicka 2, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:fastrpc@firma.seznam.cz
+ *
+ *
+ * FILE          $Id$
+ *
+ * DESCRIPTION   Methods with typed parameters
+ *
+ * AUTHOR
+ *
+ * HISTORY
+ *
+ */
+#ifndef FRPCFRPCTYPEDMETHOD_H
+#define FRPCFRPCTYPEDMETHOD_H
+
+#include <frpcplatform.h>
+
+#include <frpcmethod.h>
+#include <frpcvaluetraits.h>
+
+#include <string>
+
+namespace FRPC
+{
+
+/**
+@brief Method with typed parameters
+
+Handler is ordinary member function taking and returning C++ values, e.g.
+@code
+std::string Obj_t::foo(long, const std::string&, const std::vector<double>&);
+
+registry.registerMethod("foo", typedMethod(&Obj_t::foo, obj), "help");
+@endcode
+
+Supported types are listed in ValueTraits_t. The method signature
+(here "s:i:s:A") is generated from the handler type and parameters are
+converted without parsing of the signature string at call time. Wrong
+number of parameters raises LenError_t, wrong type of parameter raises
+TypeError_t; both are reported as FRPC_TYPE_ERROR fault by
+MethodRegistry_t.
+*/
+class FRPC_DLLEXPORT TypedMethod_t : public Method_t
+{
+public:
+    TypedMethod_t(const std::string &signature)
+            :Method_t(), signature(signature)
+    {}
+
+    virtual ~TypedMethod_t()
+    {}
+
+    /**
+        @brief Get method signature generated from handler type
+        @return signature as returnType:param1:param2...
+    */
+    const std::string& getSignature() const
+    {
+        return signature;
+    }
+
+protected:
+    /**
+        @brief Check number of parameters
+    */
+    static void checkParams(const Array_t &params, Array_t::size_type count)
+    {
+        if (params.size() != count)
+            throw LenError_t::format("Array must have %zd parameters.",
+                                     count);
+    }
+
+    /**
+        @brief Convert parameter at index to C++ type of handler parameter
+    */
+    template <typename Arg_t>
+    static typename ValueTraits_t<typename ParamType_t<Arg_t>::type>::result_type
+    param(const Array_t &params, unsigned int index)
+    {
+        return ValueTraits_t<typename ParamType_t<Arg_t>::type>::get(
+                params[index], index);
+    }
+
+    /**
+        @brief Convert value returned by handler to FastRPC value
+    */
+    template <typename Result_t>
+    static Value_t& result(Pool_t &pool, const Result_t &value)
+    {
+        return ValueTraits_t<typename ParamType_t<Result_t>::type>::make(
+                pool, value);
+    }
+
+    /**
+        @brief Append signature character of type to signature
+    */
+    template <typename Type_t>
+    static std::string& sign(std::string &signature)
+    {
+        if (!signature.empty()) signature.push_back(':');
+        signature.push_back(
+                ValueTraits_t<typename ParamType_t<Type_t>::type>::signature());
+        return signature;
+    }
+
+private:
+    std::string signature;
+};
+
+template <typename Object_t, typename Handler_t, typename Result_t>
+class TypedMethod0_t : public TypedMethod_t
+{
+public:
+    TypedMethod0_t(Object_t &object, Handler_t handler)
+            :TypedMethod_t(makeSignature()), object(object), handler(handler)
+    {}
+
+    virtual ~TypedMethod0_t()
+    {}
+
+    virtual Value_t& call(Pool_t& pool, Array_t& params)
+    {
+        checkParams(params, 0);
+        return result<Result_t>(pool, (object.*handler)());
+    }
+
+private:
+    static std::string makeSignature()
+    {
+        std::string signature;
+        sign<Result_t>(signature);
+        return signature;
+    }
+
+    Object_t &object;
+    Handler_t handler;
+};
+
+template <typename Object_t, typename Result_t>
+TypedMethod0_t<Object_t, Result_t (Object_t::*)(), Result_t>*
+typedMethod(Result_t (Object_t::*handler)(), Object_t &object)
+{
+    return new TypedMethod0_t<Object_t, Result_t (Object_t::*)(),
+                              Result_t>(object, handler);
+}
+
+template <typename Object_t, typename Result_t>
+TypedMethod0_t<const Object_t, Result_t (Object_t::*)() const, Result_t>*
+typedMethod(Result_t (Object_t::*handler)() const, const Object_t &object)
+{
+    return new TypedMethod0_t<const Object_t,
+                              Result_t (Object_t::*)() const,
+                              Result_t>(object, handler);
+}
+
+template <typename Object_t, typename Handler_t, typename Result_t, typename Arg1_t>
+class TypedMethod1_t : public TypedMethod_t
+{
+public:
+    TypedMethod1_t(Object_t &object, Handler_t handler)
+            :TypedMethod_t(makeSignature()), object(object), handler(handler)
+    {}
+
+    virtual ~TypedMethod1_t()
+    {}
+
+    virtual Value_t& call(Pool_t& pool, Array_t& params)
+    {
+        checkParams(params, 1);
+        return result<Result_t>(pool, (object.*handler)(
+                param<Arg1_t>(params, 0)));
+    }
+
+private:
+    static std::string makeSignature()
+    {
+        std::string signature;
+        sign<Result_t>(signature);
+        sign<Arg1_t>(signature);
+        return signature;
+    }
+
+    Object_t &object;
+    Handler_t handler;
+};
+
+template <typename Object_t, typename Result_t, typename Arg1_t>
+TypedMethod1_t<Object_t, Result_t (Object_t::*)(Arg1_t), Result_t, Arg1_t>*
+typedMethod(Result_t (Object_t::*handler)(Arg1_t), Object_t &object)
+{
+    return new TypedMethod1_t<Object_t, Result_t (Object_t::*)(Arg1_t),
+                              Result_t, Arg1_t>(object, handler);
+}
+
+template <typename Object_t, typename Result_t, typename Arg1_t>
+TypedMethod1_t<const Object_t, Result_t (Object_t::*)(Arg1_t) const, Result_t, Arg1_t>*
+typedMethod(Result_t (Object_t::*handler)(Arg1_t) const, const Object_t &object)
+{
+    return new TypedMethod1_t<const Object_t,
+                              Result_t (Object_t::*)(Arg1_t) const,
+                              Result_t, Arg1_t>(object, handler);
+}
+
+template <typename Object_t, typename Handler_t, typename Result_t, typename Arg1_t, typename Arg2_t>
+class TypedMethod2_t : public TypedMethod_t
+{
+public:
+    TypedMethod2_t(Object_t &object, Handler_t handler)
+            :TypedMethod_t(makeSignature()), object(object), handler(handler)
+    {}
+
+    virtual ~TypedMethod2_t()
+    {}
+
+    virtual Value_t& call(Pool_t& pool, Array_t& params)
+    {
+        checkParams(params, 2);
+        return result<Result_t>(pool, (object.*handler)(
+                param<Arg1_t>(params, 0),
+                param<Arg2_t>(params, 1)));
+    }
+
+private:
+    static std::string makeSignature()
+    {
+        std::string signature;
+        sign<Result_t>(signature);
+        sign<Arg1_t>(signature);
+        sign<Arg2_t>(signature);
+        return signature;
+    }
+
+    Object_t &object;
+    Handler_t handler;
+};
+
+template <typename Object_t, typename Result_t, typename Arg1_t, typename Arg2_t>
+TypedMethod2_t<Object_t, Result_t (Object_t::*)(Arg1_t, Arg2_t), Result_t, Arg1_t, Arg2_t>*
+typedMethod(Result_t (Object_t::*handler)(Arg1_t, Arg2_t), Object_t &object)
+{
+    return new TypedMethod2_t<Object_t, Result_t (Object_t::*)(Arg1_t, Arg2_t),
+                              Result_t, Arg1_t, Arg2_t>(object, handler);
+}
+
+template <typename Object_t, typename Result_t, typename Arg1_t, typename Arg2_t>
+TypedMethod2_t<const Object_t, Result_t (Object_t::*)(Arg1_t, Arg2_t) const, Result_t, Arg1_t, Arg2_t>*
+typedMethod(Result_t (Object_t::*handler)(Arg1_t, Arg2_t) const, const Object_t &object)
+{
+    return new TypedMethod2_t<const Object_t,
+                              Result_t (Object_t::*)(Arg1_t, Arg2_t) const,
+                              Result_t, Arg1_t, Arg2_t>(object, handler);
+}
+
+template <typename Object_t, typename Handler_t, typename Result_t, typename Arg1_t, typename Arg2_t, typename Arg3_t>
+class TypedMethod3_t : public TypedMethod_t
+{
+public:
+    TypedMethod3_t(Object_t &object, Handler_t handler)
+            :TypedMethod_t(makeSignature()), object(object), handler(handler)
+    {}
+
+    virtual ~TypedMethod3_t()
+    {}
+
+    virtual Value_t& call(Pool_t& pool, Array_t& params)
+    {
+        checkParams(params, 3);
+        return result<Result_t>(pool, (object.*handler)(
+                param<Arg1_t>(params, 0),
+                param<Arg2_t>(params, 1),
+                param<Arg3_t>(params, 2)));
+    }
+
+private:
+    static std::string makeSignature()
+    {
+        std::string signature;
+        sign<Result_t>(signature);
+        sign<Arg1_t>(signature);
+        sign<Arg2_t>(signature);
+        sign<Arg3_t>(signature);
+        return signature;
+    }
+
+    Object_t &object;
+    Handler_t handler;
+};
+
+template <typename Object_t, typename Result_t, typename Arg1_t, typename Arg2_t, typename Arg3_t>
+TypedMethod3_t<Object_t, Result_t (Object_t::*)(Arg1_t, Arg2_t, Arg3_t), Result_t, Arg1_t, Arg2_t, Arg3_t>*
+typedMethod(Result_t (Object_t::*handler)(Arg1_t, Arg2_t, Arg3_t), Object_t &object)
+{
+    return new TypedMethod3_t<Object_t, Result_t (Object_t::*)(Arg1_t, Arg2_t, Arg3_t),
+                              Result_t, Arg1_t, Arg2_t, Arg3_t>(object, handler);
+}
+
+template <typename Object_t, typename Result_t, typename Arg1_t, typename Arg2_t, typename Arg3_t>
+TypedMethod3_t<const Object_t, Result_t (Object_t::*)(Arg1_t, Arg2_t, Arg3_t) const, Result_t, Arg1_t, Arg2_t, Arg3_t>*
+typedMethod(Result_t (Object_t::*handler)(Arg1_t, Arg2_t, Arg3_t) const, const Object_t &object)
+{
+    return new TypedMethod3_t<const Object_t,
+                              Result_t (Object_t::*)(Arg1_t, Arg2_t, Arg3_t) const,
+                              Result_t, Arg1_t, Arg2_t, Arg3_t>(object, handler);
+}
+
+template <typename Object_t, typename Handler_t, typename Result_t, typename Arg1_t, typename Arg2_t, typename Arg3_t, typename Arg4_t>
+class TypedMethod4_t : public TypedMethod_t
+{
+public:
+    TypedMethod4_t(Object_t &object, Handler_t handler)
+            :TypedMethod_t(makeSignature()), object(object), handler(handler)
+    {}
+
+    virtual ~TypedMethod4_t()
+    {}
+
+    virtual Value_t& call(Pool_t& pool, Array_t& params)
+    {
+        checkParams(params, 4);
+        return result<Result_t>(pool, (object.*handler)(
+                param<Arg1_t>(params, 0),
+                param<Arg2_t>(params, 1),
+                param<Arg3_t>(params, 2),
+                param<Arg4_t>(params, 3)));
+    }
+
+private:
+    static std::string makeSignature()
+    {
+        std::string signature;
+        sign<Result_t>(signature);
+        sign<Arg1_t>(signature);
+        sign<Arg2_t>(signature);
+        sign<Arg3_t>(signature);
+        sign<Arg4_t>(signature);
+        return signature;
+    }
+
+    Object_t &object;
+    Handler_t handler;
+};
+
+template <typename Object_t, typename Result_t, typename Arg1_t, typename Arg2_t, typename Arg3_t, typename Arg4_t>
+TypedMethod4_t<Object_t, Result_t (Object_t::*)(Arg1_t, Arg2_t, Arg3_t, Arg4_t), Result_t, Arg1_t, Arg2_t, Arg3_t, Arg4_t>*
+typedMethod(Result_t (Object_t::*handler)(Arg1_t, Arg2_t, Arg3_t, Arg4_t), Object_t &object)
+{
+    return new TypedMethod4_t<Object_t, Result_t (Object_t::*)(Arg1_t, Arg2_t, Arg3_t, Arg4_t),
+                              Result_t, Arg1_t, Arg2_t, Arg3_t, Arg4_t>(object, handler);
+}
+
+template <typename Object_t, typename Result_t, typename Arg1_t, typename Arg2_t, typename Arg3_t, typename Arg4_t>
+TypedMethod4_t<const Object_t, Result_t (Object_t::*)(Arg1_t, Arg2_t, Arg3_t, Arg4_t) const, Result_t, Arg1_t, Arg2_t, Arg3_t, Arg4_t>*
+typedMethod(Result_t (Object_t::*handler)(Arg1_t, Arg2_t, Arg3_t, Arg4_t) const, const Object_t &object)
+{
+    return new TypedMethod4_t<const Object_t,
+                              Result_t (Object_t::*)(Arg1_t, Arg2_t, Arg3_t, Arg4_t) const,
+                              Result_t, Arg1_t, Arg2_t, Arg3_t, Arg4_t>(object, handler);
+}
+
+template <typename Object_t, typename Handler_t, typename Result_t, typename Arg1_t, typename Arg2_t, typename Arg3_t, typename Arg4_t, typename Arg5_t>
+class TypedMethod5_t : public TypedMethod_t
+{
+public:
+    TypedMethod5_t(Object_t &object, Handler_t handler)
+            :TypedMethod_t(makeSignature()), object(object), handler(handler)
+    {}
+
+    virtual ~TypedMethod5_t()
+    {}
+
+    virtual Value_t& call(Pool_t& pool, Array_t& params)
+    {
+        checkParams(params, 5);
+        return result<Result_t>(pool, (object.*handler)(
+                param<Arg1_t>(params, 0),
+                param<Arg2_t>(params, 1),
+                param<Arg3_t>(params, 2),
+                param<Arg4_t>(params, 3),
+                param<Arg5_t>(params, 4)));
+    }
+
+private:
+    static std::string makeSignature()
+    {
+        std::string signature;
+        sign<Result_t>(signature);
+        sign<Arg1_t>(signature);
+        sign<Arg2_t>(signature);
+        sign<Arg3_t>(signature);
+        sign<Arg4_t>(signature);
+        sign<Arg5_t>(signature);
+        return signature;
+    }
+
+    Object_t &object;
+    Handler_t handler;
+};
+
+template <typename Object_t, typename Result_t, typename Arg1_t, typename Arg2_t, typename Arg3_t, typename Arg4_t, typename Arg5_t>
+TypedMethod5_t<Object_t, Result_t (Object_t::*)(Arg1_t, Arg2_t, Arg3_t, Arg4_t, Arg5_t), Result_t, Arg1_t, Arg2_t, Arg3_t, Arg4_t, Arg5_t>*
+typedMethod(Result_t (Object_t::*handler)(Arg1_t, Arg2_t, Arg3_t, Arg4_t, Arg5_t), Object_t &object)
+{
+    return new TypedMethod5_t<Object_t, Result_t (Object_t::*)(Arg1_t, Arg2_t, Arg3_t, Arg4_t, Arg5_t),
+                              Result_t, Arg1_t, Arg2_t, Arg3_t, Arg4_t, Arg5_t>(object, handler);
+}
+
+template <typename Object_t, typename Result_t, typename Arg1_t, typename Arg2_t, typename Arg3_t, typename Arg4_t, typename Arg5_t>
+TypedMethod5_t<const Object_t, Result_t (Object_t::*)(Arg1_t, Arg2_t, Arg3_t, Arg4_t, Arg5_t) const, Result_t, Arg1_t, Arg2_t, Arg3_t, Arg4_t, Arg5_t>*
+typedMethod(Result_t (Object_t::*handler)(Arg1_t, Arg2_t, Arg3_t, Arg4_t, Arg5_t) const, const Object_t &object)
+{
+    return new TypedMethod5_t<const Object_t,
+                              Result_t (Object_t::*)(Arg1_t, Arg2_t, Arg3_t, Arg4_t, Arg5_t) const,
+                              Result_t, Arg1_t, Arg2_t, Arg3_t, Arg4_t, Arg5_t>(object, handler);
+}
+
+}
+
+#endif
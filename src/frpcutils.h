@@ -0,0 +1,94 @@
+/*
+ * FastRPC -- Fast RPC library compatible with XML-RPC
+ * Copyright (C) 2005-7  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Radlicka 2, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:fastrpc@firma.seznam.cz
+ *
+ *
+ * FILE          $Id$
+ *
+ * DESCRIPTION   Internal helpers shared by the thread safe components
+ *
+ * AUTHOR
+ *
+ * HISTORY
+ *
+ */
+#ifndef FRPCFRPCUTILS_H
+#define FRPCFRPCUTILS_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <sys/time.h>
+
+#include <string>
+#include <vector>
+
+namespace FRPC {
+
+/** Locks mutex for the lifetime of the locker.
+ */
+class Locker_t {
+public:
+    explicit Locker_t(pthread_mutex_t &mutex) : mutex(mutex) {
+        pthread_mutex_lock(&mutex);
+    }
+
+    ~Locker_t() {
+        pthread_mutex_unlock(&mutex);
+    }
+
+private:
+    Locker_t(const Locker_t&);
+    Locker_t& operator=(const Locker_t&);
+
+    pthread_mutex_t &mutex;
+};
+
+/** Absolute (realtime) time given number of miliseconds from now, for
+ *  pthread_cond_timedwait().
+ */
+inline struct timespec absoluteTime(unsigned long timeout) {
+    struct timeval now;
+    gettimeofday(&now, 0);
+    uint64_t usec = uint64_t(now.tv_usec) + uint64_t(timeout) * 1000;
+    struct timespec ts;
+    ts.tv_sec = now.tv_sec + time_t(usec / 1000000);
+    ts.tv_nsec = long(usec % 1000000) * 1000;
+    return ts;
+}
+
+/** Splits comma separated list (e.g. of method name patterns), empty
+ *  items are skipped.
+ */
+inline std::vector<std::string> splitPatterns(const std::string &patterns) {
+    std::vector<std::string> result;
+    std::string::size_type begin = 0;
+    while (begin < patterns.size()) {
+        std::string::size_type end = patterns.find(',', begin);
+        if (end == std::string::npos) end = patterns.size();
+        if (end > begin) result.push_back(patterns.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    return result;
+}
+
+};
+
+#endif
@@ -43,6 +43,7 @@
 namespace FRPC
 {
 class Pool_t;
+class ValueVisitor_t;
 /**
 @brief Abstract Value type
 @author Miroslav Talasek
@@ -98,6 +99,13 @@ public:
        */
     virtual Value_t& clone(Pool_t &newPool) const = 0;
 
+    /**
+       @brief Abstract virtual method to dispatch value to visitor
+       @param visitor visitor whose visit() overload for concrete type
+       of this value is called
+       */
+    virtual void accept(ValueVisitor_t &visitor) const = 0;
+
     bool isNull() const;
 
     /**
@@ -0,0 +1,563 @@
+/*
+ * FastRPC -- Fast RPC library compatible with XML-RPC
+ * Copyright (C) 2005-7  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Radlicka 2, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:fastrpc@firma.seznam.cz
+ *
+ *
+ * FILE          $Id$
+ *
+ * DESCRIPTION   Mapping between C++ types and FastRPC values
+ *
+ * AUTHOR
+ *
+ * HISTORY
+ *
+ */
+#ifndef FRPCFRPCVALUETRAITS_H
+#define FRPCFRPCVALUETRAITS_H
+
+#include <frpcplatform.h>
+
+#include <frpc.h>
+#include <frpclenerror.h>
+#include <frpcmarshaller.h>
+#include <frpctreefeeder.h>
+#include <frpctypedbuilder.h>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <limits>
+
+namespace FRPC
+{
+
+/**
+@brief Mapping of C++ type to FastRPC value
+
+Every specialization provides:
+@li @b result_type - type returned by get() (value or const reference)
+@li @b signature() - character used in method signature (see
+       MethodRegistry_t::registerMethod)
+@li @b typeName() - FastRPC type name used in error messages
+@li @b get(value, index) - converts value to C++ type, throws TypeError_t
+       when value has different type; index is 0-based parameter index
+       used in error message
+@li @b make(pool, value) - creates FastRPC value from C++ value (not
+       available for types which are FastRPC values themselves)
+@li @b pack(marshaller, value) - marshalls C++ value without building
+       FastRPC value
+@li @b sink(target, sinks) - creates TypedSink_t filling target from the
+       unmarshaller events on given SinkStack_t (not available for FastRPC
+       values)
+
+Unsupported types fail to compile.
+*/
+template <typename Type_t>
+struct ValueTraits_t;
+
+/**
+@brief Sink storing int into variable of given type
+*/
+template <typename Int_T>
+class IntSink_t : public TypedSink_t {
+public:
+    explicit IntSink_t(Int_T &target) : target(target) {}
+
+    virtual void buildInt(Int_t::value_type value) {
+        if ((value < Int_t::value_type(std::numeric_limits<Int_T>::min()))
+            || (value > Int_t::value_type(std::numeric_limits<Int_T>::max())))
+        {
+            throw TypeError_t("Value is out of range.");
+        }
+        target = static_cast<Int_T>(value);
+    }
+
+protected:
+    virtual const char* typeName() const { return "int"; }
+
+private:
+    Int_T &target;
+};
+
+class BoolSink_t : public TypedSink_t {
+public:
+    explicit BoolSink_t(bool &target) : target(target) {}
+
+    virtual void buildBool(bool value) {
+        target = value;
+    }
+
+protected:
+    virtual const char* typeName() const { return "bool"; }
+
+private:
+    bool &target;
+};
+
+class DoubleSink_t : public TypedSink_t {
+public:
+    explicit DoubleSink_t(double &target) : target(target) {}
+
+    virtual void buildDouble(double value) {
+        target = value;
+    }
+
+protected:
+    virtual const char* typeName() const { return "double"; }
+
+private:
+    double &target;
+};
+
+class StringSink_t : public TypedSink_t {
+public:
+    explicit StringSink_t(std::string &target) : target(target) {}
+
+    virtual void buildString(const char *data, unsigned int size) {
+        target.assign(data, size);
+    }
+
+protected:
+    virtual const char* typeName() const { return "string"; }
+
+private:
+    std::string &target;
+};
+
+/**
+@brief Sink appending array items into std::vector
+*/
+template <typename Item_t>
+class VectorSink_t : public TypedSink_t {
+public:
+    explicit VectorSink_t(std::vector<Item_t> &target) : target(target) {}
+
+    virtual void openArray(unsigned int numOfItems) {
+        target.clear();
+        target.reserve(numOfItems);
+    }
+
+    virtual TypedSink_t* item(SinkStack_t &sinks) {
+        target.push_back(Item_t());
+        return ValueTraits_t<Item_t>::sink(target.back(), sinks);
+    }
+
+protected:
+    virtual const char* typeName() const { return "array"; }
+
+private:
+    std::vector<Item_t> &target;
+};
+
+/**
+@brief Sink inserting struct members into std::map
+*/
+template <typename Item_t>
+class MapSink_t : public TypedSink_t {
+public:
+    explicit MapSink_t(std::map<std::string, Item_t> &target)
+        : target(target)
+    {}
+
+    virtual void openStruct(unsigned int) {
+        target.clear();
+    }
+
+    virtual TypedSink_t* member(const char *name, unsigned int size,
+                                SinkStack_t &sinks)
+    {
+        return ValueTraits_t<Item_t>::sink(target[std::string(name, size)],
+                                           sinks);
+    }
+
+protected:
+    virtual const char* typeName() const { return "struct"; }
+
+private:
+    std::map<std::string, Item_t> &target;
+};
+
+/**
+@brief Strips const and reference from handler parameter type
+*/
+template <typename Type_t>
+struct ParamType_t {
+    typedef Type_t type;
+};
+
+template <typename Type_t>
+struct ParamType_t<const Type_t> {
+    typedef Type_t type;
+};
+
+template <typename Type_t>
+struct ParamType_t<const Type_t&> {
+    typedef Type_t type;
+};
+
+template <typename Type_t>
+struct ParamType_t<Type_t&> {
+    typedef Type_t type;
+};
+
+/**
+@brief Throws TypeError_t describing parameter type mismatch
+@param value offending value
+@param index 0-based parameter index
+@param typeName expected type name
+*/
+inline void throwParamTypeError(const Value_t &value, unsigned int index,
+                                const char *typeName)
+{
+    throw TypeError_t::format("Parameter %u must be %s not %s.",
+                              index + 1, typeName, value.getTypeName());
+}
+
+template <typename Int_T>
+struct IntValueTraits_t {
+    typedef Int_T result_type;
+
+    static char signature() { return 'i'; }
+
+    static const char* typeName() { return "int"; }
+
+    static result_type get(const Value_t &value, unsigned int index) {
+        if (value.getType() != Int_t::TYPE)
+            throwParamTypeError(value, index, typeName());
+
+        Int_t::value_type number
+            = static_cast<const Int_t&>(value).getValue();
+        if ((number < Int_t::value_type(std::numeric_limits<Int_T>::min()))
+            || (number > Int_t::value_type(std::numeric_limits<Int_T>::max())))
+        {
+            throw TypeError_t::format("Parameter %u is out of range.",
+                                      index + 1);
+        }
+        return static_cast<result_type>(number);
+    }
+
+    static Value_t& make(Pool_t &pool, const Int_T &value) {
+        return pool.Int(value);
+    }
+
+    static void pack(Marshaller_t &marshaller, const Int_T &value) {
+        marshaller.packInt(value);
+    }
+
+    static TypedSink_t* sink(Int_T &target, SinkStack_t &sinks) {
+        return sinks.push<IntSink_t<Int_T> >(target);
+    }
+};
+
+template <>
+struct ValueTraits_t<int> : public IntValueTraits_t<int> {};
+
+template <>
+struct ValueTraits_t<long> : public IntValueTraits_t<long> {};
+
+template <>
+struct ValueTraits_t<long long> : public IntValueTraits_t<long long> {};
+
+template <>
+struct ValueTraits_t<bool> {
+    typedef bool result_type;
+
+    static char signature() { return 'b'; }
+
+    static const char* typeName() { return "bool"; }
+
+    static result_type get(const Value_t &value, unsigned int index) {
+        if (value.getType() != Bool_t::TYPE)
+            throwParamTypeError(value, index, typeName());
+        return static_cast<const Bool_t&>(value).getValue();
+    }
+
+    static Value_t& make(Pool_t &pool, bool value) {
+        return pool.Bool(value);
+    }
+
+    static void pack(Marshaller_t &marshaller, bool value) {
+        marshaller.packBool(value);
+    }
+
+    static TypedSink_t* sink(bool &target, SinkStack_t &sinks) {
+        return sinks.push<BoolSink_t>(target);
+    }
+};
+
+template <>
+struct ValueTraits_t<double> {
+    typedef double result_type;
+
+    static char signature() { return 'd'; }
+
+    static const char* typeName() { return "double"; }
+
+    static result_type get(const Value_t &value, unsigned int index) {
+        if (value.getType() != Double_t::TYPE)
+            throwParamTypeError(value, index, typeName());
+        return static_cast<const Double_t&>(value).getValue();
+    }
+
+    static Value_t& make(Pool_t &pool, double value) {
+        return pool.Double(value);
+    }
+
+    static void pack(Marshaller_t &marshaller, double value) {
+        marshaller.packDouble(value);
+    }
+
+    static TypedSink_t* sink(double &target, SinkStack_t &sinks) {
+        return sinks.push<DoubleSink_t>(target);
+    }
+};
+
+template <>
+struct ValueTraits_t<std::string> {
+    typedef const std::string& result_type;
+
+    static char signature() { return 's'; }
+
+    static const char* typeName() { return "string"; }
+
+    static result_type get(const Value_t &value, unsigned int index) {
+        if (value.getType() != String_t::TYPE)
+            throwParamTypeError(value, index, typeName());
+        return static_cast<const String_t&>(value).getValue();
+    }
+
+    static Value_t& make(Pool_t &pool, const std::string &value) {
+        return pool.String(value);
+    }
+
+    static void pack(Marshaller_t &marshaller, const std::string &value) {
+        marshaller.packString(value.data(), value.size());
+    }
+
+    static TypedSink_t* sink(std::string &target, SinkStack_t &sinks) {
+        return sinks.push<StringSink_t>(target);
+    }
+};
+
+/**
+@brief Items of the array are converted one by one (all must have same type)
+*/
+template <typename Item_t>
+struct ValueTraits_t<std::vector<Item_t> > {
+    typedef std::vector<Item_t> result_type;
+
+    static char signature() { return 'A'; }
+
+    static const char* typeName() { return "array"; }
+
+    static result_type get(const Value_t &value, unsigned int index) {
+        if (value.getType() != Array_t::TYPE)
+            throwParamTypeError(value, index, typeName());
+
+        const Array_t &array = static_cast<const Array_t&>(value);
+        result_type result;
+        result.reserve(array.size());
+        for (Array_t::const_iterator iarray = array.begin(),
+                 earray = array.end(); iarray != earray; ++iarray)
+        {
+            result.push_back(ValueTraits_t<Item_t>::get(**iarray, index));
+        }
+        return result;
+    }
+
+    static Value_t& make(Pool_t &pool, const std::vector<Item_t> &value) {
+        Array_t &array = pool.Array();
+        array.reserve(value.size());
+        for (typename std::vector<Item_t>::const_iterator
+                 ivalue = value.begin(), evalue = value.end();
+             ivalue != evalue; ++ivalue)
+        {
+            array.append(ValueTraits_t<Item_t>::make(pool, *ivalue));
+        }
+        return array;
+    }
+
+    static void pack(Marshaller_t &marshaller,
+                     const std::vector<Item_t> &value)
+    {
+        marshaller.packArray(value.size());
+        for (typename std::vector<Item_t>::const_iterator
+                 ivalue = value.begin(), evalue = value.end();
+             ivalue != evalue; ++ivalue)
+        {
+            ValueTraits_t<Item_t>::pack(marshaller, *ivalue);
+        }
+    }
+
+    static TypedSink_t* sink(std::vector<Item_t> &target,
+                             SinkStack_t &sinks)
+    {
+        return sinks.push<VectorSink_t<Item_t> >(target);
+    }
+};
+
+/**
+@brief Members of the struct are converted one by one (all must have same
+type)
+*/
+template <typename Item_t>
+struct ValueTraits_t<std::map<std::string, Item_t> > {
+    typedef std::map<std::string, Item_t> result_type;
+
+    static char signature() { return 'S'; }
+
+    static const char* typeName() { return "struct"; }
+
+    static result_type get(const Value_t &value, unsigned int index) {
+        if (value.getType() != Struct_t::TYPE)
+            throwParamTypeError(value, index, typeName());
+
+        const Struct_t &structVal = static_cast<const Struct_t&>(value);
+        result_type result;
+        for (Struct_t::const_iterator istruct = structVal.begin(),
+                 estruct = structVal.end(); istruct != estruct; ++istruct)
+        {
+            result.insert(result.end(), typename result_type::value_type(
+                    istruct->first,
+                    ValueTraits_t<Item_t>::get(*istruct->second, index)));
+        }
+        return result;
+    }
+
+    static Value_t& make(Pool_t &pool,
+                         const std::map<std::string, Item_t> &value)
+    {
+        Struct_t &structVal = pool.Struct();
+        for (typename std::map<std::string, Item_t>::const_iterator
+                 ivalue = value.begin(), evalue = value.end();
+             ivalue != evalue; ++ivalue)
+        {
+            structVal.append(ivalue->first,
+                             ValueTraits_t<Item_t>::make(pool, ivalue->second));
+        }
+        return structVal;
+    }
+
+    static void pack(Marshaller_t &marshaller,
+                     const std::map<std::string, Item_t> &value)
+    {
+        marshaller.packStruct(value.size());
+        for (typename std::map<std::string, Item_t>::const_iterator
+                 ivalue = value.begin(), evalue = value.end();
+             ivalue != evalue; ++ivalue)
+        {
+            marshaller.packStructMember(ivalue->first.data(),
+                                        ivalue->first.size());
+            ValueTraits_t<Item_t>::pack(marshaller, ivalue->second);
+        }
+    }
+
+    static TypedSink_t* sink(std::map<std::string, Item_t> &target,
+                             SinkStack_t &sinks)
+    {
+        return sinks.push<MapSink_t<Item_t> >(target);
+    }
+};
+
+/*
+ * FastRPC values are passed to the handler as they are. There is no make()
+ * because the handler has no pool to allocate the result from and there is
+ * no sink() because there is no pool to build the value in.
+ */
+template <>
+struct ValueTraits_t<Binary_t> {
+    typedef const Binary_t& result_type;
+
+    static char signature() { return 'B'; }
+
+    static const char* typeName() { return "binary"; }
+
+    static result_type get(const Value_t &value, unsigned int index) {
+        if (value.getType() != Binary_t::TYPE)
+            throwParamTypeError(value, index, typeName());
+        return static_cast<const Binary_t&>(value);
+    }
+
+    static void pack(Marshaller_t &marshaller, const Binary_t &value) {
+        TreeFeeder_t(marshaller).feedValue(value);
+    }
+};
+
+template <>
+struct ValueTraits_t<DateTime_t> {
+    typedef const DateTime_t& result_type;
+
+    static char signature() { return 'D'; }
+
+    static const char* typeName() { return "dateTime"; }
+
+    static result_type get(const Value_t &value, unsigned int index) {
+        if (value.getType() != DateTime_t::TYPE)
+            throwParamTypeError(value, index, typeName());
+        return static_cast<const DateTime_t&>(value);
+    }
+
+    static void pack(Marshaller_t &marshaller, const DateTime_t &value) {
+        TreeFeeder_t(marshaller).feedValue(value);
+    }
+};
+
+template <>
+struct ValueTraits_t<Struct_t> {
+    typedef const Struct_t& result_type;
+
+    static char signature() { return 'S'; }
+
+    static const char* typeName() { return "struct"; }
+
+    static result_type get(const Value_t &value, unsigned int index) {
+        if (value.getType() != Struct_t::TYPE)
+            throwParamTypeError(value, index, typeName());
+        return static_cast<const Struct_t&>(value);
+    }
+
+    static void pack(Marshaller_t &marshaller, const Struct_t &value) {
+        TreeFeeder_t(marshaller).feedValue(value);
+    }
+};
+
+template <>
+struct ValueTraits_t<Array_t> {
+    typedef const Array_t& result_type;
+
+    static char signature() { return 'A'; }
+
+    static const char* typeName() { return "array"; }
+
+    static result_type get(const Value_t &value, unsigned int index) {
+        if (value.getType() != Array_t::TYPE)
+            throwParamTypeError(value, index, typeName());
+        return static_cast<const Array_t&>(value);
+    }
+
+    static void pack(Marshaller_t &marshaller, const Array_t &value) {
+        TreeFeeder_t(marshaller).feedValue(value);
+    }
+};
+
+};
+
+#endif
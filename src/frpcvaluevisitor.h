@@ -0,0 +1,79 @@
+/*
+ * FastRPC -- Fast RPC library compatible with XML-RPC
+ * Copyright (C) 2005-7  Seznam.cz, a.s.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Seznam.cz, a.s.
+ * Radlicka 2, Praha 5, 15000, Czech Republic
+ * http://www.seznam.cz, mailto:fastrpc@firma.seznam.cz
+ *
+ * FILE          $Id$
+ *
+ * DESCRIPTION   Double dispatch visitor over FastRPC values
+ *
+ * AUTHOR
+ *
+ * HISTORY
+ *
+ */
+#ifndef FRPCFRPCVALUEVISITOR_H
+#define FRPCFRPCVALUEVISITOR_H
+
+#include <frpcplatform.h>
+
+namespace FRPC
+{
+
+class Int_t;
+class Bool_t;
+class Double_t;
+class String_t;
+class Binary_t;
+class DateTime_t;
+class Struct_t;
+class Array_t;
+class Null_t;
+
+/**
+@brief Visitor over concrete Value_t types
+
+Value_t::accept() calls the visit() overload matching the concrete type of
+the value, so the caller gets the typed reference without getType() switch
+and without any dynamic_cast. Containers are not traversed automatically;
+visitor decides itself whether (and how) to descend into the items.
+*/
+class FRPC_DLLEXPORT ValueVisitor_t
+{
+public:
+    /**
+        @brief Destructor
+    */
+    virtual ~ValueVisitor_t() {}
+
+    virtual void visit(const Int_t &value) = 0;
+    virtual void visit(const Bool_t &value) = 0;
+    virtual void visit(const Double_t &value) = 0;
+    virtual void visit(const String_t &value) = 0;
+    virtual void visit(const Binary_t &value) = 0;
+    virtual void visit(const DateTime_t &value) = 0;
+    virtual void visit(const Struct_t &value) = 0;
+    virtual void visit(const Array_t &value) = 0;
+    virtual void visit(const Null_t &value) = 0;
+};
+
+};
+
+#endif
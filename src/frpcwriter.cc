@@ -42,6 +42,39 @@ Writer_t::Writer_t()
 Writer_t::~Writer_t()
 {}
 
+BufferedWriter_t::~BufferedWriter_t()
+{}
+
+StringWriter_t::~StringWriter_t()
+{}
+
+void BufferedWriter_t::flush()
+{
+    drain();
+    target.flush();
+}
+
+void BufferedWriter_t::drain()
+{
+    if (used) {
+        // reset first, target may throw
+        unsigned int size = used;
+        used = 0;
+        target.write(block, size);
+    }
+}
+
+void BufferedWriter_t::writeLong(const char *data, unsigned int size)
+{
+    drain();
+    if (size < BLOCK_SIZE) {
+        memcpy(block, data, size);
+        used = size;
+    } else {
+        target.write(data, size);
+    }
+}
+
 
 }
 ;
@@ -32,7 +32,8 @@
  */
 #ifndef FRPCFRPCWRITER_H
 #define FRPCFRPCWRITER_H
-//#include <string>
+#include <string>
+#include <string.h>
 #include <frpcplatform.h>
 
 
@@ -55,6 +56,90 @@ public:
     
 };
 
+/** Buffering adapter over any writer.
+ *
+ * Data are collected in one contiguous block; the target writer is called
+ * only when the block fills (or for data larger than the block) and on
+ * flush(). Producers can also fill the block in place by reserve() and
+ * commit(). Calls on the BufferedWriter_t object itself (not through
+ * Writer_t reference) are resolved statically and inlined.
+ *
+ * Data not flushed are lost when the object is destroyed: the target may
+ * already be gone at that time.
+ */
+class FRPC_DLLEXPORT BufferedWriter_t : public Writer_t
+{
+public:
+    enum { BLOCK_SIZE = 4096 };
+
+    explicit BufferedWriter_t(Writer_t &target)
+        : target(target), used(0)
+    {}
+
+    virtual ~BufferedWriter_t();
+
+    virtual void write(const char *data, unsigned int size) {
+        if (size <= BLOCK_SIZE - used) {
+            memcpy(block + used, data, size);
+            used += size;
+        } else {
+            writeLong(data, size);
+        }
+    }
+
+    /** Pass buffered data to the target and flush it.
+     */
+    virtual void flush();
+
+    /** Get room for size (at most BLOCK_SIZE) bytes; the written ones are
+     *  accounted by commit().
+     */
+    char* reserve(unsigned int size) {
+        if (BLOCK_SIZE - used < size) drain();
+        return block + used;
+    }
+
+    void commit(unsigned int size) {
+        used += size;
+    }
+
+    /** Pass buffered data to the target without flushing it.
+     */
+    void drain();
+
+private:
+    BufferedWriter_t(const BufferedWriter_t&);
+    BufferedWriter_t& operator=(const BufferedWriter_t&);
+
+    void writeLong(const char *data, unsigned int size);
+
+    Writer_t &target;           //!< adapted writer
+    unsigned int used;          //!< bytes in the block
+    char block[BLOCK_SIZE];     //!< data not passed to the target yet
+};
+
+/** Writer appending all data to given string (e.g. to get serialized
+ *  value by marshaller).
+ */
+class FRPC_DLLEXPORT StringWriter_t : public Writer_t
+{
+public:
+    explicit StringWriter_t(std::string &data)
+        : data(data)
+    {}
+
+    virtual ~StringWriter_t();
+
+    virtual void write(const char *data, unsigned int size) {
+        this->data.append(data, size);
+    }
+
+    virtual void flush() {}
+
+private:
+    std::string &data;
+};
+
 };
 
 #endif
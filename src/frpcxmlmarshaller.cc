@@ -45,8 +45,10 @@ namespace FRPC {
 
 
 XmlMarshaller_t::XmlMarshaller_t(Writer_t &writer,
-                                 const ProtocolVersion_t &protocolVersion)
-        :writer(writer),level(0),protocolVersion(protocolVersion) {
+                                 const ProtocolVersion_t &protocolVersion,
+                                 bool compact)
+        :writer(writer),compact(compact),level(0),
+         protocolVersion(protocolVersion) {
 
     if (protocolVersion.versionMajor > FRPC_MAJOR_VERSION) {
         throw Error_t("Not supported protocol version");
@@ -64,33 +66,33 @@ void XmlMarshaller_t::packArray(unsigned int numOfItems) {
     //write correct spaces
     packSpaces(level);
     if (entityStorage.empty()) {
-        writer.write("<param>\n",8);
+        writeTag("<param>\n",8);
         level++;
     }
 
     packSpaces(level);
     //write array tag
-    writer.write("<value>\n",8);
+    writeTag("<value>\n",8);
     level++;
     packSpaces(level);
-    writer.write("<array>\n",8);
+    writeTag("<array>\n",8);
     level++;
 
 
     //write correct spaces
     packSpaces(level);
     //write array tag
-    writer.write("<data>\n",7);
+    writeTag("<data>\n",7);
     level++;
     if (numOfItems == 0) {
         level--;
-        writer.write("</data>\n",8);
+        writeTag("</data>\n",8);
         level--;
-        writer.write("</array>\n",9);
+        writeTag("</array>\n",9);
         level--;
-        writer.write("</value>\n",9);
+        writeTag("</value>\n",9);
         if ( entityStorage.size() == 0)
-            writer.write("</param>\n",9);
+            writeTag("</param>\n",9);
         decrementItem();
     } else {
         //entity to storage
@@ -105,7 +107,7 @@ void XmlMarshaller_t::packBinary(const char* value, unsigned int size) {
     //write correct spaces
     packSpaces(level);
     if (entityStorage.empty()) {
-        writer.write("<param>\n",8);
+        writeTag("<param>\n",8);
         level++;
     }
     //write correct spaces
@@ -114,15 +116,15 @@ void XmlMarshaller_t::packBinary(const char* value, unsigned int size) {
     writer.write("<value><base64>",15);
     //write value base64
     //writer.write(value,size);
-    writeEncodeBase64(writer, value, size);
+    writeEncodeBase64(writer, value, size, !compact);
     //write tags
-    writer.write("</base64></value>\n",18);
+    writeTag("</base64></value>\n",18);
 
 
 
     if (entityStorage.empty()) {
         packSpaces(level - 1);
-        writer.write("</param>\n",9);
+        writeTag("</param>\n",9);
         level--;
     }
     decrementItem();
@@ -135,20 +137,20 @@ void XmlMarshaller_t::packBool(bool value) {
     //write correct spaces
     packSpaces(level);
     if (entityStorage.empty()) {
-        writer.write("<param>\n",8);
+        writeTag("<param>\n",8);
         level++;
     }
     //write correct spaces
     packSpaces(level);
     writer.write("<value><boolean>",16);
     writer.write(&boolean,1);
-    writer.write("</boolean></value>\n",19);
+    writeTag("</boolean></value>\n",19);
 
 
 
     if (entityStorage.empty()) {
         packSpaces(level - 1);
-        writer.write("</param>\n",9);
+        writeTag("</param>\n",9);
         level--;
     }
     decrementItem();
@@ -164,14 +166,14 @@ void XmlMarshaller_t::packNull() {
 
     packSpaces(level);
     if (entityStorage.empty()) {
-        writer.write("<param>\n",8);
+        writeTag("<param>\n",8);
         ++level;
     }
     packSpaces(level);
-    writer.write("<value><nil/></value>\n",22);
+    writeTag("<value><nil/></value>\n",22);
     if (entityStorage.empty()) {
         packSpaces(level - 1);
-        writer.write("</param>\n",9);
+        writeTag("</param>\n",9);
         --level;
     }
     decrementItem();
@@ -180,28 +182,29 @@ void XmlMarshaller_t::packNull() {
 void XmlMarshaller_t::packDateTime(short year, char month, char day, char hour,
                                    char minute, char sec, char weekDay,
                                    time_t unixTime, int timeZone) {
-    std::string data = getISODateTime(year, month, day, hour, minute,
-                                      sec, timeZone);
+    char data[ISO_DATETIME_SIZE];
+    unsigned int size = formatISODateTime(data, year, month, day, hour,
+                                          minute, sec, timeZone);
 
     //write correct spaces
     packSpaces(level);
     if (entityStorage.empty()) {
-        writer.write("<param>\n",8);
+        writeTag("<param>\n",8);
         level++;
     }
 
     //write correct spaces
     packSpaces(level);
     writer.write("<value><dateTime.iso8601>",25);
-    writer.write(data.data(),data.size());
-    writer.write("</dateTime.iso8601></value>\n",28);
+    writer.write(data, size);
+    writeTag("</dateTime.iso8601></value>\n",28);
 
 
 
 
     if (entityStorage.empty()) {
         packSpaces(level - 1);
-        writer.write("</param>\n",9);
+        writeTag("</param>\n",9);
         level--;
     }
 
@@ -218,7 +221,7 @@ void XmlMarshaller_t::packDouble(double value) {
     //write correct spaces
     packSpaces(level);
     if (entityStorage.empty()) {
-        writer.write("<param>\n",8);
+        writeTag("<param>\n",8);
         level++;
     }
 
@@ -226,14 +229,14 @@ void XmlMarshaller_t::packDouble(double value) {
     packSpaces(level);
     writer.write("<value><double>",15);
     writer.write(buff.data(), buff.size());
-    writer.write("</double></value>\n",18);
+    writeTag("</double></value>\n",18);
 
 
 
 
     if (entityStorage.empty()) {
         packSpaces(level - 1);
-        writer.write("</param>\n",9);
+        writeTag("</param>\n",9);
         level--;
     }
     decrementItem();
@@ -244,11 +247,11 @@ void XmlMarshaller_t::packFault(int errNumber, const char* errMsg, unsigned int
 
     //magic
     packMagic();
-    writer.write("<methodResponse>\n",17);
+    writeTag("<methodResponse>\n",17);
     level++;
     //tag fault
     packSpaces(level);
-    writer.write("<fault>\n",8);
+    writeTag("<fault>\n",8);
     level++;
 
     entityStorage.push_back(TypeStorage_t(FAULT,0));
@@ -260,11 +263,11 @@ void XmlMarshaller_t::packFault(int errNumber, const char* errMsg, unsigned int
     packString(errMsg,size);
 
     packSpaces(level - 1);
-    writer.write("</fault>\n",9);
+    writeTag("</fault>\n",9);
     level--;
 
     packSpaces(level - 1);
-    writer.write("</methodResponse>\n",18);
+    writeTag("</methodResponse>\n",18);
 
     mainType = FAULT;
 
@@ -277,7 +280,7 @@ void XmlMarshaller_t::packInt(Int_t::value_type value) {
     //write correct spaces
     packSpaces(level);
     if (entityStorage.empty()) {
-        writer.write("<param>\n",8);
+        writeTag("<param>\n",8);
         level++;
     }
 
@@ -292,11 +295,11 @@ void XmlMarshaller_t::packInt(Int_t::value_type value) {
 
         writer.write("<value><i8>",11);
         writer.write(buff.str().data(),buff.str().size());
-        writer.write("</i8></value>\n",14);
+        writeTag("</i8></value>\n",14);
     } else {
         writer.write("<value><i4>",11);
         writer.write(buff.str().data(),buff.str().size());
-        writer.write("</i4></value>\n",14);
+        writeTag("</i4></value>\n",14);
     }
 
 
@@ -304,7 +307,7 @@ void XmlMarshaller_t::packInt(Int_t::value_type value) {
 
     if (entityStorage.empty()) {
         packSpaces(level - 1);
-        writer.write("</param>\n",9);
+        writeTag("</param>\n",9);
         level--;
     }
     decrementItem();
@@ -320,14 +323,14 @@ void XmlMarshaller_t::packMethodCall(const char* methodName, unsigned int size)
     //pack MAgic header
     packMagic();
 
-    writer.write("<methodCall>\n",13);
+    writeTag("<methodCall>\n",13);
     level++;
     packSpaces(level);
     writer.write("<methodName>",12);
     writeQuotedString(methodName,size);
     //writer.write(methodName,nameSize);
-    writer.write("</methodName>\n",14);
-    writer.write("<params>\n",9);
+    writeTag("</methodName>\n",14);
+    writeTag("<params>\n",9);
     level++;
 
     mainType = METHOD_CALL;
@@ -336,10 +339,10 @@ void XmlMarshaller_t::packMethodCall(const char* methodName, unsigned int size)
 
 void XmlMarshaller_t::packMethodResponse() {
     packMagic();
-    writer.write("<methodResponse>\n",17);
+    writeTag("<methodResponse>\n",17);
     level++;
     packSpaces(level);
-    writer.write("<params>\n",9);
+    writeTag("<params>\n",9);
     level++;
 
     mainType = METHOD_RESPONSE;
@@ -352,7 +355,7 @@ void XmlMarshaller_t::packString(const char* value, unsigned int size) {
     //write correct spaces
     packSpaces(level);
     if (entityStorage.empty()) {
-        writer.write("<param>\n",8);
+        writeTag("<param>\n",8);
         level++;
     }
     //write correct spaces
@@ -363,11 +366,11 @@ void XmlMarshaller_t::packString(const char* value, unsigned int size) {
     writeQuotedString(value,size);
     //writer.write(value,strSize);
     //write tags
-    writer.write("</string></value>\n",18);
+    writeTag("</string></value>\n",18);
 
     if (entityStorage.empty()) {
         packSpaces(level - 1);
-        writer.write("</param>\n",9);
+        writeTag("</param>\n",9);
         level--;
     }
     decrementItem();
@@ -378,24 +381,24 @@ void XmlMarshaller_t::packStruct(unsigned int numOfMembers) {
     //write correct spaces
     packSpaces(level);
     if (entityStorage.empty()) {
-        writer.write("<param>\n",8);
+        writeTag("<param>\n",8);
         level++;
     }
 
     packSpaces(level);
     //write array tag
-    writer.write("<value>\n",8);
+    writeTag("<value>\n",8);
     level++;
     packSpaces(level);
-    writer.write("<struct>\n",9);
+    writeTag("<struct>\n",9);
     level++;
     if (numOfMembers == 0) {
         level--;
-        writer.write("</struct>\n",10);
+        writeTag("</struct>\n",10);
         level--;
-        writer.write("</value>\n",9);
+        writeTag("</value>\n",9);
         if ( entityStorage.size() == 0)
-            writer.write("</param>\n",9);
+            writeTag("</param>\n",9);
         decrementItem();
     } else {
 
@@ -413,14 +416,14 @@ void XmlMarshaller_t::packStructMember(const char* memberName, unsigned int size
             "Lenght of member name is %d not in interval (1-255)", size);
 
     packSpaces(level);
-    writer.write("<member>\n",9);
+    writeTag("<member>\n",9);
     level++;
 
     packSpaces(level);
     writer.write("<name>",6);
     writeQuotedString(memberName,size);
     //writer.write(memberName,nameSize);
-    writer.write("</name>\n",8);
+    writeTag("</name>\n",8);
 
 }
 void XmlMarshaller_t::flush() {
@@ -429,17 +432,17 @@ void XmlMarshaller_t::flush() {
 
     case METHOD_CALL:
         packSpaces(level-1);
-        writer.write("</params>\n",10);
+        writeTag("</params>\n",10);
         level--;
         packSpaces(level-1);
-        writer.write("</methodCall>\n",14);
+        writeTag("</methodCall>\n",14);
         break;
     case METHOD_RESPONSE:
         packSpaces(level-1);
-        writer.write("</params>\n",10);
+        writeTag("</params>\n",10);
         level--;
         packSpaces(level-1);
-        writer.write("</methodResponse>\n",18);
+        writeTag("</methodResponse>\n",18);
         break;
     }
     writer.flush();
@@ -469,72 +472,70 @@ void XmlMarshaller_t::writeEncodeBase64(Writer_t &writer, const char *data, unsi
     static const char table[] =
         "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
 
-    std::string src(data,len);
-
-    if (src.empty()) {
-
-        return ;
-    }
-
-
-
-
-    size_t lineLen = 0;
-    std::string::const_iterator end = src.end();
-    for (std::string::const_iterator isrc = src.begin();
-            isrc != end; ) {
-        unsigned char input[3];
-        int n = 0;
-        for (; (isrc != end) && (n < 3) ; isrc++, n++)
-            input[n] = *isrc;
-
-        if (n) {
-            writer.write(&table[input[0] >> 2],1);
-            writer.write(&table[((input[0] & 0x03) << 4) | (input[1] >> 4)],1);
-            if (n > 1)
-                writer.write(&table[((input[1] & 0x0F) << 2) | (input[2] >> 6)],1);
-            else
-                writer.write("=",1);
-            if (n > 2)
-                writer.write(&table[input[2] & 0x3F],1);
-            else
-                writer.write("=",1);
-            lineLen += 4;
-            if (lineLen > 72) {
-                if (rn) writer.write("\r\n",2);
-                lineLen = 0;
+    // one line (76 characters + CRLF) written at once
+    char line[80];
+    unsigned int lineLen = 0;
+    const unsigned char *input = reinterpret_cast<const unsigned char*>(data);
+    for (const unsigned char *end = input + len; input < end; input += 3) {
+        unsigned int n = end - input;
+        unsigned char in1 = (n > 1) ? input[1] : 0;
+        unsigned char in2 = (n > 2) ? input[2] : 0;
+
+        line[lineLen++] = table[input[0] >> 2];
+        line[lineLen++] = table[((input[0] & 0x03) << 4) | (in1 >> 4)];
+        line[lineLen++] = (n > 1) ? table[((in1 & 0x0F) << 2) | (in2 >> 6)]
+                                  : '=';
+        line[lineLen++] = (n > 2) ? table[in2 & 0x3F] : '=';
+        if (lineLen > 72) {
+            if (rn) {
+                line[lineLen++] = '\r';
+                line[lineLen++] = '\n';
             }
+            writer.write(line, lineLen);
+            lineLen = 0;
         }
     }
 
     if (lineLen) {
-        if (rn) writer.write("\r\n",2);
-        lineLen = 0;
+        if (rn) {
+            line[lineLen++] = '\r';
+            line[lineLen++] = '\n';
+        }
+        writer.write(line, lineLen);
     }
-
-
-    return ;
 }
+
 void XmlMarshaller_t::writeQuotedString(const char *data, unsigned int len) {
-    for (unsigned int i = 0; i < len; i++) {
-        switch (data[i]) {
+    const char *run = data;
+    for (const char *end = data + len; data != end; ++data) {
+        const char *entity;
+        unsigned int size;
+        switch (*data) {
         case '<':
-            writer.write("&lt;",4);
+            entity = "&lt;";
+            size = 4;
             break;
         case '>':
-            writer.write("&gt;",4);
+            entity = "&gt;";
+            size = 4;
             break;
         case '"':
-            writer.write("&quot;",6);
+            entity = "&quot;";
+            size = 6;
             break;
         case '&':
-            writer.write("&amp;",5);
+            entity = "&amp;";
+            size = 5;
             break;
         default:
-            writer.write(&data[i],1);
-            break;
+            continue;
         }
+        // copy characters which need no quoting at once
+        writer.write(run, data - run);
+        writer.write(entity, size);
+        run = data + 1;
     }
+    writer.write(run, data - run);
 }
 
 };
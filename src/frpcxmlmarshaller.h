@@ -36,6 +36,7 @@
 
 #include <frpcmarshaller.h>
 #include <vector>
+#include <algorithm>
 #include <frpcwriter.h>
 #include <frpcinternals.h>
 #include <frpcint.h>
@@ -46,13 +47,17 @@
 namespace FRPC {
 
 /**
+Output goes through BufferedWriter_t; data not flushed are lost.
 @author Miroslav Talasek
 */
 class XmlMarshaller_t : public Marshaller_t
 {
 public:
+    /** @param compact omit line breaks (and indentation) between tags
+     */
     XmlMarshaller_t(Writer_t &writer,
-                    const ProtocolVersion_t &protocolVersion);
+                    const ProtocolVersion_t &protocolVersion,
+                    bool compact = false);
 
     virtual ~XmlMarshaller_t();
 
@@ -73,7 +78,7 @@ public:
     virtual void packStructMember(const char* memberName, unsigned int size);
     virtual void flush();
 
-    void packNull();
+    virtual void packNull();
 
     static void writeEncodeBase64(Writer_t &writer,
                                   const char *data, unsigned int len,
@@ -86,10 +91,24 @@ private:
     inline void packSpaces(unsigned int numSpaces)
     {
 #ifdef XML_HUMAN_FORMAT
-        for(unsigned int i=0; i< numSpaces; i++)
-            writer.write(" ",1);
+        if (compact) return;
+        while (numSpaces) {
+            unsigned int size = std::min(numSpaces,
+                                         unsigned(BufferedWriter_t::BLOCK_SIZE));
+            memset(writer.reserve(size), ' ', size);
+            writer.commit(size);
+            numSpaces -= size;
+        }
 #endif
     }
+    /** Write tag ending with line break; the break is left out in
+     *  compact mode.
+     */
+    inline void writeTag(const char *tag, unsigned int size)
+    {
+        writer.write(tag, size - compact);
+    }
+
     inline void decrementItem()
     {
         //is vaule any ittem or no ?
@@ -98,7 +117,7 @@ private:
             if(entityStorage.back().type == STRUCT)
             {
                packSpaces(level-1);
-               writer.write("</member>\n",10);
+               writeTag("</member>\n",10);
                level--;
             }
             //decrement item count
@@ -112,20 +131,20 @@ private:
                 switch(entityStorage.back().type)
                 {
                 case ARRAY:
-                    writer.write("</data>\n",8);
+                    writeTag("</data>\n",8);
                     level--;
                     packSpaces(level-1);
-                    writer.write("</array>\n",9);
+                    writeTag("</array>\n",9);
                     level--;
                     packSpaces(level-1);
-                    writer.write("</value>\n",9);
+                    writeTag("</value>\n",9);
                     break;
                 case STRUCT:
 
-                    writer.write("</struct>\n",10);
+                    writeTag("</struct>\n",10);
                     level--;
                     packSpaces(level-1);
-                    writer.write("</value>\n",9);
+                    writeTag("</value>\n",9);
                     break;
                 }
                 level--;
@@ -134,7 +153,7 @@ private:
                 if(entityStorage.empty())
                 {
                     packSpaces(level-1);
-                    writer.write("</param>\n",9);
+                    writeTag("</param>\n",9);
                     level--;
                 }
                 decrementItem();
@@ -143,7 +162,8 @@ private:
 
     }
     std::vector<TypeStorage_t> entityStorage;
-    Writer_t  &writer;
+    BufferedWriter_t writer;
+    bool compact;
     unsigned int level;
     char mainType;
     ProtocolVersion_t protocolVersion;
@@ -0,0 +1,337 @@
+/* Micro-benchmarks of marshallers, unmarshallers and Pool_t.
+ *
+ * Run by `make bench'. Every case runs until the minimal time elapses and
+ * reports time per operation, throughput (size of serialized data) and
+ * number of heap allocations (operator new) per operation. Datasets are
+ * fixed so results are comparable between releases.
+ *
+ * Usage: bench-marshallers [-t milliseconds] [substring of case name]
+ */
+
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <memory>
+#include <new>
+#include <time.h>
+
+#include "frpc.h"
+#include "frpcunmarshaller.h"
+#include "frpcmarshaller.h"
+#include "frpctreebuilder.h"
+#include "frpctreefeeder.h"
+#include "frpcwriter.h"
+
+#if __cplusplus >= 201103L
+#define BENCH_THROW_BAD_ALLOC
+#define BENCH_NOTHROW noexcept
+#else
+#define BENCH_THROW_BAD_ALLOC throw(std::bad_alloc)
+#define BENCH_NOTHROW throw()
+#endif
+
+// count heap allocations of the whole process
+static size_t allocations = 0;
+
+void* operator new(std::size_t size) BENCH_THROW_BAD_ALLOC {
+    ++allocations;
+    void *p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](std::size_t size) BENCH_THROW_BAD_ALLOC {
+    ++allocations;
+    void *p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) BENCH_NOTHROW {
+    std::free(p);
+}
+
+void operator delete[](void *p) BENCH_NOTHROW {
+    std::free(p);
+}
+
+namespace {
+
+uint64_t nowNs() {
+    struct timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return uint64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+class StrWriter_t : public FRPC::Writer_t {
+public:
+    StrWriter_t(std::string &target) : target(target) {}
+
+    virtual void write(const char *data, unsigned int size) {
+        target.append(data, size);
+    }
+
+    virtual void flush() {}
+
+private:
+    std::string &target;
+};
+
+/** One benchmarked operation.
+ */
+class Case_t {
+public:
+    Case_t(const std::string &name) : name(name) {}
+
+    virtual ~Case_t() {}
+
+    /** Run operation once, return number of processed bytes.
+     */
+    virtual size_t run() = 0;
+
+    std::string name;
+};
+
+/** Dataset: method call with parameters living in own pool.
+ */
+struct Dataset_t {
+    Dataset_t(const std::string &name) : name(name), params(pool.Array()) {}
+
+    std::string name;
+    FRPC::Pool_t pool;
+    FRPC::Array_t &params;
+};
+
+struct Protocol_t {
+    const char *name;
+    unsigned int marshaller;
+    int unmarshaller;               // -1 = no unmarshaller
+    FRPC::ProtocolVersion_t version;
+};
+
+void marshall(const Protocol_t &protocol, const Dataset_t &dataset,
+              std::string &out)
+{
+    out.clear();
+    StrWriter_t writer(out);
+    std::auto_ptr<FRPC::Marshaller_t> marshaller(
+            FRPC::Marshaller_t::create(protocol.marshaller, writer,
+                                       protocol.version));
+    FRPC::TreeFeeder_t feeder(*marshaller);
+    if (protocol.marshaller == FRPC::Marshaller_t::JSON) {
+        // JSON supports responses only
+        marshaller->packMethodResponse();
+        feeder.feedValue(dataset.params);
+        marshaller->flush();
+        return;
+    }
+    marshaller->packMethodCall("bench.call");
+    for (FRPC::Array_t::const_iterator iparams = dataset.params.begin(),
+             eparams = dataset.params.end(); iparams != eparams; ++iparams)
+    {
+        feeder.feedValue(**iparams);
+    }
+    marshaller->flush();
+}
+
+class MarshallCase_t : public Case_t {
+public:
+    MarshallCase_t(const Protocol_t &protocol, const Dataset_t &dataset)
+        : Case_t(std::string("marshall/") + protocol.name + "/"
+                 + dataset.name),
+          protocol(protocol), dataset(dataset)
+    {}
+
+    virtual size_t run() {
+        marshall(protocol, dataset, out);
+        return out.size();
+    }
+
+private:
+    const Protocol_t &protocol;
+    const Dataset_t &dataset;
+    std::string out;
+};
+
+class UnMarshallCase_t : public Case_t {
+public:
+    UnMarshallCase_t(const Protocol_t &protocol, const Dataset_t &dataset)
+        : Case_t(std::string("unmarshall/") + protocol.name + "/"
+                 + dataset.name),
+          protocol(protocol)
+    {
+        marshall(protocol, dataset, data);
+    }
+
+    virtual size_t run() {
+        FRPC::Pool_t pool;
+        FRPC::TreeBuilder_t builder(pool);
+        std::auto_ptr<FRPC::UnMarshaller_t> unmarshaller(
+                FRPC::UnMarshaller_t::create(protocol.unmarshaller, builder));
+        unmarshaller->unMarshall(data.data(), data.size(),
+                                 FRPC::UnMarshaller_t::TYPE_METHOD_CALL);
+        unmarshaller->finish();
+        return data.size();
+    }
+
+private:
+    const Protocol_t &protocol;
+    std::string data;
+};
+
+class PoolCase_t : public Case_t {
+public:
+    PoolCase_t() : Case_t("pool/1000-ints-strings") {}
+
+    virtual size_t run() {
+        static const std::string value("abcdefghijklmnop");
+        FRPC::Pool_t pool;
+        for (int i = 0; i < 500; ++i) {
+            pool.Int(i);
+            pool.String(value);
+        }
+        return 0;
+    }
+};
+
+class TreeBuilderCase_t : public Case_t {
+public:
+    TreeBuilderCase_t() : Case_t("treebuilder/construct") {}
+
+    virtual size_t run() {
+        FRPC::Pool_t pool;
+        FRPC::TreeBuilder_t builder(pool);
+        return 0;
+    }
+};
+
+void fillDatasets(std::vector<Dataset_t*> &datasets) {
+    Dataset_t *scalar = new Dataset_t("scalar");
+    FRPC::Pool_t &sp = scalar->pool;
+    scalar->params.append(sp.Int(42));
+    scalar->params.append(sp.String("hello world"));
+    scalar->params.append(sp.Bool(true));
+    scalar->params.append(sp.Double(3.141592653589793));
+    datasets.push_back(scalar);
+
+    Dataset_t *wide = new Dataset_t("wide-struct");
+    FRPC::Pool_t &wp = wide->pool;
+    FRPC::Struct_t &members = wp.Struct();
+    for (int i = 0; i < 1000; ++i) {
+        char name[32];
+        snprintf(name, sizeof(name), "member%04d", i);
+        if (i % 2) members.append(name, wp.Int(i * 7919));
+        else members.append(name, wp.String(name));
+    }
+    wide->params.append(members);
+    datasets.push_back(wide);
+
+    Dataset_t *deep = new Dataset_t("deep-nesting");
+    FRPC::Pool_t &dp = deep->pool;
+    FRPC::Value_t *inner = &dp.Int(0);
+    for (int i = 0; i < 100; ++i) {
+        if (i % 2) inner = &dp.Array(*inner);
+        else inner = &dp.Struct("level", *inner);
+    }
+    deep->params.append(*inner);
+    datasets.push_back(deep);
+
+    Dataset_t *binary = new Dataset_t("binary-1MiB");
+    std::string blob(1 << 20, '\0');
+    for (size_t i = 0; i < blob.size(); ++i)
+        blob[i] = char((i * 2654435761u) >> 24);
+    binary->params.append(binary->pool.Binary(blob));
+    datasets.push_back(binary);
+
+    Dataset_t *strings = new Dataset_t("string-array");
+    FRPC::Pool_t &ap = strings->pool;
+    FRPC::Array_t &array = ap.Array();
+    for (int i = 0; i < 10000; ++i) {
+        char value[40];
+        snprintf(value, sizeof(value), "string value number %010d", i);
+        array.append(ap.String(value));
+    }
+    strings->params.append(array);
+    datasets.push_back(strings);
+}
+
+void measure(Case_t &bench, uint64_t minTimeNs) {
+    // warm up (and find out the size of processed data)
+    size_t bytes = bench.run();
+
+    uint64_t iterations = 0;
+    size_t allocated = allocations;
+    uint64_t start = nowNs();
+    uint64_t elapsed = 0;
+    for (uint64_t batch = 1; elapsed < minTimeNs; batch *= 2) {
+        for (uint64_t i = 0; i < batch; ++i) bench.run();
+        iterations += batch;
+        elapsed = nowNs() - start;
+    }
+    allocated = allocations - allocated;
+
+    double nsPerOp = double(elapsed) / iterations;
+    printf("%-42s %12.1f ns/op", bench.name.c_str(), nsPerOp);
+    if (bytes) {
+        printf(" %10.1f MB/s", bytes * 1000.0 / nsPerOp);
+    } else {
+        printf(" %15s", "");
+    }
+    printf(" %10.1f allocs/op\n", double(allocated) / iterations);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    uint64_t minTimeNs = 200 * 1000000ull;
+    const char *filter = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "-t") && (i + 1 < argc)) {
+            minTimeNs = strtoull(argv[++i], 0, 10) * 1000000ull;
+        } else {
+            filter = argv[i];
+        }
+    }
+
+    const Protocol_t protocols[] = {
+        {"binary-1.0", FRPC::Marshaller_t::BINARY_RPC,
+         FRPC::UnMarshaller_t::BINARY_RPC, FRPC::ProtocolVersion_t(1, 0)},
+        {"binary-2.1", FRPC::Marshaller_t::BINARY_RPC,
+         FRPC::UnMarshaller_t::BINARY_RPC, FRPC::ProtocolVersion_t(2, 1)},
+        {"binary-3.0", FRPC::Marshaller_t::BINARY_RPC,
+         FRPC::UnMarshaller_t::BINARY_RPC, FRPC::ProtocolVersion_t(3, 0)},
+        {"xml", FRPC::Marshaller_t::XML_RPC,
+         FRPC::UnMarshaller_t::XML_RPC, FRPC::ProtocolVersion_t(2, 1)},
+        {"xml-compact", FRPC::Marshaller_t::XML_RPC_COMPACT,
+         FRPC::UnMarshaller_t::XML_RPC, FRPC::ProtocolVersion_t(2, 1)},
+        {"base64-3.0", FRPC::Marshaller_t::BASE64_RPC,
+         FRPC::UnMarshaller_t::BASE64, FRPC::ProtocolVersion_t(3, 0)},
+        {"json", FRPC::Marshaller_t::JSON, -1, FRPC::ProtocolVersion_t(2, 1)}
+    };
+    const size_t protocolCount = sizeof(protocols) / sizeof(*protocols);
+
+    std::vector<Dataset_t*> datasets;
+    fillDatasets(datasets);
+
+    std::vector<Case_t*> cases;
+    for (size_t p = 0; p < protocolCount; ++p) {
+        for (size_t d = 0; d < datasets.size(); ++d)
+            cases.push_back(new MarshallCase_t(protocols[p], *datasets[d]));
+        if (protocols[p].unmarshaller < 0) continue;
+        for (size_t d = 0; d < datasets.size(); ++d)
+            cases.push_back(new UnMarshallCase_t(protocols[p], *datasets[d]));
+    }
+    cases.push_back(new PoolCase_t());
+    cases.push_back(new TreeBuilderCase_t());
+
+    for (size_t i = 0; i < cases.size(); ++i) {
+        if (!filter || (cases[i]->name.find(filter) != std::string::npos))
+            measure(*cases[i], minTimeNs);
+        delete cases[i];
+    }
+
+    for (size_t d = 0; d < datasets.size(); ++d) delete datasets[d];
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,253 @@
+/* End-to-end load generator.
+ *
+ * Starts Server_t based server (Acceptor_t) on loopback or unix socket and
+ * drives it by ServerProxy_t clients running in own threads. Reports
+ * throughput and latency quantiles of whole calls as seen by the client.
+ *
+ * Usage: bench-server [options]
+ *   -c clients      number of client threads (default 4)
+ *   -s threads      number of server threads (default = clients)
+ *   -d seconds      duration of measurement (default 5)
+ *   -p xml|binary   protocol (default binary)
+ *   -n              no keep-alive (new connection per call)
+ *   -u              unix socket instead of TCP loopback
+ *   -l profile      payload: scalar, struct, large or mix (default mix)
+ *   -a url          drive already running server (echo method) instead
+ */
+
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "frpc.h"
+#include "frpcfault.h"
+#include "frpcserver.h"
+#include "frpcserverproxy.h"
+#include "frpclistener.h"
+#include "frpcmetrics.h"
+
+namespace {
+
+struct Options_t {
+    Options_t()
+        : clients(4), serverThreads(0), duration(5), binary(true),
+          keepAlive(true), unixSocket(false), profile("mix")
+    {}
+
+    unsigned int clients;
+    unsigned int serverThreads;
+    unsigned int duration;
+    bool binary;
+    bool keepAlive;
+    bool unixSocket;
+    std::string profile;
+    std::string url;
+};
+
+class Handler_t {
+public:
+    FRPC::Value_t& echo(FRPC::Pool_t &pool, FRPC::Array_t &params) {
+        return params;
+    }
+};
+
+class Factory_t : public FRPC::Acceptor_t::ServerFactory_t {
+public:
+    Factory_t() : config(10000, 10000, true, 1000000, false, 0) {}
+
+    virtual FRPC::Server_t* createServer() {
+        FRPC::Server_t *server = new FRPC::Server_t(config);
+        server->registry().registerMethod(
+                "echo", FRPC::boundMethod(&Handler_t::echo, handler));
+        return server;
+    }
+
+    FRPC::Server_t::Config_t config;
+    Handler_t handler;
+};
+
+/** Parameters of one request kind.
+ */
+enum Payload_t { SCALAR, STRUCT, LARGE };
+
+FRPC::Array_t& payload(FRPC::Pool_t &pool, Payload_t kind) {
+    switch (kind) {
+    case SCALAR:
+        return pool.Array(pool.Int(42), pool.String("hello world"));
+
+    case STRUCT:
+        {
+            FRPC::Struct_t &value = pool.Struct();
+            for (int i = 0; i < 50; ++i) {
+                char name[16];
+                snprintf(name, sizeof(name), "item%02d", i);
+                value.append(name, (i % 2) ? (FRPC::Value_t&)pool.Int(i)
+                             : (FRPC::Value_t&)pool.String(name));
+            }
+            return pool.Array(value);
+        }
+
+    case LARGE:
+    default:
+        return pool.Array(pool.Binary(std::string(64 * 1024, 'x')));
+    }
+}
+
+/** Request kind of n-th call for given profile; mix is 70% scalar,
+ *  25% struct and 5% large calls.
+ */
+Payload_t pick(const std::string &profile, unsigned int n) {
+    if (profile == "scalar") return SCALAR;
+    if (profile == "struct") return STRUCT;
+    if (profile == "large") return LARGE;
+    unsigned int slot = (n * 7) % 20;
+    if (slot < 14) return SCALAR;
+    if (slot < 19) return STRUCT;
+    return LARGE;
+}
+
+struct Shared_t {
+    Shared_t(const Options_t &options)
+        : options(options), measuring(false), stop(false)
+    {}
+
+    const Options_t &options;
+    volatile bool measuring;
+    volatile bool stop;
+    FRPC::Metrics_t::Histogram_t latency;
+    FRPC::Metrics_t::Counter_t errors;
+};
+
+void* client(void *arg) {
+    Shared_t &shared = *static_cast<Shared_t*>(arg);
+
+    FRPC::ServerProxy_t::Config_t config;
+    config.keepAlive = shared.options.keepAlive;
+    config.useBinary = shared.options.binary
+        ? FRPC::ServerProxy_t::Config_t::ALWAYS
+        : FRPC::ServerProxy_t::Config_t::NEVER;
+    FRPC::ServerProxy_t proxy(shared.options.url, config);
+
+    // pre-build parameters, measure calls only
+    FRPC::Pool_t pool;
+    FRPC::Array_t *params[3] = {
+        &payload(pool, SCALAR), &payload(pool, STRUCT), &payload(pool, LARGE)
+    };
+
+    for (unsigned int n = 0; !shared.stop; ++n) {
+        FRPC::Pool_t callPool;
+        bool measuring = shared.measuring;
+        uint64_t start = FRPC::Metrics_t::now();
+        try {
+            proxy.call(callPool, std::string("echo"),
+                       *params[pick(shared.options.profile, n)]);
+            if (measuring)
+                shared.latency.record(FRPC::Metrics_t::now() - start);
+        } catch (const FRPC::Fault_t &) {
+            if (measuring) shared.errors.add();
+        } catch (const FRPC::Error_t &) {
+            if (measuring) shared.errors.add();
+        }
+    }
+    return 0;
+}
+
+void usage(const char *name) {
+    fprintf(stderr, "Usage: %s [-c clients] [-s server-threads] "
+            "[-d seconds] [-p xml|binary] [-n] [-u] "
+            "[-l scalar|struct|large|mix] [-a url]\n", name);
+    exit(EXIT_FAILURE);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    Options_t options;
+    int opt;
+    while ((opt = getopt(argc, argv, "c:s:d:p:nul:a:h")) != -1) {
+        switch (opt) {
+        case 'c': options.clients = atoi(optarg); break;
+        case 's': options.serverThreads = atoi(optarg); break;
+        case 'd': options.duration = atoi(optarg); break;
+        case 'p':
+            if (!strcmp(optarg, "xml")) options.binary = false;
+            else if (!strcmp(optarg, "binary")) options.binary = true;
+            else usage(argv[0]);
+            break;
+        case 'n': options.keepAlive = false; break;
+        case 'u': options.unixSocket = true; break;
+        case 'l': options.profile = optarg; break;
+        case 'a': options.url = optarg; break;
+        default: usage(argv[0]);
+        }
+    }
+    if (!options.clients || !options.duration) usage(argv[0]);
+    if (!options.serverThreads) options.serverThreads = options.clients;
+
+    // start own server unless driving external one
+    Factory_t factory;
+    std::auto_ptr<FRPC::Acceptor_t> acceptor;
+    std::string socketPath;
+    if (options.url.empty()) {
+        if (options.unixSocket) {
+            char path[64];
+            snprintf(path, sizeof(path), "/tmp/frpc-load-%d.sock",
+                     int(getpid()));
+            socketPath = path;
+            options.url = std::string("unix://") + path;
+        } else {
+            options.url = "http://127.0.0.1:0/RPC2";
+        }
+        acceptor.reset(new FRPC::Acceptor_t(options.url, factory,
+                                            options.serverThreads, 1024));
+        if (!options.unixSocket) {
+            char url[64];
+            snprintf(url, sizeof(url), "http://127.0.0.1:%u/RPC2",
+                     acceptor->port());
+            options.url = url;
+        }
+        acceptor->start();
+    }
+
+    Shared_t shared(options);
+    std::vector<pthread_t> threads(options.clients);
+    for (unsigned int i = 0; i < options.clients; ++i)
+        pthread_create(&threads[i], 0, client, &shared);
+
+    // skip first second (connection setup, warm caches)
+    ::sleep(1);
+    shared.measuring = true;
+    uint64_t start = FRPC::Metrics_t::now();
+    ::sleep(options.duration);
+    shared.measuring = false;
+    uint64_t elapsed = FRPC::Metrics_t::now() - start;
+    uint64_t calls = shared.latency.getCount();
+    uint64_t errors = shared.errors.get();
+
+    shared.stop = true;
+    for (unsigned int i = 0; i < options.clients; ++i)
+        pthread_join(threads[i], 0);
+    if (acceptor.get()) acceptor->stop();
+    if (!socketPath.empty()) ::unlink(socketPath.c_str());
+
+    printf("url        %s\n", options.url.c_str());
+    printf("protocol   %s, %s, payload %s\n",
+           options.binary ? "binary" : "xml",
+           options.keepAlive ? "keep-alive" : "connection per call",
+           options.profile.c_str());
+    printf("clients    %u (server threads %u)\n",
+           options.clients, options.serverThreads);
+    printf("calls      %llu in %.2f s, %llu errors\n",
+           (unsigned long long)calls, elapsed / 1e6,
+           (unsigned long long)errors);
+    printf("qps        %.1f\n", calls * 1e6 / elapsed);
+    printf("latency    p50 %llu us, p99 %llu us, p999 %llu us\n",
+           (unsigned long long)shared.latency.quantile(0.5),
+           (unsigned long long)shared.latency.quantile(0.99),
+           (unsigned long long)shared.latency.quantile(0.999));
+    return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
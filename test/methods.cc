@@ -0,0 +1,128 @@
+#include <string>
+#include <vector>
+#include <iostream>
+#include <cstdlib>
+
+#include "frpc.h"
+#include "frpcfault.h"
+#include "frpcmethodregistry.h"
+#include "frpctypedmethod.h"
+
+size_t tests = 0;
+size_t fails = 0;
+
+bool expect(bool condition, const char *mark, const char *file, int line) {
+    ++tests;
+    if (!condition) {
+        fails++;
+        std::cerr << file << ":" << line
+                  << ":1: error: FAILED TEST: " << mark << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+#define TEST(condition) expect(condition, ""#condition"", __FILE__, __LINE__)
+
+class Handler_t {
+public:
+    std::string concat(long count, const std::string &str,
+                       const std::vector<double> &values)
+    {
+        std::string result;
+        for (long i = 0; i < count; ++i) result += str;
+        return result + (values.empty() ? "" : "!");
+    }
+
+    std::vector<long> range(int count) const {
+        std::vector<long> result;
+        for (int i = 0; i < count; ++i) result.push_back(i);
+        return result;
+    }
+
+    long size(const FRPC::Struct_t &s) {
+        return s.size();
+    }
+
+    bool ping() {
+        return true;
+    }
+};
+
+int callFault(FRPC::MethodRegistry_t &registry, const std::string &name,
+              FRPC::Array_t &params)
+{
+    FRPC::Pool_t pool;
+    try {
+        registry.processCall("127.0.0.1", name, params, pool);
+    } catch (const FRPC::Fault_t &fault) {
+        return fault.errorNum();
+    }
+    return 0;
+}
+
+void testTypedMethod() {
+    Handler_t handler;
+    FRPC::MethodRegistry_t registry(0, true);
+    registry.registerMethod(
+            "concat", FRPC::typedMethod(&Handler_t::concat, handler));
+    registry.registerMethod(
+            "range", FRPC::typedMethod(&Handler_t::range,
+                                       static_cast<const Handler_t&>(handler)));
+    registry.registerMethod(
+            "size", FRPC::typedMethod(&Handler_t::size, handler));
+    registry.registerMethod(
+            "ping", FRPC::typedMethod(&Handler_t::ping, handler), "Ping");
+
+    FRPC::Pool_t pool;
+
+    // generated signatures
+    FRPC::Array_t &sig = FRPC::Array(registry.processCall(
+            "127.0.0.1", "system.methodSignature",
+            pool.Array(pool.String("concat")), pool));
+    TEST(FRPC::String(FRPC::Array(sig[0])[0]).getValue() == "string");
+    TEST(FRPC::String(FRPC::Array(sig[0])[1]).getValue() == "int");
+    TEST(FRPC::String(FRPC::Array(sig[0])[2]).getValue() == "string");
+    TEST(FRPC::String(FRPC::Array(sig[0])[3]).getValue() == "array");
+
+    // calls
+    FRPC::Value_t &concat = registry.processCall(
+            "127.0.0.1", "concat",
+            pool.Array(pool.Int(3), pool.String("ab"),
+                       pool.Array(pool.Double(1.5))), pool);
+    TEST(FRPC::String(concat).getValue() == "ababab!");
+
+    FRPC::Array_t &range = FRPC::Array(registry.processCall(
+            "127.0.0.1", "range", pool.Array(pool.Int(3)), pool));
+    TEST(range.size() == 3);
+    TEST(FRPC::Int(range[2]).getValue() == 2);
+
+    TEST(FRPC::Int(registry.processCall(
+            "127.0.0.1", "size",
+            pool.Array(pool.Struct("a", pool.Int(1), "b", pool.Int(2))),
+            pool)).getValue() == 2);
+
+    TEST(FRPC::Bool(registry.processCall(
+            "127.0.0.1", "ping", pool.Array(), pool)).getValue());
+
+    // mismatches
+    TEST(callFault(registry, "concat", pool.Array(pool.Int(3)))
+         == FRPC::MethodRegistry_t::FRPC_TYPE_ERROR);
+    TEST(callFault(registry, "concat",
+                   pool.Array(pool.String("3"), pool.String("ab"),
+                              pool.Array()))
+         == FRPC::MethodRegistry_t::FRPC_TYPE_ERROR);
+    TEST(callFault(registry, "concat",
+                   pool.Array(pool.Int(3), pool.String("ab"),
+                              pool.Array(pool.Int(1))))
+         == FRPC::MethodRegistry_t::FRPC_TYPE_ERROR);
+    TEST(callFault(registry, "range",
+                   pool.Array(pool.Int(int64_t(1) << 40)))
+         == FRPC::MethodRegistry_t::FRPC_TYPE_ERROR);
+}
+
+int main(int argc, char *argv[]) {
+    testTypedMethod();
+    return fails ? EXIT_FAILURE : EXIT_SUCCESS;
+}
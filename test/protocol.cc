@@ -2,6 +2,12 @@
 #include <limits>
 #include <iostream>
 #include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <climits>
 
 #include "frpc.h"
 #include "frpcwriter.h"
@@ -10,10 +16,53 @@
 #include "frpcdatetime.h"
 #include "frpcpool.h"
 #include "frpcint.h"
+#include "frpcindexerror.h"
 #include "frpcbinmarshaller.h"
 #include "frpcbinunmarshaller.h"
 #include "frpctreefeeder.h"
 #include "frpctreebuilder.h"
+#include "frpcxmlmarshaller.h"
+#include "frpcxmlunmarshaller.h"
+#include "frpcstructtraits.h"
+#include "frpclimitedbuilder.h"
+#include "frpclimiterror.h"
+#include "frpcprojectionbuilder.h"
+#include "frpcconnector.h"
+#include "frpchttperror.h"
+#include "frpchttpclient.h"
+#include "frpccompression.h"
+#include "frpclocaltime.h"
+#include "frpcconfig.h"
+
+struct Point_t {
+    Point_t() : x(0), y(0), visible(false) {}
+
+    long x;
+    int y;
+    bool visible;
+    std::string label;
+    std::vector<double> weights;
+};
+
+struct Shape_t {
+    std::string name;
+    std::vector<Point_t> points;
+    std::map<std::string, long> tags;
+};
+
+FRPC_STRUCT_TRAITS_BEGIN(Point_t)
+    FRPC_STRUCT_FIELD(x)
+    FRPC_STRUCT_FIELD(y)
+    FRPC_STRUCT_FIELD(visible)
+    FRPC_STRUCT_FIELD_NAMED(label, "name")
+    FRPC_STRUCT_FIELD(weights)
+FRPC_STRUCT_TRAITS_END()
+
+FRPC_STRUCT_TRAITS_BEGIN(Shape_t)
+    FRPC_STRUCT_FIELD(name)
+    FRPC_STRUCT_FIELD(points)
+    FRPC_STRUCT_FIELD(tags)
+FRPC_STRUCT_TRAITS_END()
 
 size_t tests = 0;
 size_t fails = 0;
@@ -122,8 +171,618 @@ void testEncodeDecode(int major, int minor) {
     reviewValue(tb.getUnMarshaledData(), major, minor);
 }
 
+void testIntWidths(int major, int minor) {
+    // values at every width boundary
+    std::vector<FRPC::Int_t::value_type> values;
+    for (int bits = 0; bits < 63; bits += 4) {
+        FRPC::Int_t::value_type edge = FRPC::Int_t::value_type(1) << bits;
+        values.push_back(edge - 1);
+        values.push_back(edge);
+        values.push_back(-edge);
+        values.push_back(-edge - 1);
+    }
+    if (major < 2) {
+        // 31 bits only in protocol 1.0 (decoder does not sign-extend)
+        for (size_t i = 0; i < values.size(); ++i)
+            values[i] = values[i] & 0x7fffffff;
+    }
+
+    FRPC::Pool_t pool;
+    StringWriter_t sw;
+    FRPC::BinMarshaller_t bm(sw, FRPC::ProtocolVersion_t(major, minor));
+    bm.packMethodResponse();
+    bm.packArray(values.size());
+    for (size_t i = 0; i < values.size(); ++i) bm.packInt(values[i]);
+    bm.flush();
+
+    FRPC::TreeBuilder_t tb(pool);
+    FRPC::BinUnMarshaller_t bum(tb);
+    bum.unMarshall(sw.target.data(), sw.target.size(),
+                   FRPC::UnMarshaller_t::TYPE_METHOD_RESPONSE);
+    bum.finish();
+
+    FRPC::Array_t &out = FRPC::Array(tb.getUnMarshaledData());
+    TEST(out.size() == values.size());
+    bool same = (out.size() == values.size());
+    for (size_t i = 0; same && (i < values.size()); ++i)
+        same = (FRPC::Int(out[i]).getValue() == values[i]);
+    TEST(same);
+}
+
+void testArrayStorage() {
+    FRPC::Pool_t pool;
+    FRPC::Array_t &array = pool.Array();
+    TEST(array.empty());
+    TEST(array.capacity() == FRPC::Array_t::INLINE_SIZE);
+
+    // inline storage, then heap
+    for (int i = 0; i < 20; ++i) array.append(pool.Int(i));
+    TEST(array.size() == 20);
+    TEST(array.capacity() >= 20);
+    TEST(FRPC::Int(array[7]).getValue() == 7);
+    TEST(FRPC::Int(array[19]).getValue() == 19);
+    TEST(FRPC::Int(**(array.end() - 1)).getValue() == 19);
+
+    bool failed = false;
+    try {
+        array[20];
+    } catch (const FRPC::IndexError_t &) {
+        failed = true;
+    }
+    TEST(failed);
+
+    // exact reservation
+    FRPC::Array_t &reserved = pool.Array();
+    reserved.reserve(100);
+    TEST(reserved.capacity() == 100);
+
+    FRPC::Array_t &copy = FRPC::Array(array.clone(pool));
+    TEST(copy.size() == 20);
+    TEST(FRPC::Int(copy[13]).getValue() == 13);
+
+    array.clear();
+    TEST(array.empty());
+}
+
+void testSharedValues() {
+    FRPC::LibConfig_t *config = FRPC::LibConfig_t::getInstance();
+    config->setSharedValuesPolicy(true, -1, 100);
+
+    {
+        FRPC::Pool_t pool;
+        FRPC::Pool_t other;
+        TEST(&pool.Int(7) == &other.Int(7));
+        TEST(pool.Int(7).getValue() == 7);
+        TEST(&pool.Int(-1) == &other.Int(-1));
+        TEST(&pool.Int(101) != &other.Int(101));
+        TEST(&pool.Bool(true) == &other.Bool(true));
+        TEST(!pool.Bool(false).getValue());
+        // shared values are not owned by pools
+        TEST(pool.pointerStorage.size() == 1);
+
+        // decoded tree uses them too
+        StringWriter_t sw;
+        FRPC::BinMarshaller_t bm(sw, FRPC::ProtocolVersion_t(2, 1));
+        bm.packMethodResponse();
+        bm.packArray(2);
+        bm.packInt(42);
+        bm.packBool(true);
+        bm.flush();
+        FRPC::TreeBuilder_t tb(pool);
+        FRPC::BinUnMarshaller_t bum(tb);
+        bum.unMarshall(sw.target.data(), sw.target.size(),
+                       FRPC::UnMarshaller_t::TYPE_METHOD_RESPONSE);
+        bum.finish();
+        FRPC::Array_t &out = FRPC::Array(tb.getUnMarshaledData());
+        TEST(&out[0] == &other.Int(42));
+        TEST(&out[1] == &other.Bool(true));
+    }
+
+    // range must stay small, it is allocated up front
+    bool rejected = false;
+    try {
+        config->setSharedValuesPolicy(true, LONG_MIN, LONG_MAX);
+    } catch (const std::invalid_argument &) {
+        rejected = true;
+    }
+    TEST(rejected);
+    TEST(config->getSharedIntMax() == 100);
+
+    config->setSharedValuesPolicy(false);
+    FRPC::Pool_t pool;
+    TEST(&pool.Int(7) != &pool.Int(7));
+}
+
+void testBufferedWriter() {
+    StringWriter_t sw;
+    FRPC::BufferedWriter_t bw(sw);
+    bw.write("abc", 3);
+    char *out = bw.reserve(2);
+    out[0] = 'd';
+    out[1] = 'e';
+    bw.commit(2);
+    TEST(sw.target.empty());
+
+    // larger than block goes directly after buffered data
+    std::string large(FRPC::BufferedWriter_t::BLOCK_SIZE + 1, 'x');
+    bw.write(large.data(), large.size());
+    TEST(sw.target == "abcde" + large);
+
+    bw.write("f", 1);
+    bw.flush();
+    TEST(sw.target == "abcde" + large + "f");
+}
+
+Shape_t makeTestShape() {
+    Shape_t shape;
+    shape.name = "triangle";
+    for (int i = 0; i < 3; ++i) {
+        Point_t point;
+        point.x = -i * 1000000;
+        point.y = i;
+        point.visible = i % 2;
+        point.label = std::string(i + 1, 'p');
+        point.weights.push_back(i / 2.0);
+        shape.points.push_back(point);
+    }
+    shape.tags["sides"] = 3;
+    return shape;
+}
+
+void reviewShape(const Shape_t &shape) {
+    TEST(shape.name == "triangle");
+    TEST(shape.points.size() == 3);
+    if (shape.points.size() != 3) return;
+    TEST(shape.points[2].x == -2000000);
+    TEST(shape.points[2].y == 2);
+    TEST(shape.points[1].visible);
+    TEST(shape.points[2].label == "ppp");
+    TEST(shape.points[2].weights.size() == 1);
+    TEST(shape.points[1].weights[0] == 0.5);
+    TEST(shape.tags.size() == 1);
+    TEST(shape.tags.find("sides") != shape.tags.end()
+         && shape.tags.find("sides")->second == 3);
+}
+
+void testTypedStruct(int major, int minor) {
+    StringWriter_t sw;
+    FRPC::ProtocolVersion_t pv(major, minor);
+    FRPC::BinMarshaller_t bm(sw, pv);
+    bm.packMethodResponse();
+    FRPC::ValueTraits_t<Shape_t>::pack(bm, makeTestShape());
+    bm.flush();
+
+    // decoding directly into the structure
+    Shape_t shape;
+    FRPC::TypedBuilder_t tb(shape);
+    FRPC::BinUnMarshaller_t bum(tb);
+    bum.unMarshall(sw.target.data(), sw.target.size(),
+                   FRPC::UnMarshaller_t::TYPE_METHOD_RESPONSE);
+    bum.finish();
+    reviewShape(shape);
+
+    // must be the same as the tree
+    FRPC::Pool_t pool;
+    FRPC::TreeBuilder_t treeBuilder(pool);
+    FRPC::BinUnMarshaller_t treeUnMarshaller(treeBuilder);
+    treeUnMarshaller.unMarshall(sw.target.data(), sw.target.size(),
+                                FRPC::UnMarshaller_t::TYPE_METHOD_RESPONSE);
+    treeUnMarshaller.finish();
+    reviewShape(FRPC::ValueTraits_t<Shape_t>::get(
+            treeBuilder.getUnMarshaledData(), 0));
+}
+
+void testTypedStructXml() {
+    StringWriter_t sw;
+    FRPC::XmlMarshaller_t xm(sw, FRPC::ProtocolVersion_t());
+    xm.packMethodResponse();
+    FRPC::ValueTraits_t<Shape_t>::pack(xm, makeTestShape());
+    xm.flush();
+
+    Shape_t shape;
+    FRPC::TypedBuilder_t tb(shape);
+    FRPC::XmlUnMarshaller_t xum(tb);
+    xum.unMarshall(sw.target.data(), sw.target.size(),
+                   FRPC::UnMarshaller_t::TYPE_METHOD_RESPONSE);
+    xum.finish();
+    reviewShape(shape);
+
+    // type mismatch
+    std::vector<std::string> strings;
+    FRPC::TypedBuilder_t mismatch(strings);
+    bool failed = false;
+    try {
+        mismatch.openArray(1);
+        mismatch.buildInt(1);
+    } catch (const FRPC::TypeError_t &) {
+        failed = true;
+    }
+    TEST(failed);
+
+    // unknown members are skipped including their nested values
+    Point_t point;
+    FRPC::TypedBuilder_t skipping(point);
+    skipping.openStruct(3);
+    skipping.buildStructMember("extra", 5);
+    skipping.openArray(1);
+    skipping.openStruct(1);
+    skipping.buildStructMember("deep", 4);
+    skipping.buildInt(1);
+    skipping.closeStruct();
+    skipping.closeArray();
+    skipping.buildStructMember("x", 1);
+    skipping.buildInt(7);
+    skipping.buildStructMember("name", 4);
+    skipping.buildString("label", 5);
+    skipping.closeStruct();
+    TEST(point.x == 7);
+    TEST(point.label == "label");
+}
+
+void testCompactXml() {
+    FRPC::Pool_t pool;
+    std::string output[2];
+    for (int compact = 0; compact < 2; ++compact) {
+        StringWriter_t sw;
+        FRPC::XmlMarshaller_t xm(sw, FRPC::ProtocolVersion_t(2, 1), compact);
+        xm.packMethodResponse();
+        FRPC::TreeFeeder_t feeder(xm);
+        feeder.feedValue(pool.Array(makeTestValue(pool),
+                                    pool.Binary(std::string(100, 'b'))));
+        xm.flush();
+        output[compact] = sw.target;
+
+        FRPC::Pool_t outPool;
+        FRPC::TreeBuilder_t tb(outPool);
+        FRPC::XmlUnMarshaller_t xum(tb);
+        xum.unMarshall(sw.target.data(), sw.target.size(),
+                       FRPC::UnMarshaller_t::TYPE_METHOD_RESPONSE);
+        xum.finish();
+        FRPC::Array_t &out = FRPC::Array(tb.getUnMarshaledData());
+        TEST(out.size() == 2);
+        TEST(FRPC::Binary(out[1]).getString() == std::string(100, 'b'));
+    }
+
+    // line breaks are left in the header only
+    std::string body(output[1].substr(output[1].find("<methodResponse>")));
+    TEST(body.find('\n') == std::string::npos);
+    TEST(output[1].size() < output[0].size());
+}
+
+bool limitExceeded(const std::string &data,
+                   const FRPC::LimitedBuilder_t::Limits_t &limits)
+{
+    FRPC::Pool_t pool;
+    FRPC::TreeBuilder_t tb(pool);
+    FRPC::LimitedBuilder_t lb(tb, limits);
+    FRPC::BinUnMarshaller_t bum(lb);
+    try {
+        bum.unMarshall(data.data(), data.size(),
+                       FRPC::UnMarshaller_t::TYPE_METHOD_RESPONSE);
+        bum.finish();
+    } catch (const FRPC::LimitError_t &) {
+        return true;
+    }
+    return false;
+}
+
+void testLimits() {
+    FRPC::Pool_t pool;
+    StringWriter_t sw;
+    FRPC::BinMarshaller_t bm(sw, FRPC::ProtocolVersion_t(2, 1));
+    bm.packMethodResponse();
+    FRPC::TreeFeeder_t feeder(bm);
+    // depth 3, 15 elements
+    feeder.feedValue(
+            pool.Array(makeTestValue(pool),
+                       pool.Struct("a", pool.Array(pool.String("x")))));
+    bm.flush();
+
+    typedef FRPC::LimitedBuilder_t::Limits_t Limits_t;
+    TEST(!limitExceeded(sw.target, Limits_t()));
+    TEST(!limitExceeded(sw.target, Limits_t(3, 15, 1 << 20)));
+    TEST(limitExceeded(sw.target, Limits_t(2, 0, 0)));
+    TEST(limitExceeded(sw.target, Limits_t(0, 14, 0)));
+    TEST(limitExceeded(sw.target, Limits_t(0, 0, 64)));
+
+    // huge declared array is refused before items arrive
+    StringWriter_t huge;
+    FRPC::BinMarshaller_t hm(huge, FRPC::ProtocolVersion_t(2, 1));
+    hm.packMethodResponse();
+    hm.packArray(1 << 30);
+    hm.flush();
+    TEST(limitExceeded(huge.target, Limits_t(0, 1000, 0)));
+}
+
+void testProjection() {
+    FRPC::Pool_t pool;
+    FRPC::Array_t &items = pool.Array();
+    for (int i = 0; i < 3; ++i) {
+        items.append(pool.Struct("id", pool.Int(i),
+                                 "title", pool.String("title"),
+                                 "tags", pool.Array(pool.String("x"),
+                                                    pool.Null())));
+    }
+    FRPC::Struct_t &response = pool.Struct(
+            "result", pool.Struct("items", items, "total", pool.Int(3)),
+            "status", pool.Int(200),
+            "message", pool.Struct("text", pool.String("ok")));
+
+    for (int xml = 0; xml < 2; ++xml) {
+        StringWriter_t sw;
+        std::auto_ptr<FRPC::Marshaller_t> marshaller(
+                FRPC::Marshaller_t::create(
+                        xml ? FRPC::Marshaller_t::XML_RPC
+                            : FRPC::Marshaller_t::BINARY_RPC,
+                        sw, FRPC::ProtocolVersion_t(2, 1)));
+        marshaller->packMethodResponse();
+        FRPC::TreeFeeder_t(*marshaller).feedValue(response);
+        marshaller->flush();
+
+        FRPC::Pool_t out;
+        FRPC::TreeBuilder_t tb(out);
+        FRPC::ProjectionBuilder_t pb(tb, "result.items[].id,status");
+        std::auto_ptr<FRPC::UnMarshaller_t> um(
+                FRPC::UnMarshaller_t::create(
+                        xml ? FRPC::UnMarshaller_t::XML_RPC
+                            : FRPC::UnMarshaller_t::BINARY_RPC, pb));
+        um->unMarshall(sw.target.data(), sw.target.size(),
+                       FRPC::UnMarshaller_t::TYPE_METHOD_RESPONSE);
+        um->finish();
+
+        FRPC::Struct_t &value = FRPC::Struct(tb.getUnMarshaledData());
+        TEST(value.size() == 2);
+        TEST(FRPC::Int(value["status"]) == 200);
+        FRPC::Struct_t &result = FRPC::Struct(value["result"]);
+        TEST(result.size() == 1);
+        FRPC::Array_t &ids = FRPC::Array(result["items"]);
+        TEST(ids.size() == 3);
+        for (int i = 0; i < 3; ++i) {
+            TEST(FRPC::Struct(ids[i]).size() == 1);
+            TEST(FRPC::Int(FRPC::Struct(ids[i])["id"]) == i);
+        }
+
+        // selected container comes whole, array not selected by [] empty
+        FRPC::Pool_t whole;
+        FRPC::TreeBuilder_t wtb(whole);
+        FRPC::ProjectionBuilder_t wpb(wtb);
+        wpb.select("result.items").select("message.text.x");
+        std::auto_ptr<FRPC::UnMarshaller_t> wum(
+                FRPC::UnMarshaller_t::create(
+                        xml ? FRPC::UnMarshaller_t::XML_RPC
+                            : FRPC::UnMarshaller_t::BINARY_RPC, wpb));
+        wum->unMarshall(sw.target.data(), sw.target.size(),
+                        FRPC::UnMarshaller_t::TYPE_METHOD_RESPONSE);
+        wum->finish();
+        FRPC::Struct_t &wvalue = FRPC::Struct(wtb.getUnMarshaledData());
+        FRPC::Array_t &witems = FRPC::Array(
+                FRPC::Struct(wvalue["result"])["items"]);
+        TEST(witems.size() == 3);
+        TEST(FRPC::Array(FRPC::Struct(witems[2])["tags"]).size() == 2);
+        TEST(FRPC::String(FRPC::Struct(wvalue["message"])["text"])
+             .getString() == "ok");
+    }
+
+    bool invalid = false;
+    try {
+        FRPC::Pool_t out;
+        FRPC::TreeBuilder_t tb(out);
+        FRPC::ProjectionBuilder_t pb(tb, "result..id");
+    } catch (const FRPC::Error_t &) {
+        invalid = true;
+    }
+    TEST(invalid);
+}
+
+void testRacingConnector() {
+    // listen on loopback only, the name may resolve to more addresses
+    int server = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    TEST(::bind(server, (sockaddr*)&addr, sizeof(addr)) == 0);
+    TEST(::listen(server, 8) == 0);
+    TEST(::getsockname(server, (sockaddr*)&addr, &len) == 0);
+
+    char url[64];
+    snprintf(url, sizeof(url), "http://localhost:%d/RPC2",
+             ntohs(addr.sin_port));
+    FRPC::RacingConnector_t connector(FRPC::URL_t(url, ""), 1000, false, 50);
+
+    for (int i = 0; i < 2; ++i) {
+        int fd = -1;
+        connector.connectSocket(fd);
+        TEST(fd > -1);
+        ::close(fd);
+    }
+    ::close(server);
+
+    // nobody listens now
+    bool failed = false;
+    try {
+        int fd = -1;
+        connector.connectSocket(fd);
+    } catch (const FRPC::HTTPError_t &) {
+        failed = true;
+    }
+    TEST(failed);
+}
+
+void testCompression() {
+    typedef FRPC::Compression_t Compression_t;
+    TEST(Compression_t::negotiate("gzip, deflate") == Compression_t::GZIP);
+    TEST(Compression_t::negotiate("deflate, gzip;q=0") == Compression_t::DEFLATE);
+    TEST(Compression_t::negotiate("identity") == Compression_t::NONE);
+    TEST(Compression_t::negotiate("") == Compression_t::NONE);
+
+    const Compression_t::Type_t types[] = {
+        Compression_t::GZIP, Compression_t::DEFLATE
+    };
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); ++i) {
+        FRPC::Pool_t pool;
+        FRPC::Array_t &arr = pool.Array();
+        for (int j = 0; j < 1000; ++j)
+            arr.append(pool.String("repeated payload"));
+
+        StringWriter_t sw;
+        FRPC::CompressingWriter_t cw(sw);
+        cw.reset(types[i], 1024);
+        FRPC::XmlMarshaller_t xm(cw, FRPC::ProtocolVersion_t(2, 1));
+        xm.packMethodResponse();
+        FRPC::TreeFeeder_t(xm).feedValue(arr);
+        xm.flush();
+        TEST(cw.encoding() == types[i]);
+        TEST(sw.target.size() < 1000);
+
+        // decode in small pieces like from the socket
+        FRPC::Pool_t outPool;
+        FRPC::TreeBuilder_t builder(outPool);
+        FRPC::XmlUnMarshaller_t um(builder);
+        FRPC::DataSink_t sink(um);
+        sink.setContentEncoding(types[i]);
+        for (size_t pos = 0; pos < sw.target.size(); pos += 7) {
+            size_t len = std::min<size_t>(7, sw.target.size() - pos);
+            sink.write(sw.target.data() + pos, len);
+        }
+        um.finish();
+        FRPC::Array_t &out = FRPC::Array(builder.getUnMarshaledData());
+        TEST(out.size() == 1000);
+        TEST(FRPC::String(out[999]).getString() == "repeated payload");
+
+        // too large decompressed body
+        FRPC::Pool_t limitPool;
+        FRPC::TreeBuilder_t limitBuilder(limitPool);
+        FRPC::XmlUnMarshaller_t limitUm(limitBuilder);
+        FRPC::DataSink_t limitSink(limitUm);
+        limitSink.setContentEncoding(types[i], 4096);
+        bool failed = false;
+        try {
+            limitSink.write(sw.target.data(), sw.target.size());
+        } catch (const FRPC::ProtocolError_t &e) {
+            failed = (e.errorNum() == FRPC::HTTP_BODY_TOO_LONG);
+        }
+        TEST(failed);
+    }
+
+    // small payload stays uncompressed
+    StringWriter_t sw;
+    FRPC::CompressingWriter_t cw(sw);
+    cw.reset(Compression_t::GZIP, 1024);
+    cw.write("short", 5);
+    cw.flush();
+    TEST(cw.encoding() == Compression_t::NONE);
+    TEST(sw.target == "short");
+}
+
+void testLocalTime() {
+    TEST(FRPC::daysFromCivil(1970, 1, 1) == 0);
+    TEST(FRPC::daysFromCivil(2000, 3, 1) == 11017);
+    TEST(FRPC::daysFromCivil(1969, 12, 31) == -1);
+    TEST(FRPC::daysFromCivil(2020, 13, 1) == FRPC::daysFromCivil(2021, 1, 1));
+    TEST(FRPC::daysFromCivil(2021, 2, 29) == FRPC::daysFromCivil(2021, 3, 1));
+    TEST(FRPC::weekDayFromDays(0) == 4);
+    TEST(FRPC::weekDayFromDays(-1) == 3);
+
+    bool civilOk = true;
+    for (int64_t days = -800000; days < 800000; days += 97) {
+        int64_t year;
+        int month, day;
+        FRPC::civilFromDays(days, year, month, day);
+        civilOk = civilOk && (FRPC::daysFromCivil(year, month, day) == days);
+    }
+    TEST(civilOk);
+
+    // compare with libc in zone with daylight saving time
+    setenv("TZ", "CET-1CEST,M3.5.0,M10.5.0/3", 1);
+    tzset();
+    FRPC::LocalZone_t::reset();
+    bool toLocalOk = true;
+    bool fromLocalOk = true;
+    // recent years and years before the epoch
+    const time_t starts[] = { 1600000000, -300000000 };
+    for (unsigned int range = 0; range < 2; ++range) {
+        time_t begin = starts[range];
+        for (time_t t = begin; t < begin + 100000000; t += 7919) {
+            struct tm expected;
+            struct tm local;
+            localtime_r(&t, &expected);
+            int offset = FRPC::LocalZone_t::toLocal(t, local);
+            toLocalOk = toLocalOk
+                && (local.tm_year == expected.tm_year)
+                && (local.tm_mon == expected.tm_mon)
+                && (local.tm_mday == expected.tm_mday)
+                && (local.tm_hour == expected.tm_hour)
+                && (local.tm_min == expected.tm_min)
+                && (local.tm_sec == expected.tm_sec)
+                && (local.tm_wday == expected.tm_wday)
+                && (local.tm_yday == expected.tm_yday)
+                && ((local.tm_isdst > 0) == (expected.tm_isdst > 0))
+                && (offset == (expected.tm_isdst > 0 ? 7200 : 3600));
+
+            // ambiguous hour (end of DST) may legally differ
+            struct tm guess = expected;
+            guess.tm_isdst = -1;
+            if (mktime(&guess) == t) {
+                fromLocalOk = fromLocalOk
+                    && (FRPC::LocalZone_t::fromLocal(
+                                expected.tm_year + 1900, expected.tm_mon + 1,
+                                expected.tm_mday, expected.tm_hour,
+                                expected.tm_min, expected.tm_sec) == t);
+            }
+        }
+    }
+    TEST(toLocalOk);
+    TEST(fromLocalOk);
+
+    FRPC::Pool_t pool;
+    FRPC::DateTime_t &summer = pool.LocalTime(2021, 7, 1, 12, 0, 0);
+    TEST(summer.getUnixTime() == 1625133600);
+    TEST(summer.getTimeZone() == -7200);
+    TEST(summer.getDayOfWeek() == 4);
+    TEST(summer.isSaveLightDay());
+
+    char buffer[FRPC::ISO_DATETIME_SIZE];
+    TEST(FRPC::formatISODateTime(buffer, 2021, 7, 1, 9, 5, 3, -7200) == 22);
+    TEST(std::string(buffer) == "20210701T09:05:03+0200");
+    TEST(FRPC::getISODateTime(1999, 12, 31, 23, 59, 59, 19800)
+         == "19991231T23:59:59-0530");
+
+    short year;
+    char month, day, hour, minute, sec;
+    int timeZone;
+    FRPC::parseISODateTime(buffer, strlen(buffer), year, month, day, hour,
+                           minute, sec, timeZone);
+    TEST(year == 2021 && month == 7 && day == 1);
+    TEST(hour == 9 && minute == 5 && sec == 3);
+    TEST(timeZone == -7200);
+    FRPC::parseISODateTime(" 2021-07-01T09:05:03.25Z ", 25, year, month, day,
+                           hour, minute, sec, timeZone);
+    TEST(year == 2021 && sec == 3 && timeZone == 0);
+
+    unsetenv("TZ");
+    tzset();
+    FRPC::LocalZone_t::reset();
+}
+
 int main(int argc, char *argv[]) {
     testEncodeDecode(2, 1);
     testEncodeDecode(3, 1);
+    testArrayStorage();
+    testSharedValues();
+    testBufferedWriter();
+    testIntWidths(1, 0);
+    testIntWidths(2, 1);
+    testIntWidths(3, 0);
+    testTypedStruct(2, 1);
+    testTypedStruct(3, 1);
+    testTypedStructXml();
+    testCompactXml();
+    testLimits();
+    testProjection();
+    testRacingConnector();
+    testCompression();
+    testLocalTime();
     return fails ? EXIT_FAILURE : EXIT_SUCCESS;
 }
@@ -0,0 +1,998 @@
+#include <string>
+#include <vector>
+#include <iostream>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+
+#include "frpc.h"
+#include "frpcfault.h"
+#include "frpcserver.h"
+#include "frpcserverproxy.h"
+#include "frpclistener.h"
+#include "frpcconnector.h"
+#include "frpcmetrics.h"
+#include "frpcphasetimes.h"
+#include "frpcstreammethod.h"
+#include "frpcprotocolerror.h"
+#include "frpcbalancingproxy.h"
+#include "frpcdeadline.h"
+#include "frpcadmission.h"
+#include "frpcsingleflight.h"
+#include "frpcresponsecache.h"
+
+size_t tests = 0;
+size_t fails = 0;
+
+bool expect(bool condition, const char *mark, const char *file, int line) {
+    ++tests;
+    if (!condition) {
+        fails++;
+        std::cerr << file << ":" << line
+                  << ":1: error: FAILED TEST: " << mark << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+#define TEST(condition) expect(condition, ""#condition"", __FILE__, __LINE__)
+
+class Handler_t {
+public:
+    Handler_t() : sleepCalls(0), slowCalls(0) {}
+
+    FRPC::Value_t& echo(FRPC::Pool_t &pool, FRPC::Array_t &params) {
+        return params;
+    }
+
+    FRPC::Value_t& sleep(FRPC::Pool_t &pool, FRPC::Array_t &params) {
+        __sync_fetch_and_add(&sleepCalls, 1);
+        ::usleep(FRPC::Int(params[0]));
+        return params;
+    }
+
+    int sleepCalls;
+
+    /** First call sleeps given number of microseconds, others don't.
+     */
+    FRPC::Value_t& slowOnce(FRPC::Pool_t &pool, FRPC::Array_t &params) {
+        if (!__sync_fetch_and_add(&slowCalls, 1))
+            ::usleep(FRPC::Int(params[0]));
+        return params;
+    }
+
+    int slowCalls;
+
+    /** Remaining time of request deadline in milliseconds (-1 = none).
+     */
+    FRPC::Value_t& budget(FRPC::Pool_t &pool, FRPC::Array_t &params) {
+        return pool.Int(FRPC::Deadline_t::remaining());
+    }
+
+    /** Calls budget on server at given URL, passing own deadline on.
+     */
+    FRPC::Value_t& relay(FRPC::Pool_t &pool, FRPC::Array_t &params) {
+        FRPC::ServerProxy_t proxy(FRPC::String(params[0]).getString(),
+                                  FRPC::ServerProxy_t::Config_t());
+        return proxy.call(pool, "budget", (FRPC::Value_t*)0);
+    }
+
+    /** Streams strings "0".."n-1"; negative n faults before opening, items
+     *  beyond second param fail the stream after opening.
+     */
+    void range(FRPC::Array_t &params, FRPC::ResponseStream_t &response) {
+        long n = FRPC::Int(params[0]);
+        long failAt = (params.size() > 1) ? long(FRPC::Int(params[1])) : n;
+        if (n < 0) throw FRPC::Fault_t(-1, "negative count");
+
+        response.open(n);
+        for (long i = 0; i < n; ++i) {
+            if (i == failAt) throw std::runtime_error("broken source");
+            char item[32];
+            snprintf(item, sizeof(item), "%ld", i);
+            response.push(response.pool().String(item));
+        }
+    }
+};
+
+class Callbacks_t : public FRPC::MethodRegistry_t::Callbacks_t {
+public:
+    Callbacks_t() : requests(0) {}
+
+    virtual void preRead() {}
+    virtual void preProcess(const std::string &, const std::string &,
+                            FRPC::Array_t &) {}
+    virtual void postProcess(const std::string &, const std::string &,
+                             const FRPC::Array_t &, const FRPC::Value_t &,
+                             const FRPC::MethodRegistry_t::TimeDiff_t &) {}
+    virtual void postProcess(const std::string &, const std::string &,
+                             const FRPC::Array_t &, const FRPC::Fault_t &,
+                             const FRPC::MethodRegistry_t::TimeDiff_t &) {}
+
+    virtual void postRequest(const std::string &methodName,
+                             const std::string &clientIP,
+                             const FRPC::PhaseTimes_t &phases)
+    {
+        ++requests;
+        lastMethod = methodName;
+        last = phases;
+    }
+
+    int requests;
+    std::string lastMethod;
+    FRPC::PhaseTimes_t last;
+};
+
+class Factory_t : public FRPC::Acceptor_t::ServerFactory_t {
+public:
+    Factory_t() : config(1000, 1000, true, 100, true, 0) {}
+
+    virtual FRPC::Server_t* createServer() {
+        FRPC::Server_t *server = new FRPC::Server_t(config);
+        server->registry().registerMethod(
+                "echo", FRPC::boundMethod(&Handler_t::echo, handler), "A:*",
+                "Echo params.");
+        server->registry().registerMethod(
+                "sleep", FRPC::boundMethod(&Handler_t::sleep, handler), "A:i",
+                "Sleep given number of microseconds.");
+        server->registry().registerMethod(
+                "slowOnce", FRPC::boundMethod(&Handler_t::slowOnce, handler),
+                "A:i", "Sleep given number of microseconds in first call.");
+        server->registry().registerMethod(
+                "budget", FRPC::boundMethod(&Handler_t::budget, handler),
+                "i:", "Remaining time of request deadline.");
+        server->registry().registerMethod(
+                "relay", FRPC::boundMethod(&Handler_t::relay, handler),
+                "i:s", "Call budget on server at given URL.");
+        server->registry().registerMethod(
+                "range", FRPC::boundStreamMethod(&Handler_t::range, handler),
+                "A:i,A:ii", "Stream strings of numbers below given count.");
+        return server;
+    }
+
+    FRPC::Server_t::Config_t config;
+    Handler_t handler;
+};
+
+bool callEcho(const std::string &url, bool keepAlive) {
+    FRPC::ServerProxy_t::Config_t config;
+    config.keepAlive = keepAlive;
+    FRPC::ServerProxy_t proxy(url, config);
+
+    for (int i = 0; i < 3; ++i) {
+        FRPC::Pool_t pool;
+        FRPC::Array_t &result = FRPC::Array(
+                proxy.call(pool, "echo", &pool.Int(i), (FRPC::Value_t*)0));
+        if ((result.size() != 1) || (FRPC::Int(result[0]) != i))
+            return false;
+    }
+    return true;
+}
+
+/** Send raw XML-RPC call over open connection, return whole response.
+ */
+std::string rawCall(int fd, const std::string &methodName) {
+    std::string body = "<?xml version=\"1.0\"?><methodCall><methodName>"
+        + methodName + "</methodName><params><param><value><i4>1</i4>"
+        "</value></param></params></methodCall>";
+    char length[32];
+    snprintf(length, sizeof(length), "%u", unsigned(body.size()));
+    std::string request = "POST /RPC2 HTTP/1.1\r\nHost: localhost\r\n"
+        "Content-Type: text/xml\r\nContent-Length: " + std::string(length)
+        + "\r\n\r\n" + body;
+    if (::write(fd, request.data(), request.size()) != ssize_t(request.size()))
+        return std::string();
+
+    std::string response;
+    std::string::size_type end = std::string::npos;
+    size_t expected = 0;
+    char buffer[4096];
+    while ((end == std::string::npos) || (response.size() < expected)) {
+        ssize_t size = ::read(fd, buffer, sizeof(buffer));
+        if (size <= 0) break;
+        response.append(buffer, size);
+        if (end != std::string::npos) continue;
+        end = response.find("\r\n\r\n");
+        if (end == std::string::npos) continue;
+        std::string::size_type pos = response.find("Content-Length: ");
+        expected = end + 4;
+        if (pos < end) expected += atoi(response.c_str() + pos + 16);
+    }
+    return response;
+}
+
+void testPeerAddress() {
+    FRPC::Listener_t listener("http://127.0.0.1:0/");
+    TEST(listener.port() != 0);
+
+    char url[64];
+    snprintf(url, sizeof(url), "http://127.0.0.1:%u/", listener.port());
+    FRPC::SimpleConnectorIPv6_t connector(FRPC::URL_t(url, ""), 1000, false);
+    int client = -1;
+    connector.connectSocket(client);
+
+    std::string clientAddress;
+    int fd = listener.accept(clientAddress);
+    TEST(fd > -1);
+    TEST(clientAddress == "127.0.0.1");
+    TEST(FRPC::Listener_t::peerAddress(fd) == "127.0.0.1");
+    ::close(fd);
+    ::close(client);
+}
+
+void testUnixAcceptor() {
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/frpc-test-%d.sock", int(getpid()));
+    std::string url = std::string("unix://") + path;
+
+    Factory_t factory;
+    FRPC::Acceptor_t acceptor(url, factory, 2);
+    acceptor.start();
+    TEST(callEcho(url, true));
+    TEST(callEcho(url, false));
+    acceptor.stop();
+
+    // restartable
+    acceptor.start();
+    TEST(callEcho(url, false));
+}
+
+void testTcpAcceptor() {
+    char url[64];
+
+    Factory_t factory;
+    FRPC::Acceptor_t acceptor("http://127.0.0.1:0/RPC2", factory, 4);
+    snprintf(url, sizeof(url), "http://127.0.0.1:%u/RPC2", acceptor.port());
+    acceptor.start();
+    TEST(callEcho(url, true));
+    TEST(callEcho(url, false));
+}
+
+void testHistogram() {
+    FRPC::Metrics_t::Histogram_t histogram;
+    for (uint64_t i = 1; i <= 1000; ++i) histogram.record(i * 100);
+    TEST(histogram.getCount() == 1000);
+    TEST(histogram.getSum() == 50050000);
+
+    // quantiles are upper bounds of buckets, relative error is below 1/4
+    uint64_t p50 = histogram.quantile(0.5);
+    uint64_t p99 = histogram.quantile(0.99);
+    TEST(p50 >= 50000 && p50 <= 50000 + 50000 / 4);
+    TEST(p99 >= 99000 && p99 <= 99000 + 99000 / 4);
+    TEST(histogram.quantile(1.0) >= 100000);
+}
+
+void testMetrics() {
+    char url[64];
+
+    FRPC::Metrics_t serverMetrics;
+    Factory_t factory;
+    factory.config.metrics = &serverMetrics;
+    FRPC::Acceptor_t acceptor("http://127.0.0.1:0/RPC2", factory, 1);
+    snprintf(url, sizeof(url), "http://127.0.0.1:%u/RPC2", acceptor.port());
+    acceptor.start();
+
+    FRPC::Metrics_t clientMetrics("client");
+    FRPC::ServerProxy_t::Config_t config;
+    config.keepAlive = true;
+    config.metrics = &clientMetrics;
+    FRPC::ServerProxy_t proxy(url, config);
+
+    FRPC::Pool_t pool;
+    for (int i = 0; i < 3; ++i)
+        proxy.call(pool, "echo", &pool.Int(i), (FRPC::Value_t*)0);
+    try {
+        proxy.call(pool, "missing", (FRPC::Value_t*)0);
+        TEST(false);
+    } catch (const FRPC::Fault_t &fault) {
+        TEST(fault.errorNum() == FRPC::MethodRegistry_t::FRPC_NO_SUCH_METHOD_ERROR);
+    }
+
+    FRPC::Struct_t &stats = FRPC::Struct(
+            proxy.call(pool, "system.stats", (FRPC::Value_t*)0));
+    FRPC::Struct_t &echo = FRPC::Struct(FRPC::Struct(stats["methods"])["echo"]);
+    TEST(FRPC::Int(echo["calls"]) == 3);
+    TEST(FRPC::Int(echo["faults"]) == 0);
+    TEST(FRPC::Int(stats["connectionsReused"]) >= 4);
+
+    std::string text = FRPC::String(
+            proxy.call(pool, "system.stats", &pool.String("text"),
+                       (FRPC::Value_t*)0)).getString();
+    TEST(text.find("frpc_calls_total{method=\"echo\"} 3") != std::string::npos);
+    TEST(text.find("frpc_faults_total{method=\"(unknown)\",code=\"-506\"} 1")
+         != std::string::npos);
+
+    FRPC::Metrics_t::MethodStats_t &clientEcho = clientMetrics.method("echo");
+    TEST(clientEcho.calls.get() == 3);
+    TEST(clientEcho.latency.getCount() == 3);
+    FRPC::Metrics_t::MethodStats_t &clientMissing =
+        clientMetrics.method("missing");
+    TEST(clientMissing.faults.get() == 1);
+    std::string clientText = clientMetrics.format();
+    TEST(clientText.find("client_faults_total{method=\"missing\",code=\"-506\"} 1")
+         != std::string::npos);
+    TEST(clientText.find("client_sent_bytes_total") != std::string::npos);
+}
+
+void testPhaseTimes() {
+    FRPC::PhaseTimes_t phases;
+    phases.start(FRPC::PhaseTimes_t::READ);
+    ::usleep(2000);
+    {
+        FRPC::PhaseScope_t decode(&phases, FRPC::PhaseTimes_t::DECODE);
+        ::usleep(5000);
+    }
+    ::usleep(2000);
+    phases.stop();
+    TEST(phases.get(FRPC::PhaseTimes_t::READ) >= 4000);
+    TEST(phases.get(FRPC::PhaseTimes_t::DECODE) >= 5000);
+    TEST(phases.get(FRPC::PhaseTimes_t::HANDLER) == 0);
+    TEST(phases.total() == phases.get(FRPC::PhaseTimes_t::READ)
+                           + phases.get(FRPC::PhaseTimes_t::DECODE));
+
+    // stopped clock is not charged
+    uint64_t total = phases.total();
+    {
+        FRPC::PhaseScope_t write(&phases, FRPC::PhaseTimes_t::WRITE);
+        ::usleep(1000);
+    }
+    TEST(phases.total() == total);
+    TEST(std::string(FRPC::PhaseTimes_t::name(FRPC::PhaseTimes_t::HANDLER))
+         == "handler");
+}
+
+void testRequestPhases() {
+    char url[64];
+
+    Callbacks_t callbacks;
+    Factory_t factory;
+    factory.config.callbacks = &callbacks;
+    FRPC::Acceptor_t acceptor("http://127.0.0.1:0/RPC2", factory, 1);
+    snprintf(url, sizeof(url), "http://127.0.0.1:%u/RPC2", acceptor.port());
+    acceptor.start();
+
+    FRPC::ServerProxy_t::Config_t config;
+    config.keepAlive = true;
+    FRPC::ServerProxy_t proxy(url, config);
+
+    FRPC::Pool_t pool;
+    proxy.call(pool, "sleep", &pool.Int(20000), (FRPC::Value_t*)0);
+    const FRPC::PhaseTimes_t &client = proxy.getLastCallPhases();
+    TEST(client.get(FRPC::PhaseTimes_t::HANDLER) >= 20000);
+    TEST(!client.isRunning());
+
+    // callback runs after response is sent
+    for (int i = 0; (i < 100) && !callbacks.requests; ++i) ::usleep(1000);
+    TEST(callbacks.requests == 1);
+    TEST(callbacks.lastMethod == "sleep");
+    TEST(callbacks.last.get(FRPC::PhaseTimes_t::HANDLER) >= 20000);
+    TEST(callbacks.last.get(FRPC::PhaseTimes_t::HANDLER)
+         <= client.get(FRPC::PhaseTimes_t::HANDLER));
+    TEST(callbacks.last.total()
+         >= callbacks.last.get(FRPC::PhaseTimes_t::HANDLER));
+}
+
+bool checkRange(const FRPC::Value_t &value, long n) {
+    const FRPC::Array_t &items = FRPC::Array(value);
+    if (items.size() != size_t(n)) return false;
+    for (long i = 0; i < n; ++i) {
+        char item[32];
+        snprintf(item, sizeof(item), "%ld", i);
+        if (FRPC::String(items[i]).getString() != item) return false;
+    }
+    return true;
+}
+
+void testStreamMethod() {
+    char url[64];
+
+    FRPC::Metrics_t serverMetrics;
+    Factory_t factory;
+    factory.config.metrics = &serverMetrics;
+    FRPC::Acceptor_t acceptor("http://127.0.0.1:0/RPC2", factory, 1);
+    snprintf(url, sizeof(url), "http://127.0.0.1:%u/RPC2", acceptor.port());
+    acceptor.start();
+
+    FRPC::ServerProxy_t::Config_t config;
+    config.keepAlive = true;
+    FRPC::ServerProxy_t proxy(url, config);
+    FRPC::ServerProxy_t::Config_t xmlConfig(config);
+    xmlConfig.useBinary = FRPC::ServerProxy_t::Config_t::NEVER;
+    FRPC::ServerProxy_t xmlProxy(url, xmlConfig);
+
+    FRPC::Pool_t pool;
+    TEST(checkRange(proxy.call(pool, "range", &pool.Int(20000),
+                               (FRPC::Value_t*)0), 20000));
+    TEST(checkRange(proxy.call(pool, "range", &pool.Int(0),
+                               (FRPC::Value_t*)0), 0));
+    TEST(checkRange(xmlProxy.call(pool, "range", &pool.Int(100),
+                                  (FRPC::Value_t*)0), 100));
+
+    // fault before opening goes to client as usual
+    try {
+        proxy.call(pool, "range", &pool.Int(-1), (FRPC::Value_t*)0);
+        TEST(false);
+    } catch (const FRPC::Fault_t &fault) {
+        TEST(fault.errorNum() == -1);
+    }
+
+    // inside multicall the result is collected
+    FRPC::Array_t &calls = pool.Array(
+            pool.Struct("methodName", pool.String("range"),
+                        "params", pool.Array(pool.Int(10))));
+    FRPC::Array_t &results = FRPC::Array(
+            proxy.call(pool, "system.multicall", &calls, (FRPC::Value_t*)0));
+    TEST(checkRange(results[0], 10));
+
+    // failure after opening closes the connection
+    try {
+        proxy.call(pool, "range", &pool.Int(20000), &pool.Int(10000),
+                   (FRPC::Value_t*)0);
+        TEST(false);
+    } catch (const FRPC::Fault_t &) {
+        TEST(false);
+    } catch (const FRPC::Error_t &) {
+    }
+    TEST(checkRange(proxy.call(pool, "range", &pool.Int(3),
+                               (FRPC::Value_t*)0), 3));
+
+    FRPC::Metrics_t::MethodStats_t &range = serverMetrics.method("range");
+    TEST(range.calls.get() == 6);
+    TEST(range.faults.get() == 2);
+}
+
+void testRetryAndHedge() {
+    // shared unix listener: any idle thread takes the next connection
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/frpc-retry-%d.sock", int(getpid()));
+    std::string url = std::string("unix://") + path;
+
+    Factory_t factory;
+    FRPC::Acceptor_t acceptor(url, factory, 8);
+    acceptor.start();
+
+    // timed out call of idempotent method is repeated
+    FRPC::ServerProxy_t::Config_t config;
+    config.keepAlive = true;
+    config.readTimeout = 100;
+    config.idempotentMethods = "get*,slow*";
+    config.maxRetries = 2;
+    config.retryBackoff = 10;
+    FRPC::ServerProxy_t proxy(url, config);
+
+    FRPC::Pool_t pool;
+    FRPC::Array_t &result = FRPC::Array(
+            proxy.call(pool, "slowOnce", &pool.Int(300000),
+                       (FRPC::Value_t*)0));
+    TEST(FRPC::Int(result[0]) == 300000);
+    TEST(factory.handler.slowCalls == 2);
+
+    // other methods are not
+    factory.handler.slowCalls = 0;
+    config.idempotentMethods = "get*";
+    FRPC::ServerProxy_t strict(url, config);
+    try {
+        strict.call(pool, "slowOnce", &pool.Int(300000), (FRPC::Value_t*)0);
+        TEST(false);
+    } catch (const FRPC::ProtocolError_t &error) {
+        TEST(error.errorNum() == FRPC::HTTP_TIMEOUT);
+    }
+    TEST(factory.handler.slowCalls == 1);
+
+    // slow request is overtaken by the hedged one
+    ::usleep(300000);
+    factory.handler.slowCalls = 0;
+    FRPC::ServerProxy_t::Config_t hedgeConfig;
+    hedgeConfig.keepAlive = true;
+    hedgeConfig.idempotentMethods = "slow*";
+    hedgeConfig.hedgeDelay = 50;
+    FRPC::ServerProxy_t hedged(url, hedgeConfig);
+
+    uint64_t start = FRPC::Metrics_t::now();
+    FRPC::Array_t &hedgedResult = FRPC::Array(
+            hedged.call(pool, "slowOnce", &pool.Int(1000000),
+                        (FRPC::Value_t*)0));
+    TEST(FRPC::Metrics_t::now() - start < 500000);
+    TEST(FRPC::Int(hedgedResult[0]) == 1000000);
+    TEST(factory.handler.slowCalls == 2);
+    TEST(callEcho(url, true));
+
+    // hedged call doesn't wait longer than the read timeout in total
+    hedgeConfig.idempotentMethods = "sleep";
+    hedgeConfig.readTimeout = 300;
+    hedgeConfig.hedgeDelay = 200;
+    FRPC::ServerProxy_t bounded(url, hedgeConfig);
+    start = FRPC::Metrics_t::now();
+    try {
+        bounded.call(pool, "sleep", &pool.Int(1000000), (FRPC::Value_t*)0);
+        TEST(false);
+    } catch (const FRPC::ProtocolError_t &error) {
+        TEST(error.errorNum() == FRPC::HTTP_TIMEOUT);
+    }
+    TEST(FRPC::Metrics_t::now() - start < 450000);
+}
+
+void testDeadline() {
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/frpc-deadline-%d.sock", int(getpid()));
+    std::string url = std::string("unix://") + path;
+
+    Factory_t factory;
+    FRPC::Acceptor_t acceptor(url, factory, 4);
+    acceptor.start();
+
+    // no deadline unless asked for
+    FRPC::ServerProxy_t::Config_t config;
+    config.keepAlive = true;
+    config.readTimeout = 5000;
+    FRPC::ServerProxy_t plain(url, config);
+    FRPC::Pool_t pool;
+    TEST(FRPC::Int(plain.call(pool, "budget", (FRPC::Value_t*)0)) == -1);
+
+    config.sendDeadline = true;
+    FRPC::ServerProxy_t proxy(url, config);
+    long budget = FRPC::Int(proxy.call(pool, "budget", (FRPC::Value_t*)0));
+    TEST(budget > 4000 && budget <= 5000);
+
+    // handler passes its deadline on to own calls
+    config.readTimeout = 3000;
+    FRPC::ServerProxy_t shorter(url, config);
+    budget = FRPC::Int(shorter.call(pool, "relay", &pool.String(url),
+                                    (FRPC::Value_t*)0));
+    TEST(budget > 2000 && budget <= 3000);
+
+    // request expired in queue is not processed
+    factory.handler.slowCalls = 0;
+    plain.addRequestHttpHeaderForCall(
+            FRPC::HTTPClient_t::Header_t("X-Frpc-Timeout", "0"));
+    try {
+        plain.call(pool, "slowOnce", &pool.Int(1), (FRPC::Value_t*)0);
+        TEST(false);
+    } catch (const FRPC::Fault_t &fault) {
+        TEST(fault.errorNum() == FRPC::MethodRegistry_t::FRPC_TIMEOUT_ERROR);
+    }
+    TEST(factory.handler.slowCalls == 0);
+    TEST(callEcho(url, true));
+
+    // expired inherited deadline fails locally
+    {
+        FRPC::DeadlineScope_t scope(FRPC::Metrics_t::now());
+        TEST(FRPC::Deadline_t::expired());
+        try {
+            plain.call(pool, "slowOnce", &pool.Int(1), (FRPC::Value_t*)0);
+            TEST(false);
+        } catch (const FRPC::Fault_t &fault) {
+            TEST(fault.errorNum()
+                 == FRPC::MethodRegistry_t::FRPC_TIMEOUT_ERROR);
+        }
+    }
+    TEST(factory.handler.slowCalls == 0);
+    TEST(FRPC::Deadline_t::remaining() == -1);
+}
+
+/** Calls sleep in own thread.
+ */
+struct Sleeper_t {
+    Sleeper_t(const std::string &url, int usec,
+              const FRPC::ServerProxy_t::Config_t &config
+              = FRPC::ServerProxy_t::Config_t())
+        : url(url), usec(usec), config(config), result(-1)
+    {
+        pthread_create(&thread, 0, &Sleeper_t::run, this);
+        ::usleep(50000);
+    }
+
+    ~Sleeper_t() {
+        join();
+    }
+
+    void join() {
+        if (thread) pthread_join(thread, 0);
+        thread = 0;
+    }
+
+    static void* run(void *arg) {
+        Sleeper_t &self = *static_cast<Sleeper_t*>(arg);
+        FRPC::ServerProxy_t proxy(self.url, self.config);
+        FRPC::Pool_t pool;
+        try {
+            FRPC::Array_t &result = FRPC::Array(
+                    proxy.call(pool, "sleep", &pool.Int(self.usec),
+                               (FRPC::Value_t*)0));
+            self.result = FRPC::Int(result[0]);
+        } catch (const FRPC::ProtocolError_t &) {
+        } catch (const FRPC::Fault_t &) {
+        }
+        return 0;
+    }
+
+    std::string url;
+    int usec;
+    FRPC::ServerProxy_t::Config_t config;
+    int result;
+    pthread_t thread;
+};
+
+void testAdmission() {
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/frpc-admission-%d.sock", int(getpid()));
+    std::string url = std::string("unix://") + path;
+
+    FRPC::AdmissionControl_t::Config_t admissionConfig;
+    admissionConfig.maxInFlight = 1;
+    FRPC::AdmissionControl_t admission(admissionConfig);
+    admission.limit("sleep", FRPC::AdmissionControl_t::Limits_t(1, 1));
+    Factory_t factory;
+    factory.config.admission = &admission;
+    FRPC::Acceptor_t acceptor(url, factory, 4);
+    acceptor.start();
+    FRPC::ServerProxy_t proxy(url, FRPC::ServerProxy_t::Config_t());
+    FRPC::Pool_t pool;
+
+    // no free slot and no queue => refused at once
+    {
+        Sleeper_t sleeper(url, 300000);
+        TEST(admission.inFlight() == 1);
+        uint64_t start = FRPC::Metrics_t::now();
+        try {
+            proxy.call(pool, "echo", (FRPC::Value_t*)0);
+            TEST(false);
+        } catch (const FRPC::Fault_t &fault) {
+            TEST(fault.errorNum()
+                 == FRPC::MethodRegistry_t::FRPC_REQUEST_REFUSED_ERROR);
+        }
+        TEST(FRPC::Metrics_t::now() - start < 100000);
+        TEST(admission.refused() == 1);
+    }
+    TEST(admission.inFlight() == 0);
+    TEST(callEcho(url, true));
+
+    // method queue: second sleep waits for the first one, third is refused
+    admissionConfig.maxInFlight = 0;
+    admissionConfig.queueTimeout = 1000;
+    admissionConfig.refuseWithHttp = true;
+    FRPC::AdmissionControl_t methodAdmission(admissionConfig);
+    methodAdmission.limit("sleep", FRPC::AdmissionControl_t::Limits_t(1, 1));
+    acceptor.stop();
+    FRPC::Metrics_t metrics;
+    factory.config.admission = &methodAdmission;
+    factory.config.metrics = &metrics;
+    FRPC::Acceptor_t methodAcceptor(url, factory, 4);
+    methodAcceptor.start();
+    {
+        Sleeper_t first(url, 200000);
+        Sleeper_t second(url, 1000);
+        try {
+            proxy.call(pool, "sleep", &pool.Int(1), (FRPC::Value_t*)0);
+            TEST(false);
+        } catch (const FRPC::ProtocolError_t &error) {
+            TEST(error.errorNum() == FRPC::HTTP_SERVICE_UNAVAILABLE);
+        }
+        // other methods are not limited
+        TEST(callEcho(url, false));
+
+        // system.multicall doesn't bypass the method limit
+        FRPC::Array_t &calls = pool.Array(pool.Struct(
+                "methodName", pool.String("sleep"),
+                "params", pool.Array(pool.Int(1))));
+        FRPC::Array_t &results = FRPC::Array(proxy.call(
+                pool, "system.multicall", &calls, (FRPC::Value_t*)0));
+        TEST(results.size() == 1);
+        TEST(FRPC::Int(FRPC::Struct(results[0])["faultCode"])
+             == FRPC::MethodRegistry_t::FRPC_REQUEST_REFUSED_ERROR);
+
+        // refused call keeps keep-alive connection open
+        FRPC::SimpleConnectorUnix_t connector(FRPC::URL_t(url, ""), 1000,
+                                              false);
+        int fd = -1;
+        connector.connectSocket(fd);
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+        std::string refused = rawCall(fd, "sleep");
+        TEST(refused.find(" 503 ") != std::string::npos);
+        TEST(refused.find("keep-alive") != std::string::npos);
+        std::string echo = rawCall(fd, "echo");
+        TEST(echo.find(" 200 ") != std::string::npos);
+        TEST(echo.find("<i4>1</i4>") != std::string::npos);
+        ::close(fd);
+    }
+    TEST(methodAdmission.refused() == 3);
+    TEST(metrics.format().find(
+            "frpc_faults_total{method=\"sleep\",code=\"-507\"} 2")
+         != std::string::npos);
+    TEST(methodAdmission.inFlight() == 0);
+
+    // adaptive limit: slow calls decrease it, fast ones raise it back
+    FRPC::AdmissionControl_t::Config_t adaptiveConfig;
+    adaptiveConfig.maxInFlight = 10;
+    adaptiveConfig.adaptive = true;
+    adaptiveConfig.minLimit = 2;
+    adaptiveConfig.latencyTarget = 1;
+    adaptiveConfig.decreaseRatio = 0.5;
+    FRPC::AdmissionControl_t adaptive(adaptiveConfig);
+    TEST(adaptive.limit() == 10);
+    adaptive.admit("echo");
+    adaptive.release("echo", 5000);
+    TEST(adaptive.limit() == 5);
+    // burst of slow calls counts once
+    adaptive.admit("echo");
+    adaptive.release("echo", 5000);
+    TEST(adaptive.limit() == 5);
+    for (int i = 0; i < 3; ++i) {
+        ::usleep(2000);
+        adaptive.admit("echo");
+        adaptive.release("echo", 5000);
+    }
+    TEST(adaptive.limit() == 2);
+    for (int i = 0; i < 100; ++i) {
+        adaptive.admit("echo");
+        adaptive.release("echo", 100);
+    }
+    TEST(adaptive.limit() == 10);
+
+    // decayed limit never drops to 0 (which would mean unlimited)
+    adaptiveConfig.minLimit = 0;
+    adaptiveConfig.decreaseRatio = 0.01;
+    FRPC::AdmissionControl_t decayed(adaptiveConfig);
+    decayed.admit("echo");
+    decayed.release("echo", 5000);
+    TEST(decayed.limit() == 1);
+
+    // method limited while its call is in flight is still admitted later
+    FRPC::AdmissionControl_t::Config_t lateConfig;
+    FRPC::AdmissionControl_t lateAdmission(lateConfig);
+    std::string sleepMethod("sleep");
+    {
+        FRPC::AdmissionControl_t::Ticket_t ticket(&lateAdmission,
+                                                  sleepMethod);
+        lateAdmission.limit(sleepMethod,
+                            FRPC::AdmissionControl_t::Limits_t(1));
+    }
+    for (int i = 0; i < 2; ++i) {
+        try {
+            FRPC::AdmissionControl_t::Ticket_t ticket(&lateAdmission,
+                                                      sleepMethod);
+        } catch (const FRPC::Fault_t &) {
+            TEST(false);
+        }
+    }
+    TEST(lateAdmission.refused() == 0);
+}
+
+void testSingleFlight() {
+    // equal params give equal keys regardless of member order
+    FRPC::Pool_t pool;
+    FRPC::Struct_t &first = pool.Struct("a", pool.Int(1), "b", pool.String("x"));
+    FRPC::Struct_t &second = pool.Struct("b", pool.String("x"), "a", pool.Int(1));
+    FRPC::Array_t &firstParams = pool.Array(first);
+    FRPC::Array_t &secondParams = pool.Array(second);
+    FRPC::Array_t &otherParams = pool.Array(pool.Int(1));
+    std::string key = FRPC::SingleFlight_t::key(
+            "url", "m", firstParams.begin(), firstParams.end());
+    TEST(key == FRPC::SingleFlight_t::key(
+                 "url", "m", secondParams.begin(), secondParams.end()));
+    TEST(key != FRPC::SingleFlight_t::key(
+                 "url", "n", firstParams.begin(), firstParams.end()));
+    TEST(key != FRPC::SingleFlight_t::key(
+                 "url", "m", otherParams.begin(), otherParams.end()));
+
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/frpc-flight-%d.sock", int(getpid()));
+    std::string url = std::string("unix://") + path;
+
+    // server side: concurrent sleeps run once
+    FRPC::SingleFlight_t serverFlight("sleep");
+    Factory_t factory;
+    factory.config.singleFlight = &serverFlight;
+    {
+        FRPC::Acceptor_t acceptor(url, factory, 4);
+        acceptor.start();
+        Sleeper_t first(url, 300000);
+        Sleeper_t second(url, 300000);
+        Sleeper_t third(url, 300000);
+        Sleeper_t other(url, 1000);
+        first.join();
+        second.join();
+        third.join();
+        other.join();
+        TEST(first.result == 300000 && second.result == 300000
+             && third.result == 300000 && other.result == 1000);
+        TEST(factory.handler.sleepCalls == 2);
+        TEST(serverFlight.executed() == 2);
+        TEST(serverFlight.coalesced() == 2);
+        TEST(callEcho(url, true));
+        TEST(serverFlight.executed() == 2);
+    }
+
+    // client side: proxies sharing single flight
+    FRPC::SingleFlight_t clientFlight("sleep");
+    Factory_t plainFactory;
+    FRPC::Acceptor_t acceptor(url, plainFactory, 4);
+    acceptor.start();
+    FRPC::ServerProxy_t::Config_t config;
+    config.singleFlight = &clientFlight;
+    {
+        Sleeper_t first(url, 300000, config);
+        Sleeper_t second(url, 300000, config);
+        Sleeper_t third(url, 300000, config);
+        first.join();
+        second.join();
+        third.join();
+        TEST(first.result == 300000 && second.result == 300000
+             && third.result == 300000);
+    }
+    TEST(plainFactory.handler.sleepCalls == 1);
+    TEST(clientFlight.coalesced() == 2);
+
+    // fault of coalesced call reaches the caller
+    FRPC::ServerProxy_t proxy(url, config);
+    try {
+        proxy.call(pool, "sleep", (FRPC::Value_t*)0);
+        TEST(false);
+    } catch (const FRPC::Fault_t &fault) {
+        TEST(fault.errorNum() == FRPC::MethodRegistry_t::FRPC_INDEX_ERROR);
+    }
+
+    // waiting caller gives up at its own deadline
+    {
+        Sleeper_t leader(url, 300000, config);
+        FRPC::DeadlineScope_t deadline(FRPC::Metrics_t::now() + 50000);
+        uint64_t start = FRPC::Metrics_t::now();
+        try {
+            proxy.call(pool, "sleep", &pool.Int(300000), (FRPC::Value_t*)0);
+            TEST(false);
+        } catch (const FRPC::Fault_t &fault) {
+            TEST(fault.errorNum()
+                 == FRPC::MethodRegistry_t::FRPC_TIMEOUT_ERROR);
+        }
+        TEST(FRPC::Metrics_t::now() - start < 200000);
+        TEST(clientFlight.coalesced() == 3);
+    }
+}
+
+void testResponseCache() {
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/frpc-cache-%d.sock", int(getpid()));
+    std::string url = std::string("unix://") + path;
+
+    Factory_t factory;
+    FRPC::Acceptor_t acceptor(url, factory, 2);
+    acceptor.start();
+
+    FRPC::ResponseCache_t cache(1 << 20);
+    cache.setTtl("sleep", 200);
+    TEST(cache.ttl("sleep") == 200);
+    TEST(cache.ttl("echo") == 0);
+    FRPC::ServerProxy_t::Config_t config;
+    config.keepAlive = true;
+    config.responseCache = &cache;
+    FRPC::ServerProxy_t proxy(url, config);
+
+    // second call is served from cache into caller's pool
+    {
+        FRPC::Pool_t pool;
+        proxy.call(pool, "sleep", &pool.Int(1), (FRPC::Value_t*)0);
+    }
+    FRPC::Pool_t pool;
+    FRPC::Array_t &result = FRPC::Array(
+            proxy.call(pool, "sleep", &pool.Int(1), (FRPC::Value_t*)0));
+    TEST(result.size() == 1 && FRPC::Int(result[0]) == 1);
+    TEST(factory.handler.sleepCalls == 1);
+    TEST(cache.hits() == 1 && cache.misses() == 1);
+
+    // other params, not cached methods and expired entries go to server
+    proxy.call(pool, "sleep", &pool.Int(2), (FRPC::Value_t*)0);
+    TEST(factory.handler.sleepCalls == 2);
+    TEST(callEcho(url, true));
+    proxy.call(pool, "echo", (FRPC::Value_t*)0);
+    TEST(cache.size() == 2);
+    ::usleep(250000);
+    proxy.call(pool, "sleep", &pool.Int(1), (FRPC::Value_t*)0);
+    TEST(factory.handler.sleepCalls == 3);
+    TEST(cache.hits() == 1 && cache.misses() == 3);
+
+    // proxy with other credentials does not share cached results
+    FRPC::ServerProxy_t other(url, config);
+    other.addRequestHttpHeader(
+            FRPC::HTTPClient_t::Header_t("Authorization", "other"));
+    other.call(pool, "sleep", &pool.Int(1), (FRPC::Value_t*)0);
+    TEST(factory.handler.sleepCalls == 4);
+    TEST(cache.hits() == 1 && cache.misses() == 4);
+
+    // least recently used entries are evicted to fit the budget
+    FRPC::ResponseCache_t small(1100);
+    std::string value(200, 'x');
+    small.put("a", pool.String(value), 1000);
+    small.put("b", pool.String(value), 1000);
+    small.put("c", pool.String(value), 1000);
+    TEST(small.get(pool, "a") != 0);
+    small.put("d", pool.String(value), 1000);
+    TEST(small.size() == 3 && small.bytes() <= 1100);
+    TEST(small.get(pool, "b") == 0);
+    FRPC::Value_t *cached = small.get(pool, "a");
+    TEST(cached && (FRPC::String(*cached).getString() == value));
+    small.put("big", pool.String(std::string(2000, 'x')), 1000);
+    TEST(small.get(pool, "big") == 0);
+    TEST(small.get(pool, "a") != 0);
+}
+
+void testBalancingProxy() {
+    std::vector<std::string> backends;
+    Factory_t factory;
+    std::vector<FRPC::Acceptor_t*> acceptors;
+    for (int i = 0; i < 2; ++i) {
+        char path[64];
+        snprintf(path, sizeof(path), "/tmp/frpc-backend%d-%d.sock", i,
+                 int(getpid()));
+        backends.push_back(std::string("unix://") + path);
+        acceptors.push_back(new FRPC::Acceptor_t(backends.back(), factory, 2));
+        acceptors.back()->start();
+    }
+    backends.push_back("unix:///tmp/frpc-missing.sock");
+
+    for (int policy = 0; policy < 2; ++policy) {
+        FRPC::BalancingProxy_t::Config_t config;
+        config.policy = policy ? FRPC::BalancingProxy_t::TWO_CHOICES
+                               : FRPC::BalancingProxy_t::LEAST_OUTSTANDING;
+        config.ejectAfter = 1;
+        config.proxy.keepAlive = true;
+        FRPC::BalancingProxy_t proxy(backends, config);
+
+        int errors = 0;
+        FRPC::Pool_t pool;
+        for (int i = 0; i < 40; ++i) {
+            try {
+                FRPC::Array_t &result = FRPC::Array(
+                        proxy.call(pool, "echo", &pool.Int(i),
+                                   (FRPC::Value_t*)0));
+                TEST(FRPC::Int(result[0]) == i);
+            } catch (const FRPC::ProtocolError_t &) {
+                ++errors;
+            }
+        }
+
+        // the dead one failed once and has been ejected since
+        std::vector<FRPC::BalancingProxy_t::Backend_t> state(
+                proxy.backends());
+        TEST(errors == 1);
+        TEST(state[2].failures == 1);
+        TEST(state[2].ejected);
+        TEST(!state[0].ejected && !state[1].ejected);
+        TEST(state[0].calls > 5 && state[1].calls > 5);
+        TEST(state[0].calls + state[1].calls + state[2].calls == 40);
+        TEST(!state[0].outstanding && !state[1].outstanding);
+
+        // faults don't eject
+        try {
+            proxy.call(pool, "missing", (FRPC::Value_t*)0);
+            TEST(false);
+        } catch (const FRPC::Fault_t &) {
+        }
+        state = proxy.backends();
+        TEST(!state[0].ejected && !state[1].ejected);
+    }
+
+    for (size_t i = 0; i < acceptors.size(); ++i) delete acceptors[i];
+}
+
+int main(int argc, char *argv[]) {
+    testPeerAddress();
+    testUnixAcceptor();
+    testTcpAcceptor();
+    testHistogram();
+    testMetrics();
+    testPhaseTimes();
+    testRequestPhases();
+    testStreamMethod();
+    testRetryAndHedge();
+    testDeadline();
+    testAdmission();
+    testSingleFlight();
+    testResponseCache();
+    testBalancingProxy();
+    return fails ? EXIT_FAILURE : EXIT_SUCCESS;
+}